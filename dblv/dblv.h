@@ -54,6 +54,15 @@
 #define DBLV_PRINT(name, n)                  printf("%s: %*.6f MB/s\n", name, (int) (DBLV_PRINT_SPACE - strlen(name)), (double) n * sizeof(double) / DBLV_TDIFF() *1e-6);
 
 
+/* dblv_simd.c */
+#define DBLV_SIMD_NONE    0
+#define DBLV_SIMD_AVX2    1
+#define DBLV_SIMD_AVX512  2
+
+int dblv_simd_level();
+void dblv_simd_set_level(int level);
+const char *dblv_simd_name(int level);
+
 /* dbvl_io.c */
 void dblv_bin_fread(int nout, double *vout, const char *fname, int *n);
 void dblv_bin_fwrite(int nin, double *vin, const char *fname);
@@ -92,9 +101,82 @@ void dblv_rle_zero_cf_uc_add2_cb(int nin0, double *vin0, int nin1, double *vin1,
 void dblv_rle_zero_cf_uc_add2_ub(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout);
 void dblv_rle_zero_uc_cf_add2_uc(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout);
 void dblv_rle_zero_uc_uc_add2_cf(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout);
+void dblv_rle_zero_cf_cf_add2_cf(int nin0, double *vin0, int nin1, double *vin1, int *nout, double *vout);
+void dblv_rle_zero_cf_cf_add3_cf(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next, double *vin1_next);
 void dblv_rle_zero_cf_uc_add3_cf(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next);
 void dblv_rle_zero_cf_uc_add3_uc(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next);
 
+/* dblv_rle_zero_op.c */
+#define DBLV_RLE_DOUBLE  0
+#define DBLV_RLE_FLOAT   1
+#define DBLV_RLE_INT     2
+#define DBLV_RLE_LONG    3
+
+#define DBLV_RLE_SUM  0
+#define DBLV_RLE_MAX  1
+#define DBLV_RLE_MIN  2
+
+typedef struct _dblv_rle_ops
+{
+  int type_size;
+
+  void (*compress)(int nin, void *vin, int *nout, void *vout);
+  void (*compress3)(int nin, void *vin, int nout, void *vout, int *nread, int *nwrite);
+  void (*uncompress)(int nin, void *vin, int *nout, void *vout);
+
+  /* skips n uncompressed elements of a compressed operand (starting with the zero run of vin_next, as the add3 kernels),
+     returns the compressed elements read and the rest of the current zero run in vin_next, with whole != 0 a zero run
+     that contains the n-th element is skipped entirely and nskipped returns the uncompressed elements skipped */
+  void (*seek)(int nin, void *vin, int n, int whole, int *nread, int *nskipped, void *vin_next);
+
+  void (*cf_uc_add2_cb)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout);
+  void (*cf_uc_add2_ub)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout);
+  void (*uc_cf_add2_uc)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout);
+  void (*uc_uc_add2_cf)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout);
+  void (*cf_uc_add3_cf)(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next);
+  void (*cf_uc_add3_uc)(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next);
+
+  /* both operands compressed, the output needs space for the uncompressed result */
+  void (*cf_cf_add2_cf)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void *vout);
+  void (*cf_cf_add3_cf)(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next, void *vin1_next);
+
+} dblv_rle_ops;
+
+const dblv_rle_ops *dblv_rle_zero_ops(int type, int op);
+
+/* dblv_coo.c */
+#define DBLV_COO_IDX32   0
+#define DBLV_COO_VARINT  1
+
+/* index-value (COO) format: header, values of the nnz non-zero elements, bytes of their indices (either 32-bit
+   indices or distances to the previous index as varints), type and operator constants are the ones of dblv_rle_ops */
+typedef struct _dblv_coo_header
+{
+  int n, nnz, enc, nidx;
+
+} dblv_coo_header;
+
+#define DBLV_COO_SIZE(nnz, nidx, type_size)  ((int) sizeof(dblv_coo_header) + (nnz) * (type_size) + (nidx))
+#define DBLV_COO_MAX_SIZE(n, type_size)      DBLV_COO_SIZE((n), 5 * (n), (type_size))
+
+/* sizes of index-value operands are in bytes, uncompressed and zero-RLE operands are in elements,
+   index-value outputs get the capacity of the output buffer with *nout and return -1 if it is too small */
+typedef struct _dblv_coo_ops
+{
+  int type_size;
+
+  void (*compress)(int nin, void *vin, int enc, int *nout, void *vout);
+  void (*uncompress)(int nin, void *vin, int *nout, void *vout);
+
+  void (*co_uc_add2_uc)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void *vout);
+  void (*co_uc_add2_co)(int nin0, void *vin0, int nin1, void *vin1, int enc, int *nout, void *vout);
+  void (*co_co_add2_co)(int nin0, void *vin0, int nin1, void *vin1, int enc, int *nout, void *vout);
+  void (*co_cf_add2_co)(int nin0, void *vin0, int nin1, void *vin1, int enc, int *nout, void *vout);
+
+} dblv_coo_ops;
+
+const dblv_coo_ops *dblv_coo_get_ops(int type, int op);
+
 #ifdef USE_ZLIB
 
 /* dblv_zlib.c */
@@ -0,0 +1,216 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "dblv.h"
+#include "dblv_rle.h"
+
+
+/* index-value (COO) format: a header followed by the non-zero values and the bytes of their indices (see dblv.h)
+
+   Output kernels write the values forward behind the header and the index bytes backward from the end of the
+   output buffer. Both are joined when the output is finished, i.e., the output needs no further buffer and
+   is produced in a single pass even though the number of non-zeros is not known in advance. */
+
+#define COO_VALUES(v)             ((void *) ((char *) (v) + sizeof(dblv_coo_header)))
+#define COO_INDEX(v, type_size)   ((const unsigned char *) (v) + sizeof(dblv_coo_header) + ((dblv_coo_header *) (v))->nnz * (type_size))
+
+/* largest number of bytes of a single index */
+#define COO_MAX_INDEX_BYTES  5
+
+#define COO_OUT_BEGIN(vout, nout, vals, iend, ip)  do { \
+  if (*(nout) < (int) sizeof(dblv_coo_header)) { *(nout) = -1; return; } \
+  vals = COO_VALUES(vout); \
+  iend = ip = (unsigned char *) (vout) + *(nout); \
+} while (0)
+
+#define COO_PUSH(i, v)  do { \
+  if ((unsigned char *) &vals[k + 1] + COO_MAX_INDEX_BYTES > ip) { *nout = -1; return; } \
+  vals[k++] = (v); \
+  ip = coo_put_index(ip, enc, (i), &prev); \
+} while (0)
+
+
+static inline unsigned char *coo_put_index(unsigned char *ip, int enc, int i, int *prev)
+{
+  dblv_int32 d;
+  unsigned char b[4];
+
+  if (enc == DBLV_COO_IDX32)
+  {
+    d = i;
+    memcpy(b, &d, 4);
+    *--ip = b[0]; *--ip = b[1]; *--ip = b[2]; *--ip = b[3];
+
+  } else
+  {
+    /* distance to the previous index, little-endian groups of 7 bits */
+    d = i - *prev - 1;
+    while (d >= 0x80)
+    {
+      *--ip = (d & 0x7F) | 0x80;
+      d >>= 7;
+    }
+    *--ip = d;
+  }
+
+  *prev = i;
+
+  return ip;
+}
+
+
+static inline int coo_get_index(const unsigned char **ip, int enc, int prev)
+{
+  dblv_int32 d;
+  int s;
+
+  if (enc == DBLV_COO_IDX32)
+  {
+    memcpy(&d, *ip, 4);
+    *ip += 4;
+    return d;
+  }
+
+  d = 0;
+  for (s = 0; **ip & 0x80; s += 7) d |= (dblv_int32) (*(*ip)++ & 0x7F) << s;
+  d |= (dblv_int32) *(*ip)++ << s;
+
+  return prev + 1 + d;
+}
+
+
+static int coo_finish(void *vout, int n, int nnz, int enc, int type_size, unsigned char *iend, unsigned char *ip)
+{
+  dblv_coo_header *h = vout;
+  unsigned char *idx, t;
+  int i, nidx = iend - ip;
+
+  h->n = n;
+  h->nnz = nnz;
+  h->enc = (enc == DBLV_COO_IDX32)?DBLV_COO_IDX32:DBLV_COO_VARINT;
+  h->nidx = nidx;
+
+  /* move the (reversed) index bytes behind the values and restore their order */
+  idx = (unsigned char *) vout + sizeof(dblv_coo_header) + nnz * type_size;
+  memmove(idx, ip, nidx);
+  for (i = 0; i < nidx / 2; i++)
+  {
+    t = idx[i];
+    idx[i] = idx[nidx - 1 - i];
+    idx[nidx - 1 - i] = t;
+  }
+
+  return DBLV_COO_SIZE(nnz, nidx, type_size);
+}
+
+
+#define COO_OP_SUM(a, b)  ((a) + (b))
+#define COO_OP0_SUM(a)    (a)
+#define COO_OP_MAX(a, b)  (((a) > (b))?(a):(b))
+#define COO_OP0_MAX(a)    (((a) > 0)?(a):0)
+#define COO_OP_MIN(a, b)  (((a) < (b))?(a):(b))
+#define COO_OP0_MIN(a)    (((a) < 0)?(a):0)
+
+
+#define COO_TYPE        double
+#define COO_ISN_NAN_P   DBL_ISN_NAN_P
+#define COO_RLE_GET_P   DBL_RLE_GET_P
+
+#define MOD_COO(s)        dbl_sum_##s
+#define COO_OP            COO_OP_SUM
+#define COO_OP0           COO_OP0_SUM
+#define COO_OP0_IDENTITY
+#include "dblv_coo_tmpl.h"
+#undef MOD_COO
+#undef COO_OP
+#undef COO_OP0
+#undef COO_OP0_IDENTITY
+
+#define MOD_COO(s)      dbl_max_##s
+#define COO_OP          COO_OP_MAX
+#define COO_OP0         COO_OP0_MAX
+#include "dblv_coo_tmpl.h"
+#undef MOD_COO
+#undef COO_OP
+#undef COO_OP0
+
+#define MOD_COO(s)      dbl_min_##s
+#define COO_OP          COO_OP_MIN
+#define COO_OP0         COO_OP0_MIN
+#include "dblv_coo_tmpl.h"
+#undef MOD_COO
+#undef COO_OP
+#undef COO_OP0
+
+#undef COO_TYPE
+#undef COO_ISN_NAN_P
+#undef COO_RLE_GET_P
+
+
+#define COO_TYPE        float
+#define COO_ISN_NAN_P   FLT_ISN_NAN_P
+#define COO_RLE_GET_P   FLT_RLE_GET_P
+
+#define MOD_COO(s)        flt_sum_##s
+#define COO_OP            COO_OP_SUM
+#define COO_OP0           COO_OP0_SUM
+#define COO_OP0_IDENTITY
+#include "dblv_coo_tmpl.h"
+#undef MOD_COO
+#undef COO_OP
+#undef COO_OP0
+#undef COO_OP0_IDENTITY
+
+#define MOD_COO(s)      flt_max_##s
+#define COO_OP          COO_OP_MAX
+#define COO_OP0         COO_OP0_MAX
+#include "dblv_coo_tmpl.h"
+#undef MOD_COO
+#undef COO_OP
+#undef COO_OP0
+
+#define MOD_COO(s)      flt_min_##s
+#define COO_OP          COO_OP_MIN
+#define COO_OP0         COO_OP0_MIN
+#include "dblv_coo_tmpl.h"
+#undef MOD_COO
+#undef COO_OP
+#undef COO_OP0
+
+
+static const dblv_coo_ops *dblv_coo_ops_table[2][3] =
+{
+  { &dbl_sum_dblv_coo_ops, &dbl_max_dblv_coo_ops, &dbl_min_dblv_coo_ops },
+  { &flt_sum_dblv_coo_ops, &flt_max_dblv_coo_ops, &flt_min_dblv_coo_ops },
+};
+
+
+const dblv_coo_ops *dblv_coo_get_ops(int type, int op)
+{
+  if (type < 0 || type > DBLV_RLE_FLOAT || op < 0 || op > DBLV_RLE_MIN) return NULL;
+
+  return dblv_coo_ops_table[type][op];
+}
+
@@ -0,0 +1,241 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Type- and operator-generic index-value (COO) kernels. This file is included by dblv_coo.c once for every
+   supported combination with the following macros defined:
+
+     MOD_COO(s)         name of the instance (e.g., s##_flt_max)
+     COO_TYPE           element type (float or double)
+     COO_OP(a, b)       reduction of two elements
+     COO_OP0(a)         reduction of an element with zero
+     COO_OP0_IDENTITY   defined if COO_OP0 is the identity (sums), absent elements are then skipped
+     COO_ISN_NAN_P, COO_RLE_GET_P
+                        zero-run token macros of the element type for reading zero-RLE operands (see dblv_rle.h)
+
+   Kernels with an index-value output get the capacity of the output buffer in bytes with *nout and return
+   the size of the output in bytes or -1 if the output does not fit. Results of the reduction that are zero
+   are dropped. */
+
+
+static void MOD_COO(compress)(int nin, void *vin, int enc, int *nout, void *vout)
+{
+  COO_TYPE *vin_ = vin, *vals;
+  unsigned char *iend, *ip;
+  int i, k = 0, prev = -1;
+
+  COO_OUT_BEGIN(vout, nout, vals, iend, ip);
+
+  for (i = 0; i < nin; i++)
+  {
+    if (vin_[i] == 0) continue;
+
+    COO_PUSH(i, vin_[i]);
+  }
+
+  *nout = coo_finish(vout, nin, k, enc, sizeof(COO_TYPE), iend, ip);
+}
+
+
+static void MOD_COO(uncompress)(int nin, void *vin, int *nout, void *vout)
+{
+  dblv_coo_header *h = vin;
+  COO_TYPE *vals = COO_VALUES(vin), *vout_ = vout;
+  const unsigned char *ip = COO_INDEX(vin, sizeof(COO_TYPE));
+  int k, i = -1;
+
+  memset(vout, 0, h->n * sizeof(COO_TYPE));
+
+  for (k = 0; k < h->nnz; k++)
+  {
+    i = coo_get_index(&ip, h->enc, i);
+    vout_[i] = vals[k];
+  }
+
+  if (nout) *nout = h->n;
+}
+
+
+static void MOD_COO(co_uc_add2_uc)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void *vout)
+{
+  dblv_coo_header *h = vin0;
+  COO_TYPE *vals = COO_VALUES(vin0), *vout_ = vout;
+  const unsigned char *ip = COO_INDEX(vin0, sizeof(COO_TYPE));
+  int k, i = -1;
+#ifndef COO_OP0_IDENTITY
+  COO_TYPE *vin1_ = vin1;
+  int j = 0;
+#endif
+
+#ifdef COO_OP0_IDENTITY
+  /* only the elements of the index-value operand are touched */
+  if (vout != vin1) memcpy(vout, vin1, nin1 * sizeof(COO_TYPE));
+
+  for (k = 0; k < h->nnz; k++)
+  {
+    i = coo_get_index(&ip, h->enc, i);
+    vout_[i] = COO_OP(vals[k], vout_[i]);
+  }
+#else
+  for (k = 0; k < h->nnz; k++)
+  {
+    i = coo_get_index(&ip, h->enc, i);
+    for (; j < i; j++) vout_[j] = COO_OP0(vin1_[j]);
+    vout_[i] = COO_OP(vals[k], vin1_[i]);
+    j = i + 1;
+  }
+  for (; j < nin1; j++) vout_[j] = COO_OP0(vin1_[j]);
+#endif
+
+  if (nout) *nout = nin1;
+}
+
+
+static void MOD_COO(co_uc_add2_co)(int nin0, void *vin0, int nin1, void *vin1, int enc, int *nout, void *vout)
+{
+  dblv_coo_header *h0 = vin0;
+  COO_TYPE *vals0 = COO_VALUES(vin0), *vin1_ = vin1, *vals, v;
+  const unsigned char *ip0 = COO_INDEX(vin0, sizeof(COO_TYPE));
+  unsigned char *iend, *ip;
+  int i, i0, k0 = 0, k = 0, prev = -1;
+
+  COO_OUT_BEGIN(vout, nout, vals, iend, ip);
+
+  i0 = (h0->nnz > 0)?coo_get_index(&ip0, h0->enc, -1):nin1;
+
+  for (i = 0; i < nin1; i++)
+  {
+    if (i == i0)
+    {
+      v = COO_OP(vals0[k0], vin1_[i]);
+      k0++;
+      i0 = (k0 < h0->nnz)?coo_get_index(&ip0, h0->enc, i0):nin1;
+
+    } else v = COO_OP0(vin1_[i]);
+
+    if (v != 0) COO_PUSH(i, v);
+  }
+
+  *nout = coo_finish(vout, nin1, k, enc, sizeof(COO_TYPE), iend, ip);
+}
+
+
+static void MOD_COO(co_co_add2_co)(int nin0, void *vin0, int nin1, void *vin1, int enc, int *nout, void *vout)
+{
+  dblv_coo_header *h0 = vin0, *h1 = vin1;
+  COO_TYPE *vals0 = COO_VALUES(vin0), *vals1 = COO_VALUES(vin1), *vals, v;
+  const unsigned char *ip0 = COO_INDEX(vin0, sizeof(COO_TYPE)), *ip1 = COO_INDEX(vin1, sizeof(COO_TYPE));
+  unsigned char *iend, *ip;
+  int i, i0, i1, k0 = 0, k1 = 0, k = 0, prev = -1;
+
+  COO_OUT_BEGIN(vout, nout, vals, iend, ip);
+
+  i0 = (h0->nnz > 0)?coo_get_index(&ip0, h0->enc, -1):INT_MAX;
+  i1 = (h1->nnz > 0)?coo_get_index(&ip1, h1->enc, -1):INT_MAX;
+
+  while (i0 < INT_MAX || i1 < INT_MAX)
+  {
+    if (i0 == i1)
+    {
+      i = i0;
+      v = COO_OP(vals0[k0], vals1[k1]);
+      k0++; i0 = (k0 < h0->nnz)?coo_get_index(&ip0, h0->enc, i0):INT_MAX;
+      k1++; i1 = (k1 < h1->nnz)?coo_get_index(&ip1, h1->enc, i1):INT_MAX;
+
+    } else if (i0 < i1)
+    {
+      i = i0;
+      v = COO_OP0(vals0[k0]);
+      k0++; i0 = (k0 < h0->nnz)?coo_get_index(&ip0, h0->enc, i0):INT_MAX;
+
+    } else
+    {
+      i = i1;
+      v = COO_OP0(vals1[k1]);
+      k1++; i1 = (k1 < h1->nnz)?coo_get_index(&ip1, h1->enc, i1):INT_MAX;
+    }
+
+    if (v != 0) COO_PUSH(i, v);
+  }
+
+  *nout = coo_finish(vout, (h0->n > h1->n)?h0->n:h1->n, k, enc, sizeof(COO_TYPE), iend, ip);
+}
+
+
+static void MOD_COO(co_cf_add2_co)(int nin0, void *vin0, int nin1, void *vin1, int enc, int *nout, void *vout)
+{
+  dblv_coo_header *h0 = vin0;
+  COO_TYPE *vals0 = COO_VALUES(vin0), *vin1_ = vin1, *vals, v;
+  const unsigned char *ip0 = COO_INDEX(vin0, sizeof(COO_TYPE));
+  unsigned char *iend, *ip;
+  int j, p = 0, i0, k0 = 0, k = 0, prev = -1;
+
+  COO_OUT_BEGIN(vout, nout, vals, iend, ip);
+
+  i0 = (h0->nnz > 0)?coo_get_index(&ip0, h0->enc, -1):INT_MAX;
+
+  for (j = 0; j < nin1; j++)
+  {
+    if (!COO_ISN_NAN_P(&vin1_[j]))
+    {
+      p += (int) COO_RLE_GET_P(&vin1_[j]);
+      continue;
+    }
+
+    /* elements of the index-value operand in front of p (i.e., also in zero runs) */
+    while (i0 < p)
+    {
+      v = COO_OP0(vals0[k0]);
+      if (v != 0) COO_PUSH(i0, v);
+      k0++; i0 = (k0 < h0->nnz)?coo_get_index(&ip0, h0->enc, i0):INT_MAX;
+    }
+
+    if (i0 == p)
+    {
+      v = COO_OP(vals0[k0], vin1_[j]);
+      k0++; i0 = (k0 < h0->nnz)?coo_get_index(&ip0, h0->enc, i0):INT_MAX;
+
+    } else v = COO_OP0(vin1_[j]);
+
+    if (v != 0) COO_PUSH(p, v);
+
+    p++;
+  }
+
+  while (i0 < INT_MAX)
+  {
+    v = COO_OP0(vals0[k0]);
+    if (v != 0) COO_PUSH(i0, v);
+    k0++; i0 = (k0 < h0->nnz)?coo_get_index(&ip0, h0->enc, i0):INT_MAX;
+  }
+
+  *nout = coo_finish(vout, (h0->n > p)?h0->n:p, k, enc, sizeof(COO_TYPE), iend, ip);
+}
+
+
+static const dblv_coo_ops MOD_COO(dblv_coo_ops) =
+{
+  sizeof(COO_TYPE),
+  MOD_COO(compress),
+  MOD_COO(uncompress),
+  MOD_COO(co_uc_add2_uc),
+  MOD_COO(co_uc_add2_co),
+  MOD_COO(co_co_add2_co),
+  MOD_COO(co_cf_add2_co),
+};
@@ -36,5 +36,56 @@ typedef uint64_t dblv_int64;
 #define DBL_RLE2_SET_P(pv, m)    (*((dblv_int64 *) (pv)) = ((m)>1)?(((dblv_int64) (m)) | (dblv_int64) ~DBL_FRACTION_MASK):0)
 #define DBL_RLE_GET_P(pv)        (*((dblv_int64 *) (pv)) & (dblv_int64) DBL_FRACTION_MASK)
 
+/* the largest run length a single token can hold */
+#define DBL_RLE_MAX              DBL_FRACTION_MASK
+
+
+typedef uint32_t dblv_int32;
+
+#define FLT_NAN_MASK       0x7F800000U
+#define FLT_FRACTION_MASK  0x007FFFFFU
+
+#define FLT_IS_NAN_P(pv)         ((*((dblv_int32 *) (pv)) & FLT_NAN_MASK) == FLT_NAN_MASK)
+#define FLT_ISN_NAN_P(pv)        ((*((dblv_int32 *) (pv)) & FLT_NAN_MASK) != FLT_NAN_MASK)
+
+#define FLT_RLE_SET_P(pv, m)     (*((dblv_int32 *) (pv)) = (((dblv_int32) (m)) | (dblv_int32) ~FLT_FRACTION_MASK))
+#define FLT_RLE2_SET_P(pv, m)    (*((dblv_int32 *) (pv)) = ((m)>1)?(((dblv_int32) (m)) | (dblv_int32) ~FLT_FRACTION_MASK):0)
+#define FLT_RLE_GET_P(pv)        (*((dblv_int32 *) (pv)) & (dblv_int32) FLT_FRACTION_MASK)
+
+/* runs longer than 2^23-1 zeros are split into several tokens */
+#define FLT_RLE_MAX              FLT_FRACTION_MASK
+
+
+/* Integers have no NaNs, zero runs are encoded as values of a reserved range at the lower end of the type with the
+   run length in the lower bits, i.e., [INT32_MIN, INT32_MIN + 2^24) and [INT64_MIN, INT64_MIN + 2^48). Vectors that
+   contain values of this range (as operands or results) can not be compressed. */
+
+#define I32_TOKEN_MASK     0xFF000000U
+#define I32_TOKEN          0x80000000U
+#define I32_COUNT_MASK     0x00FFFFFFU
+
+#define I32_IS_RLE_P(pv)         ((*((dblv_int32 *) (pv)) & I32_TOKEN_MASK) == I32_TOKEN)
+#define I32_ISN_RLE_P(pv)        ((*((dblv_int32 *) (pv)) & I32_TOKEN_MASK) != I32_TOKEN)
+
+#define I32_RLE_SET_P(pv, m)     (*((dblv_int32 *) (pv)) = (((dblv_int32) (m)) | I32_TOKEN))
+#define I32_RLE2_SET_P(pv, m)    (*((dblv_int32 *) (pv)) = ((m)>1)?(((dblv_int32) (m)) | I32_TOKEN):0)
+#define I32_RLE_GET_P(pv)        (*((dblv_int32 *) (pv)) & I32_COUNT_MASK)
+
+#define I32_RLE_MAX              I32_COUNT_MASK
+
+
+#define I64_TOKEN_MASK     0xFFFF000000000000LLU
+#define I64_TOKEN          0x8000000000000000LLU
+#define I64_COUNT_MASK     0x0000FFFFFFFFFFFFLLU
+
+#define I64_IS_RLE_P(pv)         ((*((dblv_int64 *) (pv)) & I64_TOKEN_MASK) == I64_TOKEN)
+#define I64_ISN_RLE_P(pv)        ((*((dblv_int64 *) (pv)) & I64_TOKEN_MASK) != I64_TOKEN)
+
+#define I64_RLE_SET_P(pv, m)     (*((dblv_int64 *) (pv)) = (((dblv_int64) (m)) | I64_TOKEN))
+#define I64_RLE2_SET_P(pv, m)    (*((dblv_int64 *) (pv)) = ((m)>1)?(((dblv_int64) (m)) | I64_TOKEN):0)
+#define I64_RLE_GET_P(pv)        (*((dblv_int64 *) (pv)) & I64_COUNT_MASK)
+
+#define I64_RLE_MAX              I64_COUNT_MASK
+
 
 #endif /* __DBLV_RLE_H__ */
@@ -23,6 +23,7 @@
 
 #include "dblv.h"
 #include "dblv_rle.h"
+#include "dblv_simd.h"
 
 
 void dblv_rle_zero_compress(int nin, double *vin, int *nout, double *vout)
@@ -32,6 +33,9 @@ void dblv_rle_zero_compress(int nin, double *vin, int *nout, double *vout)
 
   int nout_; if (!nout) nout = &nout_;
 
+  /* the output of the unbounded variants never exceeds nin */
+  DBLV_SIMD_DISPATCH(dblv_rle_zero_compress3, (nin, vin, nin, vout, NULL, nout));
+
   DBLV_TSTART();
   while (m < nin)
   {
@@ -71,6 +75,9 @@ void dblv_rle_zero_compress2(int nin, double *vin, int *nout, double *vout)
 
   int nout_; if (!nout) nout = &nout_;
 
+  /* the output of the unbounded variants never exceeds nin */
+  DBLV_SIMD_DISPATCH(dblv_rle_zero_compress3, (nin, vin, nin, vout, NULL, nout));
+
   DBLV_TSTART();
   while (m < nin)
   {
@@ -107,6 +114,8 @@ void dblv_rle_zero_compress3(int nin, double *vin, int nout, double *vout, int *
   double *vout_c = vout;
   double *vout_e = vout + nout;
 
+  DBLV_SIMD_DISPATCH(dblv_rle_zero_compress3, (nin, vin, nout, vout, nread, nwrite));
+
   DBLV_TSTART();
   while (vin_c < vin_e && vout_c < vout_e)
   {
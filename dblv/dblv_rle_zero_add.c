@@ -23,6 +23,37 @@
 
 #include "dblv.h"
 #include "dblv_rle.h"
+#include "dblv_simd.h"
+
+
+/* The SIMD kernels pay off for long literal stretches and long runs. For mixed data with short spans
+   (e.g. random 10-50% density) the scalar kernels are faster, so a small prefix of the compressed operand
+   is sampled: the SIMD kernels are used if it contains no run tokens or covers at least min_span
+   uncompressed elements per compressed element. Kernels with compressed output recompress the dense operand
+   inside each run and need longer spans to amortize the scans. */
+
+#define RLE_SIMD_SAMPLE       64
+#define RLE_SIMD_MIN_SPAN_UC  4
+#define RLE_SIMD_MIN_SPAN_CF  8
+
+static int rle_zero_simd_profitable(int nin, double *vin, int min_span)
+{
+  int i, n = (nin < RLE_SIMD_SAMPLE)?nin:RLE_SIMD_SAMPLE;
+  long span = 0;
+  int tokens = 0;
+
+  for (i = 0; i < n; i++)
+  {
+    if (DBL_ISN_NAN_P(vin + i)) span++;
+    else
+    {
+      span += DBL_RLE_GET_P(vin + i);
+      tokens++;
+    }
+  }
+
+  return (tokens == 0 || span >= (long) min_span * n);
+}
 
 
 void dblv_rle_zero_cf_uc_add2_cb(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout)
@@ -31,6 +62,8 @@ void dblv_rle_zero_cf_uc_add2_cb(int nin0, double *vin0, int nin1, double *vin1,
 
   double *vin0_, *vin1_, *vout_;
 
+  if (rle_zero_simd_profitable(nin0, vin0, RLE_SIMD_MIN_SPAN_CF)) DBLV_SIMD_DISPATCH(dblv_rle_zero_cf_uc_add2_cb, (nin0, vin0, nin1, vin1, nout, vout));
+
   vin0_ = vin0 + nin0 - 1;
   vin1_ = vin1 + nin1 - 1;
   vout_ = vin0 + *nout - 1;
@@ -80,6 +113,8 @@ void dblv_rle_zero_cf_uc_add2_ub(int nin0, double *vin0, int nin1, double *vin1,
 
   double *vin0_, *vin1_, *vout_;
 
+  if (rle_zero_simd_profitable(nin0, vin0, RLE_SIMD_MIN_SPAN_UC)) DBLV_SIMD_DISPATCH(dblv_rle_zero_cf_uc_add2_ub, (nin0, vin0, nin1, vin1, nout, vout));
+
   vin0_ = vin0 + nin0 - 1;
   vin1_ = vin1 + nin1 - 1;
   vout_ = vin0 + *nout - 1;
@@ -111,6 +146,8 @@ void dblv_rle_zero_uc_cf_add2_uc(int nin0, double *vin0, int nin1, double *vin1,
 
   double *vin0_, *vin1_, *vout_;
 
+  if (rle_zero_simd_profitable(nin1, vin1, RLE_SIMD_MIN_SPAN_UC)) DBLV_SIMD_DISPATCH(dblv_rle_zero_uc_cf_add2_uc, (nin0, vin0, nin1, vin1, nout, vout));
+
   vin0_ = vin0 + nin0 - 1;
   vin1_ = vin1 + nin1 - 1;
   vout_ = vin0 + *nout - 1;
@@ -172,6 +209,147 @@ void dblv_rle_zero_uc_uc_add2_cf(int nin0, double *vin0, int nin1, double *vin1,
 }
 
 
+/* both operands and the output are compressed, zero runs of both operands are merged without expanding them,
+   the output needs space for the uncompressed result */
+void dblv_rle_zero_cf_cf_add2_cf(int nin0, double *vin0, int nin1, double *vin1, int *nout, double *vout)
+{
+  int i0 = 0, i1 = 0, o = 0;
+  long r0 = 0, r1 = 0, m, zeros = 0;
+  double v;
+
+  while (1)
+  {
+    /* enter the next zero runs */
+    if (r0 == 0 && i0 < nin0 && DBL_IS_NAN_P(&vin0[i0])) { r0 = DBL_RLE_GET_P(&vin0[i0]); i0++; continue; }
+    if (r1 == 0 && i1 < nin1 && DBL_IS_NAN_P(&vin1[i1])) { r1 = DBL_RLE_GET_P(&vin1[i1]); i1++; continue; }
+
+    if (r0 > 0 || i0 >= nin0)
+    {
+      if (r1 > 0 || i1 >= nin1)
+      {
+        if (r0 == 0 && r1 == 0) break;
+
+        /* zeros in both */
+        m = (r0 == 0)?r1:((r1 == 0)?r0:((r0 < r1)?r0:r1));
+        zeros += m;
+        if (r0 > 0) r0 -= m;
+        if (r1 > 0) r1 -= m;
+        continue;
+      }
+
+      v = vin1[i1++];
+      if (r0 > 0) r0--;
+
+    } else if (r1 > 0 || i1 >= nin1)
+    {
+      v = vin0[i0++];
+      if (r1 > 0) r1--;
+
+    } else v = vin0[i0++] + vin1[i1++];
+
+    if (v == 0.0)
+    {
+      zeros++;
+      continue;
+    }
+
+    if (zeros > 0)
+    {
+      DBL_RLE2_SET_P(&vout[o], zeros);
+      o++;
+      zeros = 0;
+    }
+
+    vout[o++] = v;
+  }
+
+  if (zeros > 0)
+  {
+    DBL_RLE2_SET_P(&vout[o], zeros);
+    o++;
+  }
+
+  *nout = o;
+}
+
+/* bounded variant of cf_cf_add2_cf: stops if an operand is exhausted or the output is full, unfinished zero runs
+   of the operands are carried to the next call in vin0_next/vin1_next (initialized with 0, the merge is complete
+   if both operands are read and both carries are 0 again), pending zeros of the output are written at the end of
+   every call */
+void dblv_rle_zero_cf_cf_add3_cf(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next, double *vin1_next)
+{
+  int i0 = 0, i1 = 0, o = 0;
+  long r0 = 0, r1 = 0, m, zeros = 0;
+  double v;
+
+  if (DBL_IS_NAN_P(vin0_next)) r0 = DBL_RLE_GET_P(vin0_next);
+  if (DBL_IS_NAN_P(vin1_next)) r1 = DBL_RLE_GET_P(vin1_next);
+
+  while (1)
+  {
+    /* enter the next zero runs */
+    if (r0 == 0 && i0 < nin0 && DBL_IS_NAN_P(&vin0[i0])) { r0 = DBL_RLE_GET_P(&vin0[i0]); i0++; continue; }
+    if (r1 == 0 && i1 < nin1 && DBL_IS_NAN_P(&vin1[i1])) { r1 = DBL_RLE_GET_P(&vin1[i1]); i1++; continue; }
+
+    if ((r0 == 0 && i0 >= nin0) || (r1 == 0 && i1 >= nin1)) break;
+
+    /* a new zero run of the output needs space for its token */
+    if (r0 > 0 && r1 > 0)
+    {
+      if (zeros == 0 && o >= nout) break;
+
+      /* zeros in both */
+      m = (r0 < r1)?r0:r1;
+      zeros += m;
+      r0 -= m;
+      r1 -= m;
+      continue;
+    }
+
+    if (r0 > 0) v = vin1[i1];
+    else if (r1 > 0) v = vin0[i0];
+    else v = vin0[i0] + vin1[i1];
+
+    if (v == 0.0)
+    {
+      if (zeros == 0 && o >= nout) break;
+      zeros++;
+
+    } else
+    {
+      if (o + (zeros > 0) + 1 > nout) break;
+
+      if (zeros > 0)
+      {
+        DBL_RLE2_SET_P(&vout[o], zeros);
+        o++;
+        zeros = 0;
+      }
+
+      vout[o++] = v;
+    }
+
+    if (r0 > 0) { r0--; i1++; }
+    else if (r1 > 0) { r1--; i0++; }
+    else { i0++; i1++; }
+  }
+
+  if (zeros > 0)
+  {
+    DBL_RLE2_SET_P(&vout[o], zeros);
+    o++;
+  }
+
+  *vin0_next = 0;
+  if (r0 > 0) DBL_RLE_SET_P(vin0_next, r0);
+  *vin1_next = 0;
+  if (r1 > 0) DBL_RLE_SET_P(vin1_next, r1);
+
+  if (nread0) *nread0 = i0;
+  if (nread1) *nread1 = i1;
+  if (nwrite) *nwrite = o;
+}
+
 void dblv_rle_zero_cf_uc_add3_cf(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next)
 {
   double *vin0_c = vin0;
@@ -183,6 +361,8 @@ void dblv_rle_zero_cf_uc_add3_cf(int nin0, double *vin0, int nin1, double *vin1,
   double *vout_e = vout + nout;
   int n;
 
+  if (rle_zero_simd_profitable(nin0, vin0, RLE_SIMD_MIN_SPAN_CF)) DBLV_SIMD_DISPATCH(dblv_rle_zero_cf_uc_add3_cf, (nin0, vin0, nin1, vin1, nout, vout, nread0, nread1, nwrite, vin0_next));
+
   if (DBL_IS_NAN_P(vin0_next))
   {
     n = DBL_RLE_GET_P(vin0_next);
@@ -260,6 +440,8 @@ void dblv_rle_zero_cf_uc_add3_uc(int nin0, double *vin0, int nin1, double *vin1,
   double *vout_e = vout + nout;
   int n;
 
+  if (rle_zero_simd_profitable(nin0, vin0, RLE_SIMD_MIN_SPAN_UC)) DBLV_SIMD_DISPATCH(dblv_rle_zero_cf_uc_add3_uc, (nin0, vin0, nin1, vin1, nout, vout, nread0, nread1, nwrite, vin0_next));
+
   if (DBL_IS_NAN_P(vin0_next))
   {
     n = DBL_RLE_GET_P(vin0_next);
@@ -0,0 +1,312 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dblv.h"
+#include "dblv_rle.h"
+#include "dblv_simd.h"
+#include "dblv_simd_scan.h"
+
+
+#ifndef MOD_SIMD
+ #define MOD_SIMD(s)  s##_avx2
+ #define SIMD_TARGET  DBLV_TARGET_AVX2
+#endif
+
+
+#ifdef DBLV_SIMD
+
+/* Vectorized variants of the fused decode-and-add kernels in dblv_rle_zero_add.c. Literal stretches of the
+   compressed operand are located with a vector scan for NaN-tagged tokens and summed with wide adds, run
+   tokens are handled with a single block copy (or a recompression of the dense operand for compressed
+   output). Additions keep the operand order of the scalar kernels, so results are bit-identical. */
+
+SIMD_TARGET void MOD_SIMD(dblv_rle_zero_cf_uc_add2_cb)(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout)
+{
+  int i0 = nin0 - 1, i1 = nin1 - 1, o = *nout - 1;
+  int j, l, lo;
+
+  while (i1 >= 0)
+  {
+    if (DBL_ISN_NAN_P(vin0 + i0))
+    {
+      /* isolated literals are added without a scan, longer stretches are bounded by the dense operand */
+      if (i0 > 0 && i1 > 0 && DBL_ISN_NAN_P(vin0 + i0 - 1))
+      {
+        j = MOD_SIMD(dblv_token_bwd)(vin0, (i0 > i1)?(i0 - i1):0, i0);
+        l = i0 - j + 1;
+
+        MOD_SIMD(dblv_add_bwd)(vin0 + o - l + 1, vin0 + i0 - l + 1, vin1 + i1 - l + 1, l);
+
+      } else
+      {
+        vin0[o] = vin0[i0] + vin1[i1];
+        l = 1;
+      }
+
+      i0 -= l; i1 -= l; o -= l;
+      continue;
+    }
+
+    /* recompress vin1[lo..i1] backward */
+    lo = i1 - DBL_RLE_GET_P(vin0 + i0) + 1;
+    i0--;
+
+    while (i1 >= lo)
+    {
+      if (vin1[i1] != 0.0)
+      {
+        if (i1 > lo && vin1[i1 - 1] != 0.0)
+        {
+          j = MOD_SIMD(dblv_nonzero_bwd)(vin1, lo, i1);
+          l = i1 - j + 1;
+
+          memcpy(vin0 + o - l + 1, vin1 + j, l * sizeof(double));
+
+        } else
+        {
+          vin0[o] = vin1[i1];
+          l = 1;
+        }
+
+        o -= l; i1 -= l;
+        continue;
+      }
+
+      j = (i1 > lo && vin1[i1 - 1] == 0.0)?MOD_SIMD(dblv_zero_bwd)(vin1, lo, i1):i1;
+
+      DBL_RLE2_SET_P(vin0 + o, i1 - j + 1);
+      o--; i1 = j - 1;
+    }
+  }
+
+  *nout -= o + 1;
+  *vout = vin0 + o + 1;
+}
+
+
+SIMD_TARGET void MOD_SIMD(dblv_rle_zero_cf_uc_add2_ub)(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout)
+{
+  int i0 = nin0 - 1, i1 = nin1 - 1, o = *nout - 1;
+  int j, l;
+
+  while (i1 >= 0)
+  {
+    if (DBL_ISN_NAN_P(vin0 + i0))
+    {
+      /* isolated literals are added without a scan, longer stretches are bounded by the dense operand */
+      if (i0 > 0 && i1 > 0 && DBL_ISN_NAN_P(vin0 + i0 - 1))
+      {
+        j = MOD_SIMD(dblv_token_bwd)(vin0, (i0 > i1)?(i0 - i1):0, i0);
+        l = i0 - j + 1;
+
+        MOD_SIMD(dblv_add_bwd)(vin0 + o - l + 1, vin0 + i0 - l + 1, vin1 + i1 - l + 1, l);
+
+      } else
+      {
+        vin0[o] = vin0[i0] + vin1[i1];
+        l = 1;
+      }
+
+      i0 -= l; i1 -= l; o -= l;
+      continue;
+    }
+
+    l = DBL_RLE_GET_P(vin0 + i0);
+    i0--;
+
+    memcpy(vin0 + o - l + 1, vin1 + i1 - l + 1, l * sizeof(double));
+    i1 -= l; o -= l;
+  }
+
+  *nout -= o + 1;
+  if (vout) *vout = vin0 + o + 1;
+}
+
+
+SIMD_TARGET void MOD_SIMD(dblv_rle_zero_uc_cf_add2_uc)(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout)
+{
+  int i0 = nin0 - 1, i1 = nin1 - 1, o = *nout - 1;
+  int j, l;
+
+  while (i0 >= 0)
+  {
+    if (DBL_ISN_NAN_P(vin1 + i1))
+    {
+      if (i1 > 0 && i0 > 0 && DBL_ISN_NAN_P(vin1 + i1 - 1))
+      {
+        j = MOD_SIMD(dblv_token_bwd)(vin1, (i1 > i0)?(i1 - i0):0, i1);
+        l = i1 - j + 1;
+
+        MOD_SIMD(dblv_add_bwd)(vin0 + o - l + 1, vin0 + i0 - l + 1, vin1 + i1 - l + 1, l);
+
+      } else
+      {
+        vin0[o] = vin0[i0] + vin1[i1];
+        l = 1;
+      }
+
+      i0 -= l; i1 -= l; o -= l;
+      continue;
+    }
+
+    l = DBL_RLE_GET_P(vin1 + i1);
+    i1--;
+
+    /* in-place (o == i0) is the common case and needs no copy */
+    if (o != i0) memmove(vin0 + o - l + 1, vin0 + i0 - l + 1, l * sizeof(double));
+    i0 -= l; o -= l;
+  }
+
+  *nout -= o + 1;
+  if (vout) *vout = vin0 + o + 1;
+}
+
+
+SIMD_TARGET void MOD_SIMD(dblv_rle_zero_cf_uc_add3_cf)(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next)
+{
+  int i0 = 0, i1 = 0, o = 0;
+  int l, n, r, w;
+
+  if (DBL_IS_NAN_P(vin0_next))
+  {
+    n = DBL_RLE_GET_P(vin0_next);
+
+    if (n > 0 && i1 < nin1 && o < nout)
+    {
+      MOD_SIMD(dblv_rle_zero_compress3)((n < nin1 - i1)?n:(nin1 - i1), vin1 + i1, nout - o, vout + o, &r, &w);
+      i1 += r; o += w; n -= r;
+    }
+
+    *vin0_next = 0.0;
+    if (n > 0) DBL_RLE_SET_P(vin0_next, n);
+  }
+
+  while (i0 < nin0 && i1 < nin1 && o < nout)
+  {
+    if (DBL_ISN_NAN_P(vin0 + i0))
+    {
+      l = nin1 - i1;
+      if (l > nout - o) l = nout - o;
+      if (l > nin0 - i0) l = nin0 - i0;
+
+      if (l > 1 && DBL_ISN_NAN_P(vin0 + i0 + 1))
+      {
+        l = MOD_SIMD(dblv_token_fwd)(vin0, i0, i0 + l) - i0;
+
+        MOD_SIMD(dblv_add_fwd)(vout + o, vin0 + i0, vin1 + i1, l);
+
+      } else
+      {
+        vout[o] = vin0[i0] + vin1[i1];
+        l = 1;
+      }
+
+      i0 += l; i1 += l; o += l;
+      continue;
+    }
+
+    n = DBL_RLE_GET_P(vin0 + i0);
+    i0++;
+
+    if (n > 0 && i1 < nin1 && o < nout)
+    {
+      MOD_SIMD(dblv_rle_zero_compress3)((n < nin1 - i1)?n:(nin1 - i1), vin1 + i1, nout - o, vout + o, &r, &w);
+      i1 += r; o += w; n -= r;
+    }
+
+    *vin0_next = 0.0;
+    if (n > 0) DBL_RLE_SET_P(vin0_next, n);
+  }
+
+  if (nread0) *nread0 = i0;
+  if (nread1) *nread1 = i1;
+  if (nwrite) *nwrite = o;
+}
+
+
+SIMD_TARGET void MOD_SIMD(dblv_rle_zero_cf_uc_add3_uc)(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next)
+{
+  int i0 = 0, i1 = 0, o = 0;
+  int l, n;
+
+  if (DBL_IS_NAN_P(vin0_next))
+  {
+    n = DBL_RLE_GET_P(vin0_next);
+
+    l = n;
+    if (l > nin1 - i1) l = nin1 - i1;
+    if (l > nout - o) l = nout - o;
+
+    memmove(vout + o, vin1 + i1, l * sizeof(double));
+    i1 += l; o += l; n -= l;
+
+    *vin0_next = 0.0;
+    if (n > 0) DBL_RLE_SET_P(vin0_next, n);
+  }
+
+  while (i0 < nin0 && i1 < nin1 && o < nout)
+  {
+    if (DBL_ISN_NAN_P(vin0 + i0))
+    {
+      l = nin1 - i1;
+      if (l > nout - o) l = nout - o;
+      if (l > nin0 - i0) l = nin0 - i0;
+
+      if (l > 1 && DBL_ISN_NAN_P(vin0 + i0 + 1))
+      {
+        l = MOD_SIMD(dblv_token_fwd)(vin0, i0, i0 + l) - i0;
+
+        MOD_SIMD(dblv_add_fwd)(vout + o, vin0 + i0, vin1 + i1, l);
+
+      } else
+      {
+        vout[o] = vin0[i0] + vin1[i1];
+        l = 1;
+      }
+
+      i0 += l; i1 += l; o += l;
+      continue;
+    }
+
+    n = DBL_RLE_GET_P(vin0 + i0);
+    i0++;
+
+    l = n;
+    if (l > nin1 - i1) l = nin1 - i1;
+    if (l > nout - o) l = nout - o;
+
+    memmove(vout + o, vin1 + i1, l * sizeof(double));
+    i1 += l; o += l; n -= l;
+
+    *vin0_next = 0.0;
+    if (n > 0) DBL_RLE_SET_P(vin0_next, n);
+  }
+
+  if (nread0) *nread0 = i0;
+  if (nread1) *nread1 = i1;
+  if (nwrite) *nwrite = o;
+}
+
+#endif /* DBLV_SIMD */
@@ -0,0 +1,30 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dblv_simd.h"
+
+#ifdef DBLV_SIMD
+ #define MOD_SIMD(s)  s##_avx512
+ #define SIMD_TARGET  DBLV_TARGET_AVX512
+#endif
+
+
+#include "dblv_rle_zero_add_simd.c"
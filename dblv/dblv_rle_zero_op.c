@@ -0,0 +1,291 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "dblv.h"
+#include "dblv_rle.h"
+
+
+/* double/sum uses the (SIMD-dispatched) kernels of dblv_rle_zero.c and dblv_rle_zero_add.c */
+
+static void dbl_sum_compress(int nin, void *vin, int *nout, void *vout)
+{
+  dblv_rle_zero_compress2(nin, vin, nout, vout);
+}
+
+static void dbl_sum_compress3(int nin, void *vin, int nout, void *vout, int *nread, int *nwrite)
+{
+  dblv_rle_zero_compress3(nin, vin, nout, vout, nread, nwrite);
+}
+
+static void dbl_sum_uncompress(int nin, void *vin, int *nout, void *vout)
+{
+  dblv_rle_zero_uncompress2(nin, vin, nout, vout);
+}
+
+static void dbl_sum_cf_uc_add2_cb(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  dblv_rle_zero_cf_uc_add2_cb(nin0, vin0, nin1, vin1, nout, (double **) vout);
+}
+
+static void dbl_sum_cf_uc_add2_ub(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  dblv_rle_zero_cf_uc_add2_ub(nin0, vin0, nin1, vin1, nout, (double **) vout);
+}
+
+static void dbl_sum_uc_cf_add2_uc(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  dblv_rle_zero_uc_cf_add2_uc(nin0, vin0, nin1, vin1, nout, (double **) vout);
+}
+
+static void dbl_sum_uc_uc_add2_cf(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  double *vout_;
+
+  dblv_rle_zero_uc_uc_add2_cf(nin0, vin0, nin1, vin1, nout, &vout_);
+
+  if (vout) *vout = vout_;
+}
+
+static void dbl_sum_cf_uc_add3_cf(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next)
+{
+  dblv_rle_zero_cf_uc_add3_cf(nin0, vin0, nin1, vin1, nout, vout, nread0, nread1, nwrite, vin0_next);
+}
+
+static void dbl_sum_cf_uc_add3_uc(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next)
+{
+  dblv_rle_zero_cf_uc_add3_uc(nin0, vin0, nin1, vin1, nout, vout, nread0, nread1, nwrite, vin0_next);
+}
+
+static void dbl_sum_cf_cf_add2_cf(int nin0, void *vin0, int nin1, void *vin1, int *nout, void *vout)
+{
+  dblv_rle_zero_cf_cf_add2_cf(nin0, vin0, nin1, vin1, nout, vout);
+}
+
+static void dbl_sum_cf_cf_add3_cf(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next, void *vin1_next)
+{
+  dblv_rle_zero_cf_cf_add3_cf(nin0, vin0, nin1, vin1, nout, vout, nread0, nread1, nwrite, vin0_next, vin1_next);
+}
+
+
+#define RLE_OP_SUM(a, b)  ((a) + (b))
+#define RLE_OP0_SUM(a)    (a)
+#define RLE_OP_MAX(a, b)  (((a) > (b))?(a):(b))
+#define RLE_OP0_MAX(a)    (((a) > 0)?(a):0)
+#define RLE_OP_MIN(a, b)  (((a) < (b))?(a):(b))
+#define RLE_OP0_MIN(a)    (((a) < 0)?(a):0)
+
+
+#define RLE_TYPE        double
+#define RLE_IS_NAN_P    DBL_IS_NAN_P
+#define RLE_ISN_NAN_P   DBL_ISN_NAN_P
+#define RLE_RLE_SET_P   DBL_RLE_SET_P
+#define RLE_RLE2_SET_P  DBL_RLE2_SET_P
+#define RLE_RLE_GET_P   DBL_RLE_GET_P
+#define RLE_RLE_MAX     DBL_RLE_MAX
+
+#define MOD_RLE(s)      dbl_max_##s
+#define RLE_OP          RLE_OP_MAX
+#define RLE_OP0         RLE_OP0_MAX
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      dbl_min_##s
+#define RLE_OP          RLE_OP_MIN
+#define RLE_OP0         RLE_OP0_MIN
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+/* double/sum seeks with the kernel of double/max (seeking does not depend on the operator) */
+static const dblv_rle_ops dbl_sum_dblv_rle_zero_ops =
+{
+  sizeof(double),
+  dbl_sum_compress,
+  dbl_sum_compress3,
+  dbl_sum_uncompress,
+  dbl_max_seek,
+  dbl_sum_cf_uc_add2_cb,
+  dbl_sum_cf_uc_add2_ub,
+  dbl_sum_uc_cf_add2_uc,
+  dbl_sum_uc_uc_add2_cf,
+  dbl_sum_cf_uc_add3_cf,
+  dbl_sum_cf_uc_add3_uc,
+  dbl_sum_cf_cf_add2_cf,
+  dbl_sum_cf_cf_add3_cf,
+};
+
+#undef RLE_TYPE
+#undef RLE_IS_NAN_P
+#undef RLE_ISN_NAN_P
+#undef RLE_RLE_SET_P
+#undef RLE_RLE2_SET_P
+#undef RLE_RLE_GET_P
+#undef RLE_RLE_MAX
+
+
+#define RLE_TYPE        float
+#define RLE_IS_NAN_P    FLT_IS_NAN_P
+#define RLE_ISN_NAN_P   FLT_ISN_NAN_P
+#define RLE_RLE_SET_P   FLT_RLE_SET_P
+#define RLE_RLE2_SET_P  FLT_RLE2_SET_P
+#define RLE_RLE_GET_P   FLT_RLE_GET_P
+#define RLE_RLE_MAX     FLT_RLE_MAX
+
+#define MOD_RLE(s)      flt_sum_##s
+#define RLE_OP          RLE_OP_SUM
+#define RLE_OP0         RLE_OP0_SUM
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      flt_max_##s
+#define RLE_OP          RLE_OP_MAX
+#define RLE_OP0         RLE_OP0_MAX
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      flt_min_##s
+#define RLE_OP          RLE_OP_MIN
+#define RLE_OP0         RLE_OP0_MIN
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#undef RLE_TYPE
+#undef RLE_IS_NAN_P
+#undef RLE_ISN_NAN_P
+#undef RLE_RLE_SET_P
+#undef RLE_RLE2_SET_P
+#undef RLE_RLE_GET_P
+#undef RLE_RLE_MAX
+
+
+/* integers use a reserved range of values as tokens (see dblv_rle.h) */
+
+#define RLE_TYPE        int
+#define RLE_IS_NAN_P    I32_IS_RLE_P
+#define RLE_ISN_NAN_P   I32_ISN_RLE_P
+#define RLE_RLE_SET_P   I32_RLE_SET_P
+#define RLE_RLE2_SET_P  I32_RLE2_SET_P
+#define RLE_RLE_GET_P   I32_RLE_GET_P
+#define RLE_RLE_MAX     I32_RLE_MAX
+
+#define MOD_RLE(s)      int_sum_##s
+#define RLE_OP          RLE_OP_SUM
+#define RLE_OP0         RLE_OP0_SUM
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      int_max_##s
+#define RLE_OP          RLE_OP_MAX
+#define RLE_OP0         RLE_OP0_MAX
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      int_min_##s
+#define RLE_OP          RLE_OP_MIN
+#define RLE_OP0         RLE_OP0_MIN
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#undef RLE_TYPE
+#undef RLE_IS_NAN_P
+#undef RLE_ISN_NAN_P
+#undef RLE_RLE_SET_P
+#undef RLE_RLE2_SET_P
+#undef RLE_RLE_GET_P
+#undef RLE_RLE_MAX
+
+
+#define RLE_TYPE        long
+#if LONG_MAX > 2147483647L
+ #define RLE_IS_NAN_P    I64_IS_RLE_P
+ #define RLE_ISN_NAN_P   I64_ISN_RLE_P
+ #define RLE_RLE_SET_P   I64_RLE_SET_P
+ #define RLE_RLE2_SET_P  I64_RLE2_SET_P
+ #define RLE_RLE_GET_P   I64_RLE_GET_P
+ #define RLE_RLE_MAX     I64_RLE_MAX
+#else
+ #define RLE_IS_NAN_P    I32_IS_RLE_P
+ #define RLE_ISN_NAN_P   I32_ISN_RLE_P
+ #define RLE_RLE_SET_P   I32_RLE_SET_P
+ #define RLE_RLE2_SET_P  I32_RLE2_SET_P
+ #define RLE_RLE_GET_P   I32_RLE_GET_P
+ #define RLE_RLE_MAX     I32_RLE_MAX
+#endif
+
+#define MOD_RLE(s)      lng_sum_##s
+#define RLE_OP          RLE_OP_SUM
+#define RLE_OP0         RLE_OP0_SUM
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      lng_max_##s
+#define RLE_OP          RLE_OP_MAX
+#define RLE_OP0         RLE_OP0_MAX
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+#define MOD_RLE(s)      lng_min_##s
+#define RLE_OP          RLE_OP_MIN
+#define RLE_OP0         RLE_OP0_MIN
+#include "dblv_rle_zero_op_tmpl.h"
+#undef MOD_RLE
+#undef RLE_OP
+#undef RLE_OP0
+
+
+static const dblv_rle_ops *dblv_rle_zero_ops_table[4][3] =
+{
+  { &dbl_sum_dblv_rle_zero_ops, &dbl_max_dblv_rle_zero_ops, &dbl_min_dblv_rle_zero_ops },
+  { &flt_sum_dblv_rle_zero_ops, &flt_max_dblv_rle_zero_ops, &flt_min_dblv_rle_zero_ops },
+  { &int_sum_dblv_rle_zero_ops, &int_max_dblv_rle_zero_ops, &int_min_dblv_rle_zero_ops },
+  { &lng_sum_dblv_rle_zero_ops, &lng_max_dblv_rle_zero_ops, &lng_min_dblv_rle_zero_ops },
+};
+
+
+const dblv_rle_ops *dblv_rle_zero_ops(int type, int op)
+{
+  if (type < 0 || type > DBLV_RLE_LONG || op < 0 || op > DBLV_RLE_MIN) return NULL;
+
+  return dblv_rle_zero_ops_table[type][op];
+}
@@ -0,0 +1,516 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* Type- and operator-generic RLE zero kernels. This file is included by dblv_rle_zero_op.c once for every
+   supported combination with the following macros defined:
+
+     MOD_RLE(s)        name of the instance (e.g., s##_flt_max)
+     RLE_TYPE          element type (double, float, int or long)
+     RLE_OP(a, b)      reduction of two elements
+     RLE_OP0(a)        reduction of an element with zero
+     RLE_IS_NAN_P, RLE_ISN_NAN_P, RLE_RLE_SET_P, RLE_RLE2_SET_P, RLE_RLE_GET_P, RLE_RLE_MAX
+                       zero-run token macros of the element type (see dblv_rle.h, NaNs or reserved integers)
+
+   The kernels follow the semantics of the double/sum kernels in dblv_rle_zero.c and dblv_rle_zero_add.c.
+   Results of the reduction that are zero are not recompressed, except in zero runs of the compressed
+   operand. */
+
+
+static void MOD_RLE(compress3)(int nin, void *vin, int nout, void *vout, int *nread, int *nwrite)
+{
+  RLE_TYPE *vin_ = vin, *vout_ = vout;
+  int i = 0, o = 0, e;
+
+  while (i < nin && o < nout)
+  {
+    if (vin_[i] != 0)
+    {
+      vout_[o++] = vin_[i++];
+      continue;
+    }
+
+    e = i + 1;
+    while (e < nin && vin_[e] == 0 && e - i < RLE_RLE_MAX) e++;
+
+    RLE_RLE2_SET_P(&vout_[o], e - i);
+    o++;
+    i = e;
+  }
+
+  if (nread) *nread = i;
+  if (nwrite) *nwrite = o;
+}
+
+
+static void MOD_RLE(compress)(int nin, void *vin, int *nout, void *vout)
+{
+  MOD_RLE(compress3)(nin, vin, nin, vout, NULL, nout);
+}
+
+
+static void MOD_RLE(uncompress)(int nin, void *vin, int *nout, void *vout)
+{
+  RLE_TYPE *vin_ = vin, *vout_ = vout;
+  int i, n, o = 0;
+
+  for (i = 0; i < nin; i++)
+  {
+    if (RLE_ISN_NAN_P(&vin_[i]))
+    {
+      vout_[o++] = vin_[i];
+      continue;
+    }
+
+    for (n = RLE_RLE_GET_P(&vin_[i]); n > 0; n--) vout_[o++] = 0;
+  }
+
+  if (nout) *nout = o;
+}
+
+
+static void MOD_RLE(seek)(int nin, void *vin, int n, int whole, int *nread, int *nskipped, void *vin_next)
+{
+  RLE_TYPE *vin_ = vin, *next = vin_next;
+  int i = 0;
+  long s = 0, r = 0;
+
+  if (RLE_IS_NAN_P(next)) r = RLE_RLE_GET_P(next);
+
+  while (1)
+  {
+    if (r > 0)
+    {
+      if (!whole && r > n - s)
+      {
+        r -= n - s;
+        s = n;
+        break;
+      }
+
+      s += r;
+      r = 0;
+    }
+
+    if (s >= n || i >= nin) break;
+
+    if (RLE_ISN_NAN_P(&vin_[i]))
+    {
+      s++; i++;
+      continue;
+    }
+
+    r = RLE_RLE_GET_P(&vin_[i]);
+    i++;
+  }
+
+  *next = 0;
+  if (r > 0) RLE_RLE_SET_P(next, r);
+
+  if (nread) *nread = i;
+  if (nskipped) *nskipped = (int) s;
+}
+
+
+static void MOD_RLE(cf_uc_add2_cb)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1, v;
+  int i0 = nin0 - 1, i1 = nin1 - 1, o = *nout - 1, lo, e;
+
+  while (i1 >= 0)
+  {
+    if (RLE_ISN_NAN_P(&vin0_[i0]))
+    {
+      vin0_[o--] = RLE_OP(vin0_[i0], vin1_[i1]);
+      i0--; i1--;
+      continue;
+    }
+
+    lo = i1 - (int) RLE_RLE_GET_P(&vin0_[i0]);
+    i0--;
+
+    while (i1 > lo)
+    {
+      v = RLE_OP0(vin1_[i1]);
+
+      if (v != 0)
+      {
+        vin0_[o--] = v;
+        i1--;
+        continue;
+      }
+
+      e = i1 - 1;
+      while (e > lo && RLE_OP0(vin1_[e]) == 0 && i1 - e < RLE_RLE_MAX) e--;
+
+      RLE_RLE2_SET_P(&vin0_[o], i1 - e);
+      o--;
+      i1 = e;
+    }
+  }
+
+  *nout -= o + 1;
+  if (vout) *vout = &vin0_[o + 1];
+}
+
+
+static void MOD_RLE(cf_uc_add2_ub)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1;
+  int i0 = nin0 - 1, i1 = nin1 - 1, o = *nout - 1, n;
+
+  while (i1 >= 0)
+  {
+    if (RLE_ISN_NAN_P(&vin0_[i0]))
+    {
+      vin0_[o--] = RLE_OP(vin0_[i0], vin1_[i1]);
+      i0--; i1--;
+      continue;
+    }
+
+    n = RLE_RLE_GET_P(&vin0_[i0]);
+    i0--;
+
+    for (; n > 0; n--, i1--) vin0_[o--] = RLE_OP0(vin1_[i1]);
+  }
+
+  *nout -= o + 1;
+  if (vout) *vout = &vin0_[o + 1];
+}
+
+
+static void MOD_RLE(uc_cf_add2_uc)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1;
+  int i0 = nin0 - 1, i1 = nin1 - 1, o = *nout - 1, n;
+
+  while (i0 >= 0)
+  {
+    if (RLE_ISN_NAN_P(&vin1_[i1]))
+    {
+      vin0_[o--] = RLE_OP(vin0_[i0], vin1_[i1]);
+      i0--; i1--;
+      continue;
+    }
+
+    n = RLE_RLE_GET_P(&vin1_[i1]);
+    i1--;
+
+    for (; n > 0; n--, i0--) vin0_[o--] = RLE_OP0(vin0_[i0]);
+  }
+
+  *nout -= o + 1;
+  if (vout) *vout = &vin0_[o + 1];
+}
+
+
+static void MOD_RLE(uc_uc_add2_cf)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void **vout)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1, v;
+  int i = 0, o = 0, e;
+
+  while (i < nin0)
+  {
+    v = RLE_OP(vin0_[i], vin1_[i]);
+
+    if (v != 0)
+    {
+      vin0_[o++] = v;
+      i++;
+      continue;
+    }
+
+    e = i + 1;
+    while (e < nin0 && RLE_OP(vin0_[e], vin1_[e]) == 0 && e - i < RLE_RLE_MAX) e++;
+
+    RLE_RLE2_SET_P(&vin0_[o], e - i);
+    o++;
+    i = e;
+  }
+
+  *nout = o;
+  if (vout) *vout = vin0;
+}
+
+
+static void MOD_RLE(cf_uc_add3_cf)(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1, *vout_ = vout, *next = vin0_next, v;
+  int i0 = 0, i1 = 0, o = 0, n = 0, e;
+  int run = RLE_IS_NAN_P(next);
+
+  if (run) n = RLE_RLE_GET_P(next);
+
+  while (1)
+  {
+    if (run)
+    {
+      /* zeros of vin0, recompress the reduction with vin1 */
+      while (n > 0 && i1 < nin1 && o < nout)
+      {
+        v = RLE_OP0(vin1_[i1]);
+
+        if (v != 0)
+        {
+          vout_[o++] = v;
+          i1++; n--;
+          continue;
+        }
+
+        e = i1 + 1;
+        while (e < nin1 && e - i1 < n && RLE_OP0(vin1_[e]) == 0 && e - i1 < RLE_RLE_MAX) e++;
+
+        RLE_RLE2_SET_P(&vout_[o], e - i1);
+        o++;
+        n -= e - i1;
+        i1 = e;
+      }
+
+      *next = 0;
+      if (n > 0) RLE_RLE_SET_P(next, n);
+      run = 0;
+    }
+
+    if (!(i0 < nin0 && i1 < nin1 && o < nout)) break;
+
+    if (RLE_ISN_NAN_P(&vin0_[i0]))
+    {
+      vout_[o++] = RLE_OP(vin0_[i0], vin1_[i1]);
+      i0++; i1++;
+      continue;
+    }
+
+    n = RLE_RLE_GET_P(&vin0_[i0]);
+    i0++;
+    run = 1;
+  }
+
+  if (nread0) *nread0 = i0;
+  if (nread1) *nread1 = i1;
+  if (nwrite) *nwrite = o;
+}
+
+
+static void MOD_RLE(cf_uc_add3_uc)(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1, *vout_ = vout, *next = vin0_next;
+  int i0 = 0, i1 = 0, o = 0, n = 0;
+  int run = RLE_IS_NAN_P(next);
+
+  if (run) n = RLE_RLE_GET_P(next);
+
+  while (1)
+  {
+    if (run)
+    {
+      /* zeros of vin0 */
+      for (; n > 0 && i1 < nin1 && o < nout; n--, i1++) vout_[o++] = RLE_OP0(vin1_[i1]);
+
+      *next = 0;
+      if (n > 0) RLE_RLE_SET_P(next, n);
+      run = 0;
+    }
+
+    if (!(i0 < nin0 && i1 < nin1 && o < nout)) break;
+
+    if (RLE_ISN_NAN_P(&vin0_[i0]))
+    {
+      vout_[o++] = RLE_OP(vin0_[i0], vin1_[i1]);
+      i0++; i1++;
+      continue;
+    }
+
+    n = RLE_RLE_GET_P(&vin0_[i0]);
+    i0++;
+    run = 1;
+  }
+
+  if (nread0) *nread0 = i0;
+  if (nread1) *nread1 = i1;
+  if (nwrite) *nwrite = o;
+}
+
+
+static void MOD_RLE(cf_cf_add2_cf)(int nin0, void *vin0, int nin1, void *vin1, int *nout, void *vout)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1, *vout_ = vout, v;
+  int i0 = 0, i1 = 0, o = 0;
+  long r0 = 0, r1 = 0, m, zeros = 0;
+
+  while (1)
+  {
+    /* enter the next zero runs */
+    if (r0 == 0 && i0 < nin0 && RLE_IS_NAN_P(&vin0_[i0])) { r0 = RLE_RLE_GET_P(&vin0_[i0]); i0++; continue; }
+    if (r1 == 0 && i1 < nin1 && RLE_IS_NAN_P(&vin1_[i1])) { r1 = RLE_RLE_GET_P(&vin1_[i1]); i1++; continue; }
+
+    if (r0 > 0 || i0 >= nin0)
+    {
+      if (r1 > 0 || i1 >= nin1)
+      {
+        if (r0 == 0 && r1 == 0) break;
+
+        /* zeros in both */
+        m = (r0 == 0)?r1:((r1 == 0)?r0:((r0 < r1)?r0:r1));
+        zeros += m;
+        if (r0 > 0) r0 -= m;
+        if (r1 > 0) r1 -= m;
+        continue;
+      }
+
+      v = RLE_OP0(vin1_[i1]);
+      i1++;
+      if (r0 > 0) r0--;
+
+    } else if (r1 > 0 || i1 >= nin1)
+    {
+      v = RLE_OP0(vin0_[i0]);
+      i0++;
+      if (r1 > 0) r1--;
+
+    } else
+    {
+      v = RLE_OP(vin0_[i0], vin1_[i1]);
+      i0++; i1++;
+    }
+
+    if (v == 0)
+    {
+      zeros++;
+      continue;
+    }
+
+    for (; zeros > 0; zeros -= m)
+    {
+      m = (zeros < (long) RLE_RLE_MAX)?zeros:(long) RLE_RLE_MAX;
+      RLE_RLE2_SET_P(&vout_[o], m);
+      o++;
+    }
+
+    vout_[o++] = v;
+  }
+
+  for (; zeros > 0; zeros -= m)
+  {
+    m = (zeros < (long) RLE_RLE_MAX)?zeros:(long) RLE_RLE_MAX;
+    RLE_RLE2_SET_P(&vout_[o], m);
+    o++;
+  }
+
+  *nout = o;
+}
+
+static void MOD_RLE(cf_cf_add3_cf)(int nin0, void *vin0, int nin1, void *vin1, int nout, void *vout, int *nread0, int *nread1, int *nwrite, void *vin0_next, void *vin1_next)
+{
+  RLE_TYPE *vin0_ = vin0, *vin1_ = vin1, *vout_ = vout, *next0 = vin0_next, *next1 = vin1_next, v;
+  int i0 = 0, i1 = 0, o = 0;
+  long r0 = 0, r1 = 0, m, zeros = 0;
+
+  if (RLE_IS_NAN_P(next0)) r0 = RLE_RLE_GET_P(next0);
+  if (RLE_IS_NAN_P(next1)) r1 = RLE_RLE_GET_P(next1);
+
+  while (1)
+  {
+    /* enter the next zero runs */
+    if (r0 == 0 && i0 < nin0 && RLE_IS_NAN_P(&vin0_[i0])) { r0 = RLE_RLE_GET_P(&vin0_[i0]); i0++; continue; }
+    if (r1 == 0 && i1 < nin1 && RLE_IS_NAN_P(&vin1_[i1])) { r1 = RLE_RLE_GET_P(&vin1_[i1]); i1++; continue; }
+
+    if ((r0 == 0 && i0 >= nin0) || (r1 == 0 && i1 >= nin1)) break;
+
+    /* full zero runs of the output are written, a new one needs space for its token */
+    if (zeros == (long) RLE_RLE_MAX)
+    {
+      RLE_RLE_SET_P(&vout_[o], zeros);
+      o++;
+      zeros = 0;
+    }
+
+    if (r0 > 0 && r1 > 0)
+    {
+      if (zeros == 0 && o >= nout) break;
+
+      /* zeros in both */
+      m = (r0 < r1)?r0:r1;
+      if (m > (long) RLE_RLE_MAX - zeros) m = (long) RLE_RLE_MAX - zeros;
+      zeros += m;
+      r0 -= m;
+      r1 -= m;
+      continue;
+    }
+
+    if (r0 > 0) v = RLE_OP0(vin1_[i1]);
+    else if (r1 > 0) v = RLE_OP0(vin0_[i0]);
+    else v = RLE_OP(vin0_[i0], vin1_[i1]);
+
+    if (v == 0)
+    {
+      if (zeros == 0 && o >= nout) break;
+      zeros++;
+
+    } else
+    {
+      if (o + (zeros > 0) + 1 > nout) break;
+
+      if (zeros > 0)
+      {
+        RLE_RLE2_SET_P(&vout_[o], zeros);
+        o++;
+        zeros = 0;
+      }
+
+      vout_[o++] = v;
+    }
+
+    if (r0 > 0) { r0--; i1++; }
+    else if (r1 > 0) { r1--; i0++; }
+    else { i0++; i1++; }
+  }
+
+  if (zeros > 0)
+  {
+    RLE_RLE2_SET_P(&vout_[o], zeros);
+    o++;
+  }
+
+  *next0 = 0;
+  if (r0 > 0) RLE_RLE_SET_P(next0, r0);
+  *next1 = 0;
+  if (r1 > 0) RLE_RLE_SET_P(next1, r1);
+
+  if (nread0) *nread0 = i0;
+  if (nread1) *nread1 = i1;
+  if (nwrite) *nwrite = o;
+}
+
+static const dblv_rle_ops MOD_RLE(dblv_rle_zero_ops) =
+{
+  sizeof(RLE_TYPE),
+  MOD_RLE(compress),
+  MOD_RLE(compress3),
+  MOD_RLE(uncompress),
+  MOD_RLE(seek),
+  MOD_RLE(cf_uc_add2_cb),
+  MOD_RLE(cf_uc_add2_ub),
+  MOD_RLE(uc_cf_add2_uc),
+  MOD_RLE(uc_uc_add2_cf),
+  MOD_RLE(cf_uc_add3_cf),
+  MOD_RLE(cf_uc_add3_uc),
+  MOD_RLE(cf_cf_add2_cf),
+  MOD_RLE(cf_cf_add3_cf),
+};
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dblv.h"
+#include "dblv_rle.h"
+#include "dblv_simd.h"
+#include "dblv_simd_scan.h"
+
+
+#ifndef MOD_SIMD
+ #define MOD_SIMD(s)  s##_avx2
+ #define SIMD_TARGET  DBLV_TARGET_AVX2
+#endif
+
+
+#ifdef DBLV_SIMD
+
+/* The compressor alternates between the two scans for the end of a zero run and the end of a nonzero
+   stretch. Nonzero stretches are emitted with a single block copy, zero runs with a single DBL_RLE2_SET_P
+   token, so the output (including nread/nwrite) is identical to dblv_rle_zero_compress3. */
+
+SIMD_TARGET void MOD_SIMD(dblv_rle_zero_compress3)(int nin, double *vin, int nout, double *vout, int *nread, int *nwrite)
+{
+  int i = 0, o = 0, e;
+
+  while (i < nin && o < nout)
+  {
+    e = i + 1;
+
+    if (vin[i] != 0.0)
+    {
+      /* isolated nonzeros are copied without a scan */
+      if (e < nin && vin[e] != 0.0)
+      {
+        e = MOD_SIMD(dblv_nonzero_fwd)(vin, e, nin);
+        if (e - i > nout - o) e = i + nout - o;
+        memcpy(vout + o, vin + i, (e - i) * sizeof(double));
+        o += e - i;
+
+      } else vout[o++] = vin[i];
+
+      i = e;
+      continue;
+    }
+
+    if (e < nin && vin[e] == 0.0) e = MOD_SIMD(dblv_zero_fwd)(vin, e, nin);
+
+    DBL_RLE2_SET_P(vout + o, e - i);
+    o++;
+    i = e;
+  }
+
+  if (nread) *nread = i;
+  if (nwrite) *nwrite = o;
+}
+
+#endif /* DBLV_SIMD */
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "dblv.h"
+#include "dblv_simd.h"
+
+
+static int simd_level = -1;
+
+
+static int dblv_simd_detect()
+{
+#ifdef DBLV_SIMD
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f")) return DBLV_SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2")) return DBLV_SIMD_AVX2;
+#endif
+
+  return DBLV_SIMD_NONE;
+}
+
+
+int dblv_simd_level()
+{
+  if (simd_level < 0) simd_level = dblv_simd_detect();
+
+  return simd_level;
+}
+
+
+void dblv_simd_set_level(int level)
+{
+  int max_level = dblv_simd_detect();
+
+  /* negative level: restore the detected level, larger levels are clamped to what the cpu supports */
+  if (level < 0 || level > max_level) level = max_level;
+
+  simd_level = level;
+}
+
+
+const char *dblv_simd_name(int level)
+{
+  switch (level)
+  {
+    case DBLV_SIMD_AVX2: return "avx2";
+    case DBLV_SIMD_AVX512: return "avx512";
+  }
+
+  return "scalar";
+}
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DBLV_SIMD_H__
+#define __DBLV_SIMD_H__
+
+
+/* SIMD kernels are compiled with per-function target attributes and selected at runtime,
+   so the library itself does not require -mavx2 / -mavx512f */
+#if !defined(DBLV_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define DBLV_SIMD
+#endif
+
+#ifdef DBLV_SIMD
+
+ #include <immintrin.h>
+
+ #define DBLV_TARGET_AVX2    __attribute__((target("avx2")))
+ #define DBLV_TARGET_AVX512  __attribute__((target("avx512f")))
+
+/* call the SIMD variant of f with the given (parenthesized) arguments and return, if one is selected */
+ #define DBLV_SIMD_DISPATCH(f, args)  do { \
+   switch (dblv_simd_level()) \
+   { \
+     case DBLV_SIMD_AVX512: f##_avx512 args; return; \
+     case DBLV_SIMD_AVX2: f##_avx2 args; return; \
+   } } while (0)
+
+#define DBLV_SIMD_DECLARE(isa) \
+void dblv_rle_zero_compress3_##isa(int nin, double *vin, int nout, double *vout, int *nread, int *nwrite); \
+void dblv_rle_zero_cf_uc_add2_cb_##isa(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout); \
+void dblv_rle_zero_cf_uc_add2_ub_##isa(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout); \
+void dblv_rle_zero_uc_cf_add2_uc_##isa(int nin0, double *vin0, int nin1, double *vin1, int *nout, double **vout); \
+void dblv_rle_zero_cf_uc_add3_cf_##isa(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next); \
+void dblv_rle_zero_cf_uc_add3_uc_##isa(int nin0, double *vin0, int nin1, double *vin1, int nout, double *vout, int *nread0, int *nread1, int *nwrite, double *vin0_next);
+
+/* dblv_rle_zero_simd.c, dblv_rle_zero_add_simd.c */
+DBLV_SIMD_DECLARE(avx2)
+/* dblv_rle_zero_simd_avx512.c, dblv_rle_zero_add_simd_avx512.c */
+DBLV_SIMD_DECLARE(avx512)
+
+#else
+
+ #define DBLV_SIMD_DISPATCH(f, args)  do { } while (0)
+
+#endif
+
+
+#endif /* __DBLV_SIMD_H__ */
@@ -0,0 +1,344 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __DBLV_SIMD_SCAN_H__
+#define __DBLV_SIMD_SCAN_H__
+
+
+#include "dblv_rle.h"
+#include "dblv_simd.h"
+
+
+#ifdef DBLV_SIMD
+
+/* Scan helpers shared by the SIMD kernels. The forward scans return the first index >= i in [i,n) where the
+   scanned property ends (n if it does not), the backward scans return the smallest index j >= lo such that
+   the property holds for all of [j,i] (i + 1 if it does not hold for i). Scalar semantics are kept exactly:
+   "zero" is == 0.0 (-0.0 included), "nonzero" is != 0.0 (NaNs included), "token" is a NaN-tagged run. */
+
+#define DBLV_MSB(m)  (31 - __builtin_clz(m))
+
+
+/* AVX2 */
+
+DBLV_TARGET_AVX2 static inline int dblv_zero_fwd_avx2(const double *v, int i, int n)
+{
+  const __m256d z = _mm256_setzero_pd();
+  __m256d c0, c1, c2, c3;
+  int m;
+
+  /* skip long runs 16 doubles at a time */
+  while (i + 16 <= n)
+  {
+    c0 = _mm256_cmp_pd(_mm256_loadu_pd(v + i +  0), z, _CMP_NEQ_UQ);
+    c1 = _mm256_cmp_pd(_mm256_loadu_pd(v + i +  4), z, _CMP_NEQ_UQ);
+    c2 = _mm256_cmp_pd(_mm256_loadu_pd(v + i +  8), z, _CMP_NEQ_UQ);
+    c3 = _mm256_cmp_pd(_mm256_loadu_pd(v + i + 12), z, _CMP_NEQ_UQ);
+
+    if (_mm256_movemask_pd(_mm256_or_pd(_mm256_or_pd(c0, c1), _mm256_or_pd(c2, c3)))) break;
+
+    i += 16;
+  }
+
+  while (i + 4 <= n)
+  {
+    m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(v + i), z, _CMP_NEQ_UQ));
+    if (m) return i + __builtin_ctz(m);
+    i += 4;
+  }
+
+  while (i < n && v[i] == 0.0) i++;
+
+  return i;
+}
+
+
+DBLV_TARGET_AVX2 static inline int dblv_nonzero_fwd_avx2(const double *v, int i, int n)
+{
+  const __m256d z = _mm256_setzero_pd();
+  int m;
+
+  while (i + 4 <= n)
+  {
+    m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(v + i), z, _CMP_EQ_OQ));
+    if (m) return i + __builtin_ctz(m);
+    i += 4;
+  }
+
+  while (i < n && v[i] != 0.0) i++;
+
+  return i;
+}
+
+
+DBLV_TARGET_AVX2 static inline int dblv_zero_bwd_avx2(const double *v, int lo, int i)
+{
+  const __m256d z = _mm256_setzero_pd();
+  int m;
+
+  while (i - 3 >= lo)
+  {
+    m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(v + i - 3), z, _CMP_NEQ_UQ));
+    if (m) return i - 3 + DBLV_MSB(m) + 1;
+    i -= 4;
+  }
+
+  while (i >= lo && v[i] == 0.0) i--;
+
+  return i + 1;
+}
+
+
+DBLV_TARGET_AVX2 static inline int dblv_nonzero_bwd_avx2(const double *v, int lo, int i)
+{
+  const __m256d z = _mm256_setzero_pd();
+  int m;
+
+  while (i - 3 >= lo)
+  {
+    m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(v + i - 3), z, _CMP_EQ_OQ));
+    if (m) return i - 3 + DBLV_MSB(m) + 1;
+    i -= 4;
+  }
+
+  while (i >= lo && v[i] != 0.0) i--;
+
+  return i + 1;
+}
+
+
+DBLV_TARGET_AVX2 static inline int dblv_token_mask_avx2(const double *v)
+{
+  const __m256i nan_mask = _mm256_set1_epi64x(DBL_NAN_MASK);
+
+  return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_loadu_si256((const __m256i *) v), nan_mask), nan_mask)));
+}
+
+
+DBLV_TARGET_AVX2 static inline int dblv_token_fwd_avx2(const double *v, int i, int n)
+{
+  int m;
+
+  while (i + 4 <= n)
+  {
+    m = dblv_token_mask_avx2(v + i);
+    if (m) return i + __builtin_ctz(m);
+    i += 4;
+  }
+
+  while (i < n && DBL_ISN_NAN_P(v + i)) i++;
+
+  return i;
+}
+
+
+DBLV_TARGET_AVX2 static inline int dblv_token_bwd_avx2(const double *v, int lo, int i)
+{
+  int m;
+
+  while (i - 3 >= lo)
+  {
+    m = dblv_token_mask_avx2(v + i - 3);
+    if (m) return i - 3 + DBLV_MSB(m) + 1;
+    i -= 4;
+  }
+
+  while (i >= lo && DBL_ISN_NAN_P(v + i)) i--;
+
+  return i + 1;
+}
+
+
+/* out[k] = a[k] + b[k], ascending */
+DBLV_TARGET_AVX2 static inline void dblv_add_fwd_avx2(double *out, const double *a, const double *b, int n)
+{
+  int k = 0;
+
+  for (; k + 4 <= n; k += 4) _mm256_storeu_pd(out + k, _mm256_add_pd(_mm256_loadu_pd(a + k), _mm256_loadu_pd(b + k)));
+  for (; k < n; k++) out[k] = a[k] + b[k];
+}
+
+
+/* out[k] = a[k] + b[k], descending, out may overlap a at higher addresses (backward in-place decompression) */
+DBLV_TARGET_AVX2 static inline void dblv_add_bwd_avx2(double *out, const double *a, const double *b, int n)
+{
+  int k = n;
+
+  for (; k - 4 >= 0; k -= 4) _mm256_storeu_pd(out + k - 4, _mm256_add_pd(_mm256_loadu_pd(a + k - 4), _mm256_loadu_pd(b + k - 4)));
+  for (k--; k >= 0; k--) out[k] = a[k] + b[k];
+}
+
+
+/* AVX-512 */
+
+DBLV_TARGET_AVX512 static inline int dblv_zero_fwd_avx512(const double *v, int i, int n)
+{
+  const __m512d z = _mm512_setzero_pd();
+  __mmask8 m0, m1, m2, m3;
+
+  /* skip long runs 32 doubles at a time */
+  while (i + 32 <= n)
+  {
+    m0 = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i +  0), z, _CMP_NEQ_UQ);
+    m1 = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i +  8), z, _CMP_NEQ_UQ);
+    m2 = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i + 16), z, _CMP_NEQ_UQ);
+    m3 = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i + 24), z, _CMP_NEQ_UQ);
+
+    if (m0 | m1 | m2 | m3) break;
+
+    i += 32;
+  }
+
+  while (i + 8 <= n)
+  {
+    m0 = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i), z, _CMP_NEQ_UQ);
+    if (m0) return i + __builtin_ctz(m0);
+    i += 8;
+  }
+
+  /* remainder with a masked load, lanes beyond n are treated as zero */
+  if (i < n)
+  {
+    m0 = _mm512_cmp_pd_mask(_mm512_maskz_loadu_pd((__mmask8) ((1u << (n - i)) - 1), v + i), z, _CMP_NEQ_UQ);
+    return (m0)?(i + __builtin_ctz(m0)):n;
+  }
+
+  return i;
+}
+
+
+DBLV_TARGET_AVX512 static inline int dblv_nonzero_fwd_avx512(const double *v, int i, int n)
+{
+  const __m512d z = _mm512_setzero_pd();
+  __mmask8 m;
+
+  while (i + 8 <= n)
+  {
+    m = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i), z, _CMP_EQ_OQ);
+    if (m) return i + __builtin_ctz(m);
+    i += 8;
+  }
+
+  while (i < n && v[i] != 0.0) i++;
+
+  return i;
+}
+
+
+DBLV_TARGET_AVX512 static inline int dblv_zero_bwd_avx512(const double *v, int lo, int i)
+{
+  const __m512d z = _mm512_setzero_pd();
+  __mmask8 m;
+
+  while (i - 7 >= lo)
+  {
+    m = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i - 7), z, _CMP_NEQ_UQ);
+    if (m) return i - 7 + DBLV_MSB(m) + 1;
+    i -= 8;
+  }
+
+  while (i >= lo && v[i] == 0.0) i--;
+
+  return i + 1;
+}
+
+
+DBLV_TARGET_AVX512 static inline int dblv_nonzero_bwd_avx512(const double *v, int lo, int i)
+{
+  const __m512d z = _mm512_setzero_pd();
+  __mmask8 m;
+
+  while (i - 7 >= lo)
+  {
+    m = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i - 7), z, _CMP_EQ_OQ);
+    if (m) return i - 7 + DBLV_MSB(m) + 1;
+    i -= 8;
+  }
+
+  while (i >= lo && v[i] != 0.0) i--;
+
+  return i + 1;
+}
+
+
+DBLV_TARGET_AVX512 static inline __mmask8 dblv_token_mask_avx512(const double *v)
+{
+  const __m512i nan_mask = _mm512_set1_epi64(DBL_NAN_MASK);
+
+  return _mm512_cmpeq_epi64_mask(_mm512_and_si512(_mm512_loadu_si512(v), nan_mask), nan_mask);
+}
+
+
+DBLV_TARGET_AVX512 static inline int dblv_token_fwd_avx512(const double *v, int i, int n)
+{
+  __mmask8 m;
+
+  while (i + 8 <= n)
+  {
+    m = dblv_token_mask_avx512(v + i);
+    if (m) return i + __builtin_ctz(m);
+    i += 8;
+  }
+
+  while (i < n && DBL_ISN_NAN_P(v + i)) i++;
+
+  return i;
+}
+
+
+DBLV_TARGET_AVX512 static inline int dblv_token_bwd_avx512(const double *v, int lo, int i)
+{
+  __mmask8 m;
+
+  while (i - 7 >= lo)
+  {
+    m = dblv_token_mask_avx512(v + i - 7);
+    if (m) return i - 7 + DBLV_MSB(m) + 1;
+    i -= 8;
+  }
+
+  while (i >= lo && DBL_ISN_NAN_P(v + i)) i--;
+
+  return i + 1;
+}
+
+
+DBLV_TARGET_AVX512 static inline void dblv_add_fwd_avx512(double *out, const double *a, const double *b, int n)
+{
+  int k = 0;
+
+  for (; k + 8 <= n; k += 8) _mm512_storeu_pd(out + k, _mm512_add_pd(_mm512_loadu_pd(a + k), _mm512_loadu_pd(b + k)));
+  for (; k < n; k++) out[k] = a[k] + b[k];
+}
+
+
+DBLV_TARGET_AVX512 static inline void dblv_add_bwd_avx512(double *out, const double *a, const double *b, int n)
+{
+  int k = n;
+
+  for (; k - 8 >= 0; k -= 8) _mm512_storeu_pd(out + k - 8, _mm512_add_pd(_mm512_loadu_pd(a + k - 8), _mm512_loadu_pd(b + k - 8)));
+  for (k--; k >= 0; k--) out[k] = a[k] + b[k];
+}
+
+#endif /* DBLV_SIMD */
+
+
+#endif /* __DBLV_SIMD_SCAN_H__ */
@@ -0,0 +1,38 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MPI_ALLREDUCE_H__
+#define __MPI_ALLREDUCE_H__
+
+
+/* ring algorithm: reduce-scatter and allgather of count/comm_size blocks between neighbours in packets of default_pa.packet_size */
+int ZMPI_Allreduce_ring(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+int ZMPI_Allreduce_ring_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+
+/* Rabenseifner algorithm: recursive halving reduce-scatter and recursive doubling allgather (see mpi_reduce_rabenseifner.c) */
+int ZMPI_Allreduce_rabenseifner(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+int ZMPI_Allreduce_rabenseifner_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+
+/* pipeline stream reduce to rank 0 followed by a broadcast of the (compressed) result */
+int ZMPI_Allreduce_reduce_bcast(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+int ZMPI_Allreduce_reduce_bcast_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+
+
+#endif /* __MPI_ALLREDUCE_H__ */
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "reduce_op.h"
+#include "logging.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_allreduce.h"
+
+
+// #define RLE
+
+#ifndef MOD_REDUCE_BCAST
+ #define MOD_REDUCE_BCAST(s) s
+#endif
+
+
+int MOD_REDUCE_BCAST(ZMPI_Allreduce_reduce_bcast)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  const int root = 0;
+
+#ifdef RLE
+  const dblv_rle_ops *rle_ops;
+  int rle_count;
+  char *tbuf;
+#endif
+
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed reduce and broadcast */
+  if (!rle_ops) return ZMPI_Allreduce_reduce_bcast(sendbuf, recvbuf, count, datatype, op, comm);
+#endif
+
+  if (default_pa.logging) mainlog_printf("ZMPI_Allreduce_reduce_bcast: %d  %d  %d\n", count, type_size, comm_size);
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, (size_t) count * type_size);
+    return MPI_SUCCESS;
+  }
+
+#ifndef RLE
+
+  MPI_Reduce_pipe_stream(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+  MPI_Bcast(recvbuf, count, datatype, root, comm);
+
+#else
+
+  MPI_Reduce_pipe_stream_rle(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+  /* the result is broadcast compressed, its compressed size first */
+  tbuf = malloc((size_t) count * type_size);
+
+  if (comm_rank == root) rle_ops->compress(count, recvbuf, &rle_count, tbuf);
+
+  MPI_Bcast(&rle_count, 1, MPI_INT, root, comm);
+  MPI_Bcast(tbuf, rle_count, datatype, root, comm);
+
+  if (comm_rank != root) rle_ops->uncompress(rle_count, tbuf, NULL, recvbuf);
+
+  free(tbuf);
+
+#endif
+
+  return MPI_SUCCESS;
+}
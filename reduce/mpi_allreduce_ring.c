@@ -0,0 +1,258 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "reduce_op.h"
+#include "logging.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_allreduce.h"
+
+
+// #define RLE
+
+#ifndef MOD_RING
+ #define MOD_RING(s) s
+#endif
+
+#define RING_TAG  0
+
+/* block i of the ring covers the elements [ring_offset(i), ring_offset(i + 1)) */
+#define ring_offset(i)  (int) (((long) (i) * count) / comm_size)
+#define ring_block(i)   (((i) % comm_size + comm_size) % comm_size)
+
+#define ring_min(a, b)  (((a) < (b))?(a):(b))
+#define ring_max(a, b)  (((a) > (b))?(a):(b))
+
+#define ring_next  ((comm_rank + 1) % comm_size)
+#define ring_prev  ((comm_rank - 1 + comm_size) % comm_size)
+
+
+int MOD_RING(ZMPI_Allreduce_ring)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int max_packet, max_block, npackets;
+  int step, k, sb, rb, scount, rcount;
+
+  char *rbuf = recvbuf;
+
+#ifndef RLE
+  int soffset, roffset;
+  char *tbuf;
+#else
+  const char *sbuf = sendbuf;
+  const dblv_rle_ops *rle_ops;
+  int ssize, rsize, n, rle_count;
+  int *lens[2], *offs[2], *ilen;
+  char *zbuf[2], *zt, *vout;
+#endif
+
+  MPI_Status status;
+
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed ring */
+  if (!rle_ops) return ZMPI_Allreduce_ring(sendbuf, recvbuf, count, datatype, op, comm);
+#endif
+
+  if (default_pa.logging) mainlog_printf("ZMPI_Allreduce_ring: %d  %d  %d\n", count, type_size, comm_size);
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, (size_t) count * type_size);
+    return MPI_SUCCESS;
+  }
+
+  max_packet = default_pa.packet_size / type_size;
+
+  if (max_packet <= 0)
+  {
+    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, type_size, default_pa.packet_size);
+    max_packet = 1;
+  }
+
+  max_block = count / comm_size + 1;
+
+  /* all processes pass the same number of packets in every step (empty ones if a block is shorter),
+     so that the sends and receives of neighbours match */
+  npackets = (max_block + max_packet - 1) / max_packet;
+
+#ifndef RLE
+
+  /* the partial sums are accumulated in recvbuf, received packets are reduced from tbuf */
+  memcpy(recvbuf, sendbuf, (size_t) count * type_size);
+
+  tbuf = malloc((size_t) ring_min(max_packet, max_block) * type_size);
+
+  /* reduce-scatter: in step i, block rank-i is sent and block rank-i-1 is received and reduced */
+  for (step = 0; step < comm_size - 1; step++)
+  {
+    sb = ring_block(comm_rank - step);
+    rb = ring_block(comm_rank - step - 1);
+
+    for (k = 0; k < npackets; k++)
+    {
+      soffset = ring_offset(sb) + k * max_packet;
+      scount = ring_max(ring_min(max_packet, ring_offset(sb + 1) - soffset), 0);
+      roffset = ring_offset(rb) + k * max_packet;
+      rcount = ring_max(ring_min(max_packet, ring_offset(rb + 1) - roffset), 0);
+
+      MPI_Sendrecv(rbuf + (long) soffset * type_size, scount, datatype, ring_next, RING_TAG,
+        tbuf, rcount, datatype, ring_prev, RING_TAG, comm, &status);
+
+      if (rcount > 0) reduce_op_2(rcount, 0, datatype, op, tbuf, rbuf + (long) roffset * type_size);
+    }
+  }
+
+  /* allgather: in step i, block rank+1-i is sent and block rank-i is received */
+  for (step = 0; step < comm_size - 1; step++)
+  {
+    sb = ring_block(comm_rank + 1 - step);
+    rb = ring_block(comm_rank - step);
+
+    soffset = ring_offset(sb);
+    roffset = ring_offset(rb);
+
+    MPI_Sendrecv(rbuf + (long) soffset * type_size, ring_offset(sb + 1) - soffset, datatype, ring_next, RING_TAG,
+      rbuf + (long) roffset * type_size, ring_offset(rb + 1) - roffset, datatype, ring_prev, RING_TAG, comm, &status);
+  }
+
+  free(tbuf);
+
+#else
+
+  /* the blocks are passed on compressed, packet by packet, received packets are reduced in place (with the
+     same kernel as MPI_Reduce_pipe_sendrecv_rle) and only the block owned after the reduce-scatter is uncompressed */
+
+  for (k = 0; k < 2; k++)
+  {
+    zbuf[k] = malloc((size_t) max_block * type_size);
+    lens[k] = malloc(2 * npackets * sizeof(int));
+    offs[k] = lens[k] + npackets;
+  }
+
+  /* packet k of a block is stored (compressed) within the elements [k * max_packet, (k + 1) * max_packet) of zbuf */
+  sb = ring_block(comm_rank);
+  for (k = 0; k * max_packet < ring_offset(sb + 1) - ring_offset(sb); k++)
+  {
+    n = ring_min(max_packet, ring_offset(sb + 1) - ring_offset(sb) - k * max_packet);
+    rle_ops->compress(n, (void *) (sbuf + (long) (ring_offset(sb) + k * max_packet) * type_size), &lens[0][k], zbuf[0] + (long) k * max_packet * type_size);
+    offs[0][k] = 0;
+  }
+
+  for (step = 0; step < comm_size - 1; step++)
+  {
+    sb = ring_block(comm_rank - step);
+    rb = ring_block(comm_rank - step - 1);
+
+    ssize = ring_offset(sb + 1) - ring_offset(sb);
+    rsize = ring_offset(rb + 1) - ring_offset(rb);
+
+    for (k = 0; k < npackets; k++)
+    {
+      scount = (k * max_packet < ssize)?lens[0][k]:0;
+      rcount = ring_max(ring_min(max_packet, rsize - k * max_packet), 0);
+
+      zt = zbuf[1] + (long) k * max_packet * type_size;
+
+      MPI_Sendrecv(zbuf[0] + (long) (k * max_packet + ((scount > 0)?offs[0][k]:0)) * type_size, scount, datatype, ring_next, RING_TAG,
+        zt, rcount, datatype, ring_prev, RING_TAG, comm, &status);
+
+      if (rcount <= 0) continue;
+
+      MPI_Get_count(&status, datatype, &rle_count);
+
+      /* compressed + uncompressed -> compressed (in place at the end of the packet) */
+      n = rcount;
+      rle_ops->cf_uc_add2_cb(rle_count, zt, rcount, (void *) (sbuf + (long) (ring_offset(rb) + k * max_packet) * type_size), &n, (void **) &vout);
+
+      lens[1][k] = n;
+      offs[1][k] = (vout - zt) / type_size;
+
+      /* the fully reduced block is uncompressed into recvbuf and kept compressed for the allgather */
+      if (step == comm_size - 2) rle_ops->uncompress(n, vout, NULL, rbuf + (long) (ring_offset(rb) + k * max_packet) * type_size);
+    }
+
+    xswap(zbuf[0], zbuf[1], zt);
+    xswap(lens[0], lens[1], ilen);
+    xswap(offs[0], offs[1], ilen);
+  }
+
+  for (step = 0; step < comm_size - 1; step++)
+  {
+    sb = ring_block(comm_rank + 1 - step);
+    rb = ring_block(comm_rank - step);
+
+    ssize = ring_offset(sb + 1) - ring_offset(sb);
+    rsize = ring_offset(rb + 1) - ring_offset(rb);
+
+    for (k = 0; k < npackets; k++)
+    {
+      scount = (k * max_packet < ssize)?lens[0][k]:0;
+      rcount = ring_max(ring_min(max_packet, rsize - k * max_packet), 0);
+
+      zt = zbuf[1] + (long) k * max_packet * type_size;
+
+      MPI_Sendrecv(zbuf[0] + (long) (k * max_packet + ((scount > 0)?offs[0][k]:0)) * type_size, scount, datatype, ring_next, RING_TAG,
+        zt, rcount, datatype, ring_prev, RING_TAG, comm, &status);
+
+      if (rcount <= 0) continue;
+
+      MPI_Get_count(&status, datatype, &rle_count);
+
+      rle_ops->uncompress(rle_count, zt, NULL, rbuf + (long) (ring_offset(rb) + k * max_packet) * type_size);
+
+      lens[1][k] = rle_count;
+      offs[1][k] = 0;
+    }
+
+    xswap(zbuf[0], zbuf[1], zt);
+    xswap(lens[0], lens[1], ilen);
+    xswap(offs[0], offs[1], ilen);
+  }
+
+  for (k = 0; k < 2; k++)
+  {
+    free(zbuf[k]);
+    free(lens[k]);
+  }
+
+#endif
+
+  return MPI_SUCCESS;
+}
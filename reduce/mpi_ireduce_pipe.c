@@ -0,0 +1,677 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "reduce_op.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_common.h"
+#include "mpi_reduce_pipe.h"
+#include "mpi_ireduce_pipe.h"
+
+
+#define IPIPE_TAG        1
+#define IPIPE_MAX_SLOTS  PIPE_ATTR_NBUFS
+
+#define IPIPE_FREE  0
+#define IPIPE_RECV  1
+#define IPIPE_SEND  2
+
+struct _ZMPI_Ireduce_pipe_state
+{
+  const char *sbuf;
+  char *rbuf;
+  int count, type_size;
+  MPI_Datatype datatype;
+  MPI_Op op;
+  int root;
+  MPI_Comm comm;
+
+  /* persistent requests are reused, the process alone in comm only copies */
+  int persistent, self;
+
+  /* neighbors in the pipeline, -1 for the first (prev) and the last (next) process */
+  int prev, next;
+
+  int stream, max_packet;
+  const dblv_rle_ops *rle_ops;
+
+  /* send/receive slots, used round-robin in packet order */
+  int nslots;
+  char *buf_free, *bufs[IPIPE_MAX_SLOTS];
+  int slots[IPIPE_MAX_SLOTS];
+  MPI_Request reqs[IPIPE_MAX_SLOTS];
+
+  /* packet variants: packets posted (received or sent) and processed (reduced) */
+  int npackets, posted, processed;
+
+  /* stream variants: elements processed, received input not yet consumed and the carry of a zero run */
+  int recvs, inc, rposted;
+  char *in, *inbuf;
+  MPI_Request rreq;
+  double vin0_next;
+
+  /* the first failed MPI call completes the request, its error is returned by test and wait */
+  int error;
+
+  int complete, active;
+
+  struct _ZMPI_Ireduce_pipe_state *active_prev, *active_next;
+};
+
+typedef struct _ZMPI_Ireduce_pipe_state ipipe_state;
+
+static struct
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  ipipe_state *active;
+
+  int thread_started, thread_exit;
+  pthread_t thread;
+
+} ipipe = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+
+static int ipipe_offset(ipipe_state *s, int packet)
+{
+  return (int) (((long) packet * s->count) / s->npackets);
+}
+
+
+static void ipipe_error(ipipe_state *s, int ret)
+{
+  if (ret != MPI_SUCCESS && s->error == MPI_SUCCESS) s->error = ret;
+}
+
+
+/* returns the flag of MPI_Test, a failed test is not completed */
+static int ipipe_test(ipipe_state *s, MPI_Request *request, MPI_Status *status)
+{
+  int flag = 0, ret = MPI_Test(request, &flag, status);
+
+  ipipe_error(s, ret);
+
+  return (ret == MPI_SUCCESS && flag);
+}
+
+
+static int ipipe_progress_packet(ipipe_state *s)
+{
+  int progress = 0;
+  int k, p, offset, n, rc, sc;
+  void *buf, *vout;
+  MPI_Status status;
+
+  /* post the next packets into free slots */
+  while (s->posted < s->npackets && s->slots[k = s->posted % s->nslots] == IPIPE_FREE)
+  {
+    p = s->posted;
+    offset = ipipe_offset(s, p);
+    n = ipipe_offset(s, p + 1) - offset;
+
+    if (s->prev < 0)
+    {
+      if (s->rle_ops)
+      {
+        s->rle_ops->compress(n, (void *) (s->sbuf + (long) offset * s->type_size), &sc, s->bufs[k]);
+        vout = s->bufs[k];
+
+      } else
+      {
+        sc = n;
+        vout = (void *) (s->sbuf + (long) offset * s->type_size);
+      }
+
+      ipipe_error(s, MPI_Isend(vout, sc, s->datatype, s->next, IPIPE_TAG, s->comm, &s->reqs[k]));
+      s->slots[k] = IPIPE_SEND;
+      s->processed++;
+
+    } else
+    {
+      buf = (s->next < 0)?(void *) (s->rbuf + (long) offset * s->type_size):s->bufs[k];
+
+      ipipe_error(s, MPI_Irecv(buf, n, s->datatype, s->prev, IPIPE_TAG, s->comm, &s->reqs[k]));
+      s->slots[k] = IPIPE_RECV;
+    }
+
+    s->posted++;
+    progress = 1;
+  }
+
+  /* reduce the received packets in order and forward them */
+  while (s->processed < s->posted && s->slots[k = s->processed % s->nslots] == IPIPE_RECV)
+  {
+    if (!ipipe_test(s, &s->reqs[k], &status)) break;
+
+    p = s->processed;
+    offset = ipipe_offset(s, p);
+    n = ipipe_offset(s, p + 1) - offset;
+
+    buf = (s->next < 0)?(void *) (s->rbuf + (long) offset * s->type_size):s->bufs[k];
+
+    if (s->rle_ops)
+    {
+      MPI_Get_count(&status, s->datatype, &rc);
+      sc = n;
+
+      if (s->next < 0) s->rle_ops->cf_uc_add2_ub(rc, buf, n, (void *) (s->sbuf + (long) offset * s->type_size), &sc, &vout);
+      else s->rle_ops->cf_uc_add2_cb(rc, buf, n, (void *) (s->sbuf + (long) offset * s->type_size), &sc, &vout);
+
+    } else
+    {
+      reduce_op_2(n, 0, s->datatype, s->op, s->sbuf + (long) offset * s->type_size, buf);
+      sc = n;
+      vout = buf;
+    }
+
+    if (s->next < 0) s->slots[k] = IPIPE_FREE;
+    else
+    {
+      ipipe_error(s, MPI_Isend(vout, sc, s->datatype, s->next, IPIPE_TAG, s->comm, &s->reqs[k]));
+      s->slots[k] = IPIPE_SEND;
+    }
+
+    s->processed++;
+    progress = 1;
+  }
+
+  return progress;
+}
+
+
+/* zero run of the input that did not fit into the last output packet */
+static int ipipe_carry(ipipe_state *s)
+{
+  const char *c = (const char *) &s->vin0_next;
+  int i;
+
+  for (i = 0; i < s->type_size; i++) if (c[i]) return 1;
+
+  return 0;
+}
+
+
+static int ipipe_progress_stream(ipipe_state *s)
+{
+  int progress = 0;
+  int k, received, processed, processedc;
+  MPI_Status status;
+
+  if (s->prev < 0)
+  {
+    while (s->recvs < s->count && s->slots[k = s->posted % s->nslots] == IPIPE_FREE)
+    {
+      s->rle_ops->compress3(s->count - s->recvs, (void *) (s->sbuf + (long) s->recvs * s->type_size), s->max_packet, s->bufs[k], &processed, &processedc);
+
+      ipipe_error(s, MPI_Isend(s->bufs[k], processedc, s->datatype, s->next, IPIPE_TAG, s->comm, &s->reqs[k]));
+      s->slots[k] = IPIPE_SEND;
+      s->posted++;
+
+      s->recvs += processed;
+      progress = 1;
+    }
+
+    return progress;
+  }
+
+  while (1)
+  {
+    /* the number of packets is unknown, so the next receive is posted only if the input (and its carry) is consumed */
+    if (!s->rposted && s->inc <= 0 && !ipipe_carry(s) && s->recvs < s->count)
+    {
+      ipipe_error(s, MPI_Irecv(s->inbuf, s->max_packet, s->datatype, s->prev, IPIPE_TAG, s->comm, &s->rreq));
+      s->rposted = 1;
+      progress = 1;
+    }
+
+    if (s->rposted)
+    {
+      if (!ipipe_test(s, &s->rreq, &status)) break;
+
+      MPI_Get_count(&status, s->datatype, &s->inc);
+      s->in = s->inbuf;
+      s->rposted = 0;
+      progress = 1;
+    }
+
+    if (s->inc <= 0 && !ipipe_carry(s)) break;
+
+    if (s->next < 0)
+    {
+      s->rle_ops->cf_uc_add3_uc(s->inc, s->in, s->count - s->recvs, (void *) (s->sbuf + (long) s->recvs * s->type_size),
+        s->count - s->recvs, s->rbuf + (long) s->recvs * s->type_size, &received, &processed, &processedc, &s->vin0_next);
+
+    } else
+    {
+      if (s->slots[k = s->posted % s->nslots] != IPIPE_FREE) break;
+
+      s->rle_ops->cf_uc_add3_cf(s->inc, s->in, s->count - s->recvs, (void *) (s->sbuf + (long) s->recvs * s->type_size),
+        s->max_packet, s->bufs[k], &received, &processed, &processedc, &s->vin0_next);
+
+      if (processedc > 0)
+      {
+        ipipe_error(s, MPI_Isend(s->bufs[k], processedc, s->datatype, s->next, IPIPE_TAG, s->comm, &s->reqs[k]));
+        s->slots[k] = IPIPE_SEND;
+        s->posted++;
+      }
+    }
+
+    if (received <= 0 && processed <= 0) break;
+
+    s->inc -= received;
+    s->in += (long) received * s->type_size;
+    s->recvs += processed;
+    progress = 1;
+  }
+
+  return progress;
+}
+
+
+/* with ipipe.mutex locked */
+static void ipipe_progress(ipipe_state *s)
+{
+  int k, progress;
+
+  if (s->complete) return;
+
+  do
+  {
+    progress = (s->stream)?ipipe_progress_stream(s):ipipe_progress_packet(s);
+
+    /* completed sends free their slots */
+    for (k = 0; k < s->nslots; k++)
+    if (s->slots[k] == IPIPE_SEND)
+    {
+      if (ipipe_test(s, &s->reqs[k], MPI_STATUS_IGNORE))
+      {
+        s->slots[k] = IPIPE_FREE;
+        progress = 1;
+      }
+    }
+
+  } while (progress && s->error == MPI_SUCCESS);
+
+  /* a failed reduction is completed without waiting for its pending requests */
+  if (s->error != MPI_SUCCESS)
+  {
+    s->complete = 1;
+    return;
+  }
+
+  for (k = 0; k < s->nslots; k++) if (s->slots[k] != IPIPE_FREE) return;
+
+  if (s->stream) s->complete = (s->recvs >= s->count && !s->rposted && s->inc <= 0 && !ipipe_carry(s));
+  else s->complete = (s->processed >= s->npackets);
+}
+
+
+static const struct { int stream, rle, nslots; } ipipe_variants[] =
+{
+  { 0, 0, 2 },  /* ZMPI_PIPE_SENDRECV */
+  { 0, 1, 2 },  /* ZMPI_PIPE_SENDRECV_RLE */
+  { 0, 0, 3 },  /* ZMPI_PIPE_ISEND_IRECV */
+  { 1, 0, 2 },  /* ZMPI_PIPE_STREAM */
+  { 1, 1, 2 },  /* ZMPI_PIPE_STREAM_RLE */
+};
+#define IPIPE_NVARIANTS  (int) (sizeof(ipipe_variants) / sizeof(ipipe_variants[0]))
+
+
+static int ipipe_create(int variant, int persistent, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  int comm_rank, comm_size, nbufs, i;
+  long buf_size;
+  ipipe_state *s;
+
+  *request = ZMPI_IREDUCE_PIPE_REQUEST_NULL;
+
+  if (variant < 0 || variant >= IPIPE_NVARIANTS) return 1;
+
+  int ret = MPI_Reduce_check(sendbuf, recvbuf, count, datatype, op, root, comm);
+  if (ret != MPI_SUCCESS)
+  {
+    return ret;
+  }
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  s = calloc(1, sizeof(ipipe_state));
+
+  s->persistent = persistent;
+
+  s->sbuf = sendbuf;
+  s->rbuf = recvbuf;
+  s->count = count;
+  s->datatype = datatype;
+  s->op = op;
+  s->root = root;
+  s->comm = comm;
+
+  MPI_Type_size(datatype, &s->type_size);
+
+  s->self = (comm_size == 1);
+  s->prev = prev_in_pipe;
+  s->next = next_in_pipe;
+
+  s->rle_ops = (ipipe_variants[variant].rle)?reduce_rle_ops(datatype, op):NULL;
+
+  /* uncompressed streams (and datatypes without zero-run encoding) use the fixed packets of sendrecv */
+  s->stream = (ipipe_variants[variant].stream && s->rle_ops);
+
+  s->max_packet = default_pa.packet_size / s->type_size;
+
+  if (!s->max_packet)
+  {
+    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, s->type_size, default_pa.packet_size);
+    s->max_packet = 1;
+  }
+
+  s->npackets = (count + s->max_packet - 1) / s->max_packet;
+
+  s->nslots = ipipe_variants[variant].nslots;
+
+  if (!s->self)
+  {
+    /* slot buffers (not for the last process of the packet variants) and the input buffer of the stream variants */
+    nbufs = (s->next < 0 && !s->stream)?0:s->nslots;
+    if (s->stream && s->prev >= 0) nbufs++;
+
+    buf_size = (long) s->max_packet * s->type_size;
+
+    if (nbufs > 0) s->buf_free = malloc(nbufs * buf_size);
+
+    for (i = 0; i < s->nslots && i < nbufs; i++) s->bufs[i] = s->buf_free + i * buf_size;
+    if (s->stream && s->prev >= 0) s->inbuf = s->buf_free + (nbufs - 1) * buf_size;
+  }
+
+  *request = s;
+
+  return MPI_SUCCESS;
+}
+
+
+/* resets the state without allocations and adds the request to the active requests */
+static void ipipe_activate(ipipe_state *s)
+{
+  int i;
+
+  s->posted = s->processed = 0;
+  s->recvs = s->inc = s->rposted = 0;
+  s->in = NULL;
+  s->vin0_next = 0.0;
+  s->complete = 0;
+  s->error = MPI_SUCCESS;
+
+  for (i = 0; i < s->nslots; i++) s->slots[i] = IPIPE_FREE;
+
+  if (s->self)
+  {
+    ipipe_error(s, MPI_Reduce_self(s->sbuf, s->rbuf, s->count, s->datatype, s->op, s->root, s->comm));
+    s->complete = 1;
+  }
+
+  pthread_mutex_lock(&ipipe.mutex);
+
+  s->active = 1;
+  s->active_prev = NULL;
+  s->active_next = ipipe.active;
+  if (ipipe.active) ipipe.active->active_prev = s;
+  ipipe.active = s;
+
+  ipipe_progress(s);
+
+  pthread_cond_signal(&ipipe.cond);
+
+  pthread_mutex_unlock(&ipipe.mutex);
+}
+
+
+static int ipipe_start(int variant, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  int ret = ipipe_create(variant, 0, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+
+  if (ret == MPI_SUCCESS) ipipe_activate(*request);
+
+  return ret;
+}
+
+
+int ZMPI_Ireduce_pipe_sendrecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  return ipipe_start(ZMPI_PIPE_SENDRECV, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+}
+
+
+int ZMPI_Ireduce_pipe_sendrecv_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  return ipipe_start(ZMPI_PIPE_SENDRECV_RLE, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+}
+
+
+int ZMPI_Ireduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  return ipipe_start(ZMPI_PIPE_ISEND_IRECV, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+}
+
+
+int ZMPI_Ireduce_pipe_stream(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  return ipipe_start(ZMPI_PIPE_STREAM, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+}
+
+
+int ZMPI_Ireduce_pipe_stream_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  return ipipe_start(ZMPI_PIPE_STREAM_RLE, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+}
+
+
+int ZMPI_Reduce_pipe_init(int variant, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request)
+{
+  return ipipe_create(variant, 1, sendbuf, recvbuf, count, datatype, op, root, comm, request);
+}
+
+
+int ZMPI_Ireduce_pipe_start(ZMPI_Ireduce_pipe_request *request)
+{
+  ipipe_state *s = *request;
+
+  if (s == ZMPI_IREDUCE_PIPE_REQUEST_NULL || !s->persistent || s->active) return 1;
+
+  ipipe_activate(s);
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Ireduce_pipe_request_free(ZMPI_Ireduce_pipe_request *request)
+{
+  ipipe_state *s = *request;
+
+  if (s == ZMPI_IREDUCE_PIPE_REQUEST_NULL) return MPI_SUCCESS;
+
+  /* active requests are completed first */
+  if (s->active) ZMPI_Ireduce_pipe_wait(request);
+
+  free(s->buf_free);
+  free(s);
+
+  *request = ZMPI_IREDUCE_PIPE_REQUEST_NULL;
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Ireduce_pipe_test(ZMPI_Ireduce_pipe_request *request, int *flag)
+{
+  ipipe_state *s = *request;
+  int ret = MPI_SUCCESS;
+
+  *flag = 1;
+
+  if (s == ZMPI_IREDUCE_PIPE_REQUEST_NULL || !s->active) return MPI_SUCCESS;
+
+  pthread_mutex_lock(&ipipe.mutex);
+
+  ipipe_progress(s);
+
+  *flag = s->complete;
+
+  if (s->complete)
+  {
+    ret = s->error;
+
+    if (s->active_prev) s->active_prev->active_next = s->active_next;
+    else ipipe.active = s->active_next;
+    if (s->active_next) s->active_next->active_prev = s->active_prev;
+
+    s->active = 0;
+  }
+
+  pthread_mutex_unlock(&ipipe.mutex);
+
+  /* persistent requests stay allocated until ZMPI_Ireduce_pipe_request_free */
+  if (*flag && !s->persistent)
+  {
+    free(s->buf_free);
+    free(s);
+
+    *request = ZMPI_IREDUCE_PIPE_REQUEST_NULL;
+  }
+
+  return ret;
+}
+
+
+int ZMPI_Ireduce_pipe_wait(ZMPI_Ireduce_pipe_request *request)
+{
+  int flag, ret;
+
+  while (1)
+  {
+    ret = ZMPI_Ireduce_pipe_test(request, &flag);
+    if (flag) break;
+
+    /* let the other processes (or the progress thread) run if the node is oversubscribed */
+    sched_yield();
+  }
+
+  return ret;
+}
+
+
+int ZMPI_Ireduce_pipe_progress()
+{
+  int n = 0;
+  ipipe_state *s;
+
+  pthread_mutex_lock(&ipipe.mutex);
+
+  for (s = ipipe.active; s; s = s->active_next)
+  {
+    ipipe_progress(s);
+    if (!s->complete) n++;
+  }
+
+  pthread_mutex_unlock(&ipipe.mutex);
+
+  return n;
+}
+
+
+/* with ipipe.mutex locked, completed requests stay in the active list until they are tested */
+static int ipipe_incomplete()
+{
+  ipipe_state *s;
+
+  for (s = ipipe.active; s; s = s->active_next) if (!s->complete) return 1;
+
+  return 0;
+}
+
+
+static void *ipipe_progress_thread(void *arg)
+{
+  int n;
+
+  while (1)
+  {
+    /* the thread sleeps until a request is activated */
+    pthread_mutex_lock(&ipipe.mutex);
+    while (!ipipe.thread_exit && !ipipe_incomplete()) pthread_cond_wait(&ipipe.cond, &ipipe.mutex);
+    n = !ipipe.thread_exit;
+    pthread_mutex_unlock(&ipipe.mutex);
+
+    if (!n) break;
+
+    if (ZMPI_Ireduce_pipe_progress() > 0) sched_yield();
+  }
+
+  return NULL;
+}
+
+
+int ZMPI_Ireduce_pipe_progress_thread(int enable)
+{
+  int provided;
+
+  if (enable && !ipipe.thread_started)
+  {
+    MPI_Query_thread(&provided);
+
+    if (provided < MPI_THREAD_MULTIPLE)
+    {
+      verbose_printf("ZMPI_Ireduce_pipe_progress_thread: MPI_THREAD_MULTIPLE required!\n");
+      return 1;
+    }
+
+    ipipe.thread_exit = 0;
+    pthread_create(&ipipe.thread, NULL, ipipe_progress_thread, NULL);
+    ipipe.thread_started = 1;
+
+  } else if (!enable && ipipe.thread_started)
+  {
+    pthread_mutex_lock(&ipipe.mutex);
+    ipipe.thread_exit = 1;
+    pthread_cond_signal(&ipipe.cond);
+    pthread_mutex_unlock(&ipipe.mutex);
+
+    pthread_join(ipipe.thread, NULL);
+    ipipe.thread_started = 0;
+  }
+
+  return MPI_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __MPI_IREDUCE_PIPE_H__
+#define __MPI_IREDUCE_PIPE_H__
+
+
+/* Nonblocking variants of the pipeline reductions. A call starts the reduction and returns a request that is
+   completed with ZMPI_Ireduce_pipe_test or ZMPI_Ireduce_pipe_wait. Communication and reduction advance only
+   inside test/wait, ZMPI_Ireduce_pipe_progress (all active requests) or the optional progress thread.
+
+   The packet variants (sendrecv, sendrecv_rle, isend_irecv) split the vector into fixed packets that are
+   double (isend_irecv: triple) buffered, the stream variants forward compressed packets of variable length and
+   carry zero runs across packet boundaries. Uncompressed packets have a fixed length, so the stream variant
+   without compression (and stream_rle for datatypes/operations without zero-run encoding) runs the packets of
+   sendrecv. The send and receive buffers must not be accessed until the request is completed. Concurrent
+   requests on the same communicator are not supported.
+
+   Persistent requests (ZMPI_Reduce_pipe_init) capture the arguments, the pipeline neighbors, the packet
+   schedule and the buffers once. Every ZMPI_Ireduce_pipe_start is then free of allocations, test/wait keep
+   the request for the next start and ZMPI_Ireduce_pipe_request_free releases it. */
+
+typedef struct _ZMPI_Ireduce_pipe_state *ZMPI_Ireduce_pipe_request;
+
+#define ZMPI_IREDUCE_PIPE_REQUEST_NULL  NULL
+
+#define ZMPI_PIPE_SENDRECV      0
+#define ZMPI_PIPE_SENDRECV_RLE  1
+#define ZMPI_PIPE_ISEND_IRECV   2
+#define ZMPI_PIPE_STREAM        3
+#define ZMPI_PIPE_STREAM_RLE    4
+
+int ZMPI_Ireduce_pipe_sendrecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request);
+int ZMPI_Ireduce_pipe_sendrecv_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request);
+int ZMPI_Ireduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request);
+int ZMPI_Ireduce_pipe_stream(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request);
+int ZMPI_Ireduce_pipe_stream_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request);
+
+int ZMPI_Reduce_pipe_init(int variant, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Ireduce_pipe_request *request);
+int ZMPI_Ireduce_pipe_start(ZMPI_Ireduce_pipe_request *request);
+int ZMPI_Ireduce_pipe_request_free(ZMPI_Ireduce_pipe_request *request);
+
+/* flag is set and the (nonpersistent) request is freed (set to ZMPI_IREDUCE_PIPE_REQUEST_NULL) if the reduction is complete,
+   the error of a failed MPI call completes the request and is returned */
+int ZMPI_Ireduce_pipe_test(ZMPI_Ireduce_pipe_request *request, int *flag);
+int ZMPI_Ireduce_pipe_wait(ZMPI_Ireduce_pipe_request *request);
+
+/* advances all active requests, returns the number of requests still active */
+int ZMPI_Ireduce_pipe_progress();
+
+/* starts (enable != 0) or stops the background progress thread, requires MPI_THREAD_MULTIPLE */
+int ZMPI_Ireduce_pipe_progress_thread(int enable);
+
+
+#endif /* __MPI_IREDUCE_PIPE_H__ */
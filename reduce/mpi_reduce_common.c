@@ -21,22 +21,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <mpi.h>
 
-#ifdef USE_DBLV
- #include "dblv.h"
-#endif
+#include "reduce_op.h"
+#include "reduce_transport.h"
 
 
 int MPI_Reduce_check(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
 {
-  if (datatype != MPI_DOUBLE || op != MPI_SUM)
+  if (!reduce_op_supported(datatype, op))
   {
     return 1;
   }
 
   int comm_size;
-  MPI_Comm_size(comm, &comm_size);
+  transport_comm_size(comm, &comm_size);
 
   if (root >= comm_size)
   {
@@ -49,14 +49,18 @@ int MPI_Reduce_check(const void *sendbuf, void *recvbuf, int count, MPI_Datatype
 
 int MPI_Reduce_self(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
 {
-  int comm_size;
+  int comm_size, type_size;
+
+  transport_comm_size(comm, &comm_size);
 
   if (comm_size > 1)
   {
     return 1;
   }
 
-  dblv_copy(count, sendbuf, recvbuf);
+  MPI_Type_size(datatype, &type_size);
+
+  memcpy(recvbuf, sendbuf, (size_t) count * type_size);
 
   return MPI_SUCCESS;
 }
@@ -28,13 +28,36 @@
 #include "trace.h"
 #include "reduce_op.h"
 #include "logging.h"
+#include "reduce_transport.h"
 
 #ifdef USE_DBLV
  #include "dblv.h"
 #endif
 
+#include "mpi_reduce_gather.h"
+
 
 // #define RLE
+// #define COO
+// #define GATHER_IRECV
+
+#ifdef COO
+ /* every sender chooses the smaller of the zero-RLE and the index-value encoding, messages are sent as bytes
+    and tagged with their encoding */
+ #define GATHER_TAG_COO  1
+ #define GATHER_RECV(buf)  (buf), count * type_size, MPI_BYTE, MPI_ANY_SOURCE, MPI_ANY_TAG, comm
+#else
+ #define GATHER_RECV(buf)  (buf), count, datatype, MPI_ANY_SOURCE, tag, comm
+#endif
+
+#ifdef GATHER_IRECV
+ /* the root keeps receives into a ring of buffers in flight and reduces the arrivals in the order they complete */
+ #define GATHER_IRECV_BUFS  4
+ #ifdef RLE
+  /* well compressed arrivals are merged compressed into an accumulator (flushed into recvbuf if it exceeds the ratio) */
+  #define GATHER_MERGE_RATIO  0.25
+ #endif
+#endif
 
 #ifndef MOD_GATHER
  #define MOD_GATHER(s) s
@@ -53,44 +76,150 @@ int MOD_GATHER(MPI_Reduce_gather)(const void *sendbuf, void *recvbuf, int count,
   const char *sbuf;
   char *tbuf;
 
+#ifdef RLE
+  const dblv_rle_ops *rle_ops;
+#endif
+#ifdef COO
+  const dblv_coo_ops *coo_ops;
+  char *cbuf;
+  int stag = tag, ncoo;
+#endif
+
   int sendc = 0, recvc = 0;
 
   MPI_Status status;
 
+#ifdef GATHER_IRECV
+  int nbufs, posted, i;
+  char *rbufs;
+  transport_request reqs[GATHER_IRECV_BUFS];
+ #ifdef RLE
+  char *abuf, *abuf2, *abuft;
+  int na = 0, nmerged;
+ #endif
+#endif
+
 
-  MPI_Comm_rank(comm, &comm_rank);
-  MPI_Comm_size(comm, &comm_size);
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
 
   MPI_Type_size(datatype, &type_size);
 
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed gather */
+  if (!rle_ops) return MPI_Reduce_gather(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
+#ifdef COO
+  coo_ops = reduce_coo_ops(datatype, op);
+
+  /* datatypes without index-value encoding (integers) are only zero-RLE encoded */
+  if (!coo_ops) return MPI_Reduce_gather_rle(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
   if (comm_size == 1)
   {
     memcpy(recvbuf, sendbuf, type_size * count);
     goto end;
   }
 
+  /* the root receives nothing, so nothing must be sent */
+  if (count <= 0) goto end;
+
   tbuf = malloc(count * type_size);
+#ifdef COO
+  cbuf = malloc(count * type_size);
+#endif
 
   if (comm_rank == root)
   {
     memcpy(recvbuf, sendbuf, type_size * count);
 
+#ifdef GATHER_IRECV
+    /* tbuf points into the ring */
+    free(tbuf);
+
+    nbufs = (comm_size - 1 < GATHER_IRECV_BUFS)?(comm_size - 1):GATHER_IRECV_BUFS;
+    rbufs = malloc(nbufs * count * type_size);
+    for (posted = 0; posted < nbufs; posted++) transport_irecv(GATHER_RECV(rbufs + posted * count * type_size), &reqs[posted]);
+ #ifdef RLE
+    abuf = malloc(count * type_size);
+    abuf2 = malloc(count * type_size);
+ #endif
+#endif
+
     while (recvs < count * (comm_size - 1) )
     {
-      MPI_Recv(tbuf, count, datatype, MPI_ANY_SOURCE, tag, comm, &status);
+#ifdef GATHER_IRECV
+      transport_waitany(nbufs, reqs, &i, &status);
+      tbuf = rbufs + i * count * type_size;
+#else
+      transport_recv(GATHER_RECV(tbuf), &status);
+#endif
+
+#ifdef COO
+      MPI_Get_count(&status, MPI_BYTE, &receivedc); receivedc = (receivedc + type_size - 1) / type_size; recvc += receivedc;
+#else
       MPI_Get_count(&status, datatype, &receivedc); recvc += receivedc;
+#endif
 
 #ifndef RLE
       processed = processedc = received = receivedc;
       reduce_op_2(received, 0, datatype, op, tbuf, recvbuf);
 #else
       processed = processedc = received = count;
-      dblv_rle_zero_uc_cf_add2_uc(received, (double *) recvbuf, receivedc, (double *) tbuf, &processedc, NULL);
+ #ifdef COO
+      if (status.MPI_TAG == GATHER_TAG_COO) coo_ops->co_uc_add2_uc(receivedc * type_size, tbuf, received, recvbuf, NULL, recvbuf);
+      else
+ #endif
+ #ifdef GATHER_IRECV
+      if (receivedc <= count * GATHER_MERGE_RATIO)
+      {
+        /* the first arrival is the accumulator, zeros of the others are real zeros of the reduction */
+        if (na == 0) memcpy(abuf, tbuf, receivedc * type_size);
+        else
+        {
+          reduce_rle_merge(rle_ops, count, na, abuf, receivedc, tbuf, &nmerged, abuf2);
+          abuft = abuf; abuf = abuf2; abuf2 = abuft;
+          receivedc = nmerged;
+        }
+        na = receivedc;
+
+        if (na > count * GATHER_MERGE_RATIO)
+        {
+          reduce_rle_op_2(rle_ops, received, na, abuf, recvbuf);
+          na = 0;
+        }
+
+      } else
+ #endif
+      reduce_rle_op_2(rle_ops, received, receivedc, tbuf, recvbuf);
 #endif
 
       recvs += processed;
+
+#ifdef GATHER_IRECV
+      if (posted < comm_size - 1)
+      {
+        transport_irecv(GATHER_RECV(tbuf), &reqs[i]);
+        posted++;
+      }
+#endif
     }
 
+#ifdef GATHER_IRECV
+ #ifdef RLE
+    if (na > 0) reduce_rle_op_2(rle_ops, count, na, abuf, recvbuf);
+
+    free(abuf);
+    free(abuf2);
+ #endif
+    free(rbufs);
+    tbuf = NULL;
+#endif
+
   } else
   {
     received = receivedc = count;
@@ -100,14 +229,32 @@ int MOD_GATHER(MPI_Reduce_gather)(const void *sendbuf, void *recvbuf, int count,
     sbuf = sendbuf;
 #else
     processed = processedc = received;
-    dblv_rle_zero_compress2(received, (double *) sendbuf, &processedc, (double *) tbuf);
+    rle_ops->compress(received, (void *) sendbuf, &processedc, tbuf);
     sbuf = tbuf;
 #endif
 
-    MPI_Send(sbuf, processedc, datatype, root, tag, comm); sendc += processedc;
+#ifdef COO
+    /* the index-value encoding is only used if it is smaller */
+    ncoo = processedc * type_size - 1;
+    coo_ops->compress(received, (void *) sendbuf, DBLV_COO_VARINT, &ncoo, cbuf);
+    if (ncoo >= 0)
+    {
+      sbuf = cbuf;
+      stag = GATHER_TAG_COO;
+      processedc = (ncoo + type_size - 1) / type_size;
+
+    } else ncoo = processedc * type_size;
+
+    transport_send(sbuf, ncoo, MPI_BYTE, root, stag, comm); sendc += processedc;
+#else
+    transport_send(sbuf, processedc, datatype, root, tag, comm); sendc += processedc;
+#endif
   }
 
   free(tbuf);
+#ifdef COO
+  free(cbuf);
+#endif
 
 end:
 
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "timing.h"
+#include "trace.h"
+#include "reduce_op.h"
+#include "logging.h"
+#include "reduce_transport.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_gather.h"
+
+
+// #define RLE
+
+/* The vectors are sent to the root in slices of the packet size of default_pa. Senders compress the next slice
+   while the previous one is in flight, the root keeps receives into a ring of packet buffers in flight and reduces
+   every slice into its place in the receive buffer as it arrives. Receives complete in the order they were posted,
+   so slices of one sender are reduced in order (MPI non-overtaking) and the root only tracks the next slice of
+   every sender. No rank needs a count-sized buffer. */
+
+#define GATHER_PACKETS_TAG   0
+#define GATHER_PACKETS_BUFS  4
+
+#ifndef MOD_GATHER_PACKETS
+ #define MOD_GATHER_PACKETS(s) s
+#endif
+
+
+int MOD_GATHER_PACKETS(MPI_Reduce_gather_packets)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int max_packet, npackets, current_packet, done;
+  int nbufs, posted, total, i, j;
+  int *next_packet;
+
+  int received, receivedc, processedc;
+
+  const char *sbuf = sendbuf;
+  char *rbuf = recvbuf;
+  char *pbufs;
+
+  transport_request reqs[GATHER_PACKETS_BUFS];
+
+#ifdef RLE
+  const dblv_rle_ops *rle_ops;
+#endif
+
+  int sendc = 0, recvc = 0;
+
+  MPI_Status status;
+
+
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed packetized gather */
+  if (!rle_ops) return MPI_Reduce_gather_packets(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  if (count <= 0) goto end;
+
+  max_packet = default_pa.packet_size / type_size;
+
+  if (max_packet <= 0)
+  {
+    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, type_size, default_pa.packet_size);
+    max_packet = 1;
+  }
+
+  if (max_packet > count) max_packet = count;
+
+  npackets = (count + max_packet - 1) / max_packet;
+
+  if (comm_rank == root)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+
+    total = npackets * (comm_size - 1);
+
+    nbufs = (total < GATHER_PACKETS_BUFS)?total:GATHER_PACKETS_BUFS;
+    pbufs = malloc(nbufs * max_packet * type_size);
+    for (posted = 0; posted < nbufs; posted++)
+      transport_irecv(pbufs + posted * max_packet * type_size, max_packet, datatype, MPI_ANY_SOURCE, GATHER_PACKETS_TAG, comm, &reqs[posted]);
+
+    next_packet = calloc(comm_size, sizeof(int));
+
+    for (j = 0; j < total; j++)
+    {
+      /* the oldest receive is matched first, waiting for any would break the order of the slices of a sender */
+      i = j % nbufs;
+      transport_wait(&reqs[i], &status);
+      MPI_Get_count(&status, datatype, &receivedc); recvc += receivedc;
+
+      /* position of the slice in the vector */
+      done = next_packet[status.MPI_SOURCE]++ * max_packet;
+      received = count - done; if (received > max_packet) received = max_packet;
+
+#ifndef RLE
+      reduce_op_2(received, 0, datatype, op, pbufs + i * max_packet * type_size, rbuf + done * type_size);
+#else
+      processedc = received;
+      rle_ops->uc_cf_add2_uc(received, rbuf + done * type_size, receivedc, pbufs + i * max_packet * type_size, &processedc, NULL);
+#endif
+
+      if (posted < total)
+      {
+        transport_irecv(pbufs + i * max_packet * type_size, max_packet, datatype, MPI_ANY_SOURCE, GATHER_PACKETS_TAG, comm, &reqs[i]);
+        posted++;
+      }
+    }
+
+    free(next_packet);
+    free(pbufs);
+
+  } else
+  {
+    /* one slice in flight while the next one is prepared */
+    nbufs = 2;
+    transport_request_null(&reqs[0]);
+    transport_request_null(&reqs[1]);
+
+#ifdef RLE
+    pbufs = malloc(nbufs * max_packet * type_size);
+#else
+    pbufs = NULL;
+#endif
+
+    for (i = 0, done = 0; done < count; i = (i + 1) % nbufs, done += current_packet)
+    {
+      current_packet = count - done; if (current_packet > max_packet) current_packet = max_packet;
+
+      transport_wait(&reqs[i], MPI_STATUS_IGNORE);
+
+#ifndef RLE
+      processedc = current_packet;
+      transport_isend(sbuf + done * type_size, processedc, datatype, root, GATHER_PACKETS_TAG, comm, &reqs[i]);
+#else
+      rle_ops->compress(current_packet, (void *) (sbuf + done * type_size), &processedc, pbufs + i * max_packet * type_size);
+      transport_isend(pbufs + i * max_packet * type_size, processedc, datatype, root, GATHER_PACKETS_TAG, comm, &reqs[i]);
+#endif
+      sendc += processedc;
+    }
+
+    for (i = 0; i < nbufs; i++) transport_wait(&reqs[i], MPI_STATUS_IGNORE);
+
+    free(pbufs);
+  }
+
+end:
+
+/*  printf("%d here: %f%% in, %f%% out\n", comm_rank, 100.0 * recvc / count, 100.0 * sendc / count);*/
+
+  return MPI_SUCCESS;
+}
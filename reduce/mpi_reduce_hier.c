@@ -0,0 +1,266 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "reduce_op.h"
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_gather.h"
+#include "mpi_reduce_rabenseifner.h"
+#include "mpi_reduce_select.h"
+#include "mpi_reduce_topo.h"
+#include "mpi_reduce_hier.h"
+
+
+/* hierarchies of the last roots of a communicator (oldest first) */
+typedef struct _reduce_hier_roots
+{
+  int nroots;
+  reduce_hier *rhs[REDUCE_HIER_ROOTS];
+
+} reduce_hier_roots;
+
+static int reduce_hier_keyval = MPI_KEYVAL_INVALID, reduce_hier_self_keyval = MPI_KEYVAL_INVALID;
+
+/* all cached hierarchies (in the order of their creation, i.e., the same on all processes) */
+static reduce_hier *reduce_hier_list = NULL;
+
+
+static void reduce_hier_free(reduce_hier *rh)
+{
+  reduce_hier **prh;
+
+  for (prh = &reduce_hier_list; *prh != rh; prh = &(*prh)->next);
+  *prh = rh->next;
+
+  if (rh->win != MPI_WIN_NULL) MPI_Win_free(&rh->win);
+  if (rh->leader_comm != MPI_COMM_NULL) MPI_Comm_free(&rh->leader_comm);
+  MPI_Comm_free(&rh->node_comm);
+
+  free(rh);
+}
+
+
+static int reduce_hier_delete(MPI_Comm comm, int keyval, void *attribute_val, void *extra_state)
+{
+  reduce_hier_roots *rhr = attribute_val;
+  int i;
+
+  for (i = 0; i < rhr->nroots; i++) reduce_hier_free(rhr->rhs[i]);
+
+  free(rhr);
+
+  return MPI_SUCCESS;
+}
+
+
+/* the windows are freed with the attribute of MPI_COMM_SELF at the beginning of MPI_Finalize (attributes of other
+   communicators may be deleted when windows can no longer be freed) */
+static int reduce_hier_self_delete(MPI_Comm comm, int keyval, void *attribute_val, void *extra_state)
+{
+  reduce_hier *rh;
+
+  for (rh = reduce_hier_list; rh; rh = rh->next)
+  {
+    if (rh->win != MPI_WIN_NULL) MPI_Win_free(&rh->win);
+  }
+
+  return MPI_SUCCESS;
+}
+
+
+reduce_hier *reduce_hier_get(MPI_Comm comm, int root)
+{
+  reduce_hier_roots *rhr;
+  reduce_hier *rh, **prh;
+  int comm_rank, node_rank, leader_rank, flag, i;
+
+  if (reduce_hier_keyval == MPI_KEYVAL_INVALID)
+  {
+    MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, reduce_hier_delete, &reduce_hier_keyval, NULL);
+    MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, reduce_hier_self_delete, &reduce_hier_self_keyval, NULL);
+    MPI_Comm_set_attr(MPI_COMM_SELF, reduce_hier_self_keyval, NULL);
+  }
+
+  MPI_Comm_get_attr(comm, reduce_hier_keyval, &rhr, &flag);
+
+  if (!flag)
+  {
+    rhr = malloc(sizeof(reduce_hier_roots));
+    rhr->nroots = 0;
+    MPI_Comm_set_attr(comm, reduce_hier_keyval, rhr);
+  }
+
+  for (i = 0; i < rhr->nroots; i++) if (rhr->rhs[i]->root == root) return rhr->rhs[i];
+
+  /* the hierarchy (and window) of the oldest root is replaced (in the same order on all processes) */
+  if (rhr->nroots >= REDUCE_HIER_ROOTS)
+  {
+    reduce_hier_free(rhr->rhs[0]);
+    for (i = 1; i < rhr->nroots; i++) rhr->rhs[i - 1] = rhr->rhs[i];
+    rhr->nroots--;
+  }
+
+  MPI_Comm_rank(comm, &comm_rank);
+
+  rh = malloc(sizeof(reduce_hier));
+  rh->root = root;
+  rh->win = MPI_WIN_NULL;
+  rh->leader_size = rh->member_size = 0;
+  rh->acc = NULL;
+
+  /* the root is the first of its node */
+  reduce_topo_split_node(comm, (comm_rank == root)?-1:comm_rank, &rh->node_comm);
+  MPI_Comm_rank(rh->node_comm, &node_rank);
+
+  MPI_Comm_split(comm, (node_rank == 0)?0:MPI_UNDEFINED, comm_rank, &rh->leader_comm);
+
+  if (rh->leader_comm != MPI_COMM_NULL)
+  {
+    MPI_Comm_rank(rh->leader_comm, &leader_rank);
+    if (comm_rank != root) leader_rank = 0;
+    MPI_Allreduce(&leader_rank, &rh->leader_root, 1, MPI_INT, MPI_SUM, rh->leader_comm);
+  }
+
+  rhr->rhs[rhr->nroots++] = rh;
+
+  for (prh = &reduce_hier_list; *prh; prh = &(*prh)->next);
+  *prh = rh;
+  rh->next = NULL;
+
+  return rh;
+}
+
+
+void reduce_hier_alloc(reduce_hier *rh, MPI_Aint leader_size, MPI_Aint member_size)
+{
+  int node_rank, disp_unit;
+  MPI_Aint size;
+  void *base;
+
+  if (rh->win != MPI_WIN_NULL && rh->leader_size >= leader_size && rh->member_size >= member_size) return;
+
+  if (rh->win != MPI_WIN_NULL) MPI_Win_free(&rh->win);
+
+  if (rh->leader_size > leader_size) leader_size = rh->leader_size;
+  if (rh->member_size > member_size) member_size = rh->member_size;
+
+  MPI_Comm_rank(rh->node_comm, &node_rank);
+
+  MPI_Win_allocate_shared((node_rank == 0)?leader_size:member_size, 1, MPI_INFO_NULL, rh->node_comm, &base, &rh->win);
+  MPI_Win_shared_query(rh->win, 0, &size, &disp_unit, &rh->acc);
+
+  rh->leader_size = leader_size;
+  rh->member_size = member_size;
+}
+
+
+static int MPI_Reduce_hier_variant(ZMPI_Reduce_function reduce, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_size, node_rank, node_size, leader_size;
+  int type_size;
+
+  int s, i, slice_offset, slice_count, ret = MPI_SUCCESS;
+
+  const char *sbuf = sendbuf;
+
+  reduce_hier *rh;
+
+
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  rh = reduce_hier_get(comm, root);
+
+  MPI_Comm_rank(rh->node_comm, &node_rank);
+  MPI_Comm_size(rh->node_comm, &node_size);
+
+  if (node_size > 1)
+  {
+    reduce_hier_alloc(rh, (MPI_Aint) count * type_size, 0);
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, rh->win);
+
+    /* step s: slice (node_rank + s) mod node_size, the first step initializes the slice, a step starts after the
+       previous one is finished on all processes of the node (and the leader has finished the previous call) */
+    for (s = 0; s < node_size; s++)
+    {
+      MPI_Win_sync(rh->win);
+      MPI_Barrier(rh->node_comm);
+      MPI_Win_sync(rh->win);
+
+      i = (node_rank + s) % node_size;
+
+      slice_offset = (int) ((long) count * i / node_size);
+      slice_count = (int) ((long) count * (i + 1) / node_size) - slice_offset;
+
+      if (s == 0) memcpy(rh->acc + (long) slice_offset * type_size, sbuf + (long) slice_offset * type_size, (long) slice_count * type_size);
+      else reduce_op_2(slice_count, 0, datatype, op, sbuf + (long) slice_offset * type_size, rh->acc + (long) slice_offset * type_size);
+    }
+
+    MPI_Win_sync(rh->win);
+    MPI_Barrier(rh->node_comm);
+    MPI_Win_sync(rh->win);
+
+    MPI_Win_unlock_all(rh->win);
+
+    sbuf = rh->acc;
+  }
+
+  if (rh->leader_comm == MPI_COMM_NULL) goto end;
+
+  MPI_Comm_size(rh->leader_comm, &leader_size);
+
+  if (leader_size == 1) memcpy(recvbuf, sbuf, type_size * count);
+  else ret = reduce(sbuf, recvbuf, count, datatype, op, rh->leader_root, rh->leader_comm);
+
+end:
+
+  return ret;
+}
+
+
+int MPI_Reduce_hier_pipe_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  return MPI_Reduce_hier_variant(MPI_Reduce_pipe_stream_rle, sendbuf, recvbuf, count, datatype, op, root, comm);
+}
+
+
+int MPI_Reduce_hier_gather_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  return MPI_Reduce_hier_variant(MPI_Reduce_gather_rle, sendbuf, recvbuf, count, datatype, op, root, comm);
+}
+
+
+int MPI_Reduce_hier_rabenseifner_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  return MPI_Reduce_hier_variant(MPI_Reduce_rabenseifner_rle, sendbuf, recvbuf, count, datatype, op, root, comm);
+}
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MPI_REDUCE_HIER_H__
+#define __MPI_REDUCE_HIER_H__
+
+
+/* Hierarchical reductions in two levels. The processes of a node (shared-memory domain) reduce their vectors into
+   a shared-memory window of the node leader: the vector is split into one slice per process and in step s, process
+   i adds its own slice (i + s) mod node_size to the window, so every slice is written by one process at a time and
+   no vector is copied to another process (reduce_op_2, i.e., with the thread pool if it is enabled). Only the node
+   leaders then reduce the results of their nodes with a compressed pipeline, gather or Rabenseifner algorithm.
+   The root is the leader of its node.
+
+   The node and leader communicators are created once per communicator and root, the window is kept and grows with
+   the vectors (cached as attribute for the last REDUCE_HIER_ROOTS roots, each with its own window). Simulated nodes
+   (ZMPI_REDUCE_TOPO_NODES, see mpi_reduce_topo.h) are split off the shared-memory domains, so the intra-node stage
+   still uses shared memory. */
+
+#define REDUCE_HIER_ROOTS  4
+
+/* node and leader communicators and node window of a communicator and root (used by the hierarchical and the
+   shared-memory pipeline algorithms) */
+typedef struct _reduce_hier
+{
+  int root;
+
+  /* the root is rank 0 of node_comm, leader_comm is MPI_COMM_NULL on the other processes of a node */
+  MPI_Comm node_comm, leader_comm;
+  int leader_root;
+
+  /* window of the node (leader_size bytes of the leader, member_size bytes of every other process) and the base
+     address of the leader's part on the calling process */
+  MPI_Win win;
+  MPI_Aint leader_size, member_size;
+  char *acc;
+
+  struct _reduce_hier *next;
+
+} reduce_hier;
+
+reduce_hier *reduce_hier_get(MPI_Comm comm, int root);
+void reduce_hier_alloc(reduce_hier *rh, MPI_Aint leader_size, MPI_Aint member_size);
+
+/* buffers in shared-memory windows of the processes of a node (collective over comm), the shared-memory pipelines
+   read the send buffers of the other processes of a node in place if all of them are in the same allocation */
+int ZMPI_Reduce_shm_alloc(MPI_Aint size, MPI_Comm comm, void *baseptr);
+int ZMPI_Reduce_shm_free(void *base);
+
+/* returns whether buf is registered in a window of the processes of node_comm, the id of the window (the same on
+   all of its processes, -1 if not registered), the window, the rank of the calling process in the window and the
+   offset of buf */
+int reduce_shm_lookup(const void *buf, MPI_Aint size, MPI_Comm node_comm, MPI_Aint *id, MPI_Win *win, int *node_rank, MPI_Aint *offset);
+
+int MPI_Reduce_hier_pipe_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_hier_gather_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_hier_rabenseifner_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+
+#endif /* __MPI_REDUCE_HIER_H__ */
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <mpi.h>
 
 #include "debug.h"
@@ -28,6 +29,7 @@
 #include "trace.h"
 #include "memory.h"
 #include "reduce_op.h"
+#include "reduce_pool.h"
 
 #include "mpi_reduce_pipe.h"
 
@@ -49,6 +51,14 @@ void pipe_attr_alloc_buf(pipe_attr *pa, int buf_size, int nbufs)
   {
     if (pa->buf_free[i]) free(pa->buf_free[i]);
 
+    if (default_pa.first_touch)
+    {
+      /* the pages are placed on the nodes of the pool threads that will reduce them */
+      pa->buf[i] = malloc_aligned(buf_size, sysconf(_SC_PAGESIZE), &pa->buf_free[i]);
+      if (pa->buf[i]) reduce_pool_first_touch(pa->buf[i], buf_size);
+      continue;
+    }
+
 #ifdef BUFFER_ALIGNMENT
     pa->buf[i] = malloc_aligned(buf_size, BUFFER_ALIGNMENT, &pa->buf_free[i]);
 #else
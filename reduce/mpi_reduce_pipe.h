@@ -33,6 +33,11 @@
 
 #define PIPE_ATTR_NBUFS  3
 
+#define PIPE_RLE_THRESHOLD  0.5
+
+#define PIPE_LANES      2
+#define PIPE_LANES_MAX  16
+
 
 typedef struct _pipe_attr
 {
@@ -43,6 +48,23 @@ typedef struct _pipe_attr
 
   int logging;
 
+  /* allocate page-aligned buffers and first-touch them with the reduction pool (only default_pa) */
+  int first_touch;
+
+  /* adaptive variants send packets uncompressed if their estimated compression ratio
+     (compressed / uncompressed size) exceeds this threshold (only default_pa, 0: PIPE_RLE_THRESHOLD) */
+  double rle_threshold;
+
+  /* choose packet_size online per communicator and size class of the vectors from the measured per-step times
+     (only default_pa, see mpi_reduce_pipe_tune.c) */
+  int tune;
+
+  /* number of concurrent pipelines of the multi-lane variants (only default_pa, 0: PIPE_LANES) */
+  int lanes;
+
+  /* order the processes of the pipelines by hosts and shared-memory domains (only default_pa, see mpi_reduce_topo.h) */
+  int topo;
+
 } pipe_attr;
 
 
@@ -52,6 +74,12 @@ extern pipe_attr default_pa;
 void pipe_attr_alloc_buf(pipe_attr *pa, int buf_size, int nbufs);
 void pipe_attr_free_buf(pipe_attr *pa);
 
+int pipe_tune_packet_size(MPI_Comm comm, long bytes);
+void pipe_tune_update(MPI_Comm comm, long bytes, int packet_size, int nsteps, double time);
+int pipe_tune_converged(MPI_Comm comm, long bytes);
+int pipe_tune_load(const char *filename);
+int pipe_tune_save(const char *filename);
+
 int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
 int MPI_Reduce_pipe_sendrecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
 int MPI_Reduce_pipe_sendrecv_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
@@ -59,7 +87,15 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
 
 int MPI_Reduce_pipe_stream(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
 int MPI_Reduce_pipe_stream_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_stream_adaptive(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
 int MPI_Reduce_pipe_stream_plain(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_coo(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_lanes(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_lanes_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_bidir(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_bidir_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_shm(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_pipe_shm_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
 
 
 extern int sendc_global, recvc_global;
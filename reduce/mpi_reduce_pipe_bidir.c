@@ -0,0 +1,208 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "timing.h"
+#include "trace.h"
+#include "reduce_op.h"
+#include "logging.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
+
+
+// #define RLE
+
+/* Bidirectional pipeline: the first half of the vector flows along the pipeline of the other variants
+   (first_in_pipe -> ... -> root, i.e., to decreasing ranks), the second half flows in the opposite direction
+   (root + 1 -> ... -> root, i.e., to increasing ranks). Both halves are packetized, so both directions of every
+   link carry traffic at once. Every half still crosses comm_size - 1 hops, but with half of the packets, i.e.,
+   the pipeline needs about comm_size - 2 + npackets / 2 steps instead of comm_size - 2 + npackets.
+   The two directions are progressed independently (waiting for both of them in lockstep would make neighbors
+   wait for each other), every direction uses two packet buffers and a packet is received only after the
+   buffer is no longer used by the send of the packet before the previous one. */
+
+#define PIPE_BIDIR_TAG  0
+
+#define bidir_prev(d)  (((d) == 0)?prev_in_pipe:((comm_rank == (root + 1) % comm_size)?-1:((comm_rank - 1 + comm_size) % comm_size)))
+#define bidir_next(d)  (((d) == 0)?next_in_pipe:((comm_rank == root)?-1:((comm_rank + 1) % comm_size)))
+
+#ifndef MOD_PIPE_BIDIR
+ #define MOD_PIPE_BIDIR(s) s
+#endif
+
+
+int MOD_PIPE_BIDIR(MPI_Reduce_pipe_bidir)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int max_packet, i, d, j, n, offset;
+  int half_offset[2], half_count[2], npackets[2], prev[2], next[2], k[2];
+
+  const char *sbuf = sendbuf;
+  char *rbuf = recvbuf;
+  char *bufs, *inbuf[2][2];
+
+  /* requests: receive of direction 0 and 1, sends of direction 0 and 1 from buffer 0 and 1 */
+  MPI_Request reqs[6];
+  MPI_Status stat;
+
+#ifdef RLE
+  const dblv_rle_ops *rle_ops;
+  int recv_count, send_count;
+  char *send_buf;
+#endif
+
+
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed pipeline */
+  if (!rle_ops) return MPI_Reduce_pipe_bidir(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  max_packet = default_pa.packet_size / type_size;
+
+  if (max_packet <= 0)
+  {
+    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, type_size, default_pa.packet_size);
+    max_packet = 1;
+  }
+
+  half_offset[0] = 0;
+  half_count[0] = count / 2;
+  half_offset[1] = half_count[0];
+  half_count[1] = count - half_count[0];
+
+  for (d = 0; d < 2; d++)
+  {
+    npackets[d] = (half_count[d] + max_packet - 1) / max_packet;
+    prev[d] = bidir_prev(d);
+    next[d] = bidir_next(d);
+    k[d] = 0;
+  }
+
+  /* two packet buffers per direction (not needed by the root) */
+  bufs = (comm_rank != root)?malloc(4 * max_packet * type_size):NULL;
+
+  for (d = 0; d < 2; d++)
+  {
+    inbuf[d][0] = (bufs)?(bufs + (2 * d + 0) * max_packet * type_size):NULL;
+    inbuf[d][1] = (bufs)?(bufs + (2 * d + 1) * max_packet * type_size):NULL;
+  }
+
+  for (i = 0; i < 6; i++) reqs[i] = MPI_REQUEST_NULL;
+
+  while (1)
+  {
+    /* start the next packet of every direction whose buffer is free */
+    for (d = 0; d < 2; d++)
+    {
+      if (prev[d] < 0)
+      {
+        /* the first process of a direction only sends its packets */
+        while (k[d] < npackets[d] && reqs[2 + 2 * d + k[d] % 2] == MPI_REQUEST_NULL)
+        {
+          offset = half_offset[d] + k[d] * max_packet;
+          n = half_count[d] - k[d] * max_packet; if (n > max_packet) n = max_packet;
+
+#ifdef RLE
+          rle_ops->compress(n, (void *) (sbuf + offset * type_size), &send_count, inbuf[d][k[d] % 2]);
+          MPI_Isend(inbuf[d][k[d] % 2], send_count, datatype, next[d], PIPE_BIDIR_TAG + d, comm, &reqs[2 + 2 * d + k[d] % 2]);
+#else
+          MPI_Isend(sbuf + offset * type_size, n, datatype, next[d], PIPE_BIDIR_TAG + d, comm, &reqs[2 + 2 * d + k[d] % 2]);
+#endif
+          ++k[d];
+        }
+        continue;
+      }
+
+      if (k[d] >= npackets[d] || reqs[d] != MPI_REQUEST_NULL || reqs[2 + 2 * d + k[d] % 2] != MPI_REQUEST_NULL) continue;
+
+      offset = half_offset[d] + k[d] * max_packet;
+      n = half_count[d] - k[d] * max_packet; if (n > max_packet) n = max_packet;
+
+      /* the root receives into its receive buffer */
+      MPI_Irecv((next[d] < 0)?(rbuf + offset * type_size):inbuf[d][k[d] % 2], n, datatype, prev[d], PIPE_BIDIR_TAG + d, comm, &reqs[d]);
+    }
+
+    MPI_Waitany(6, reqs, &j, &stat);
+
+    if (j == MPI_UNDEFINED) break;
+
+    /* sends only free their buffer */
+    if (j >= 2) continue;
+
+    d = j;
+
+    offset = half_offset[d] + k[d] * max_packet;
+    n = half_count[d] - k[d] * max_packet; if (n > max_packet) n = max_packet;
+
+#ifdef RLE
+    MPI_Get_count(&stat, datatype, &recv_count);
+    send_count = n;
+
+    if (next[d] < 0) rle_ops->cf_uc_add2_ub(recv_count, rbuf + offset * type_size, n, (void *) (sbuf + offset * type_size), &send_count, NULL);
+    else
+    {
+      rle_ops->cf_uc_add2_cb(recv_count, inbuf[d][k[d] % 2], n, (void *) (sbuf + offset * type_size), &send_count, (void **) &send_buf);
+      MPI_Isend(send_buf, send_count, datatype, next[d], PIPE_BIDIR_TAG + d, comm, &reqs[2 + 2 * d + k[d] % 2]);
+    }
+#else
+    if (next[d] < 0) reduce_op_2(n, 0, datatype, op, sbuf + offset * type_size, rbuf + offset * type_size);
+    else
+    {
+      reduce_op_2(n, 0, datatype, op, sbuf + offset * type_size, inbuf[d][k[d] % 2]);
+      MPI_Isend(inbuf[d][k[d] % 2], n, datatype, next[d], PIPE_BIDIR_TAG + d, comm, &reqs[2 + 2 * d + k[d] % 2]);
+    }
+#endif
+
+    ++k[d];
+  }
+
+  free(bufs);
+
+end:
+
+  return MPI_SUCCESS;
+}
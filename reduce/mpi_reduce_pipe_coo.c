@@ -0,0 +1,205 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "timing.h"
+#include "trace.h"
+#include "reduce_op.h"
+#include "logging.h"
+#include "reduce_transport.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
+
+
+/* Packets are sent either zero-RLE or index-value (COO) encoded, whichever is smaller at the first process of
+   the pipe. Following processes keep the encoding of a received packet and switch from index-value to zero-RLE
+   only if the index-value result would not be smaller than the uncompressed packet. Packets are sent as bytes
+   and tagged with their encoding. */
+
+#define PIPE_COO_TAG_RLE  0
+#define PIPE_COO_TAG_COO  1
+
+
+int MPI_Reduce_pipe_coo(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int max_packet, current_packet, done;
+  int nsend, nrecv, ncoo, stag = PIPE_COO_TAG_RLE;
+  int nread0, nread1, nwrite;
+
+  int iam_first_in_pipe, iam_last_in_pipe;
+
+  const char *sbuf = sendbuf;
+  char *rbuf = recvbuf;
+  char *pbuf0, *pbuf1, *pbufs, *pbuft;
+
+  const dblv_rle_ops *rle_ops;
+  const dblv_coo_ops *coo_ops;
+  /* carry of a zero run, large enough for a token of every supported datatype */
+  double rle_next;
+
+  int sendc = 0, recvc = 0;
+
+  MPI_Status status;
+
+  pipe_attr local_pa, *my_pa;
+
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
+
+  iam_first_in_pipe = (first_in_pipe == comm_rank);
+  iam_last_in_pipe = (last_in_pipe == comm_rank);
+
+  MPI_Type_size(datatype, &type_size);
+
+  rle_ops = reduce_rle_ops(datatype, op);
+  coo_ops = reduce_coo_ops(datatype, op);
+
+  /* datatypes without compression use the uncompressed pipeline */
+  if (!rle_ops || !coo_ops) return MPI_Reduce_pipe_stream(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  if (default_pa.buf_size < default_pa.packet_size || !default_pa.buf[0] || !default_pa.buf[1])
+  {
+    local_pa.packet_size = default_pa.packet_size;
+    pipe_attr_alloc_buf(&local_pa, local_pa.packet_size, 2);
+    my_pa = &local_pa;
+
+  } else my_pa = &default_pa;
+
+  max_packet = my_pa->packet_size / type_size;
+
+  /* pbuf0 receives, pbuf1 holds the packet to send (pbufs points into it) */
+  pbuf0 = my_pa->buf[0];
+  pbuf1 = pbufs = my_pa->buf[1];
+
+  nsend = 0;
+  done = 0;
+
+  while (done < count)
+  {
+    current_packet = count - done; if (current_packet > max_packet) current_packet = max_packet;
+
+    if (iam_first_in_pipe)
+    {
+      rle_ops->compress(current_packet, (void *) sbuf, &nsend, pbuf0);
+      nsend *= type_size;
+
+      /* the index-value encoding is only used if it is smaller */
+      ncoo = nsend - 1;
+      coo_ops->compress(current_packet, (void *) sbuf, DBLV_COO_VARINT, &ncoo, pbuf1);
+
+      if (ncoo >= 0) transport_send(pbuf1, ncoo, MPI_BYTE, next_in_pipe, PIPE_COO_TAG_COO, comm);
+      else transport_send(pbuf0, nsend, MPI_BYTE, next_in_pipe, PIPE_COO_TAG_RLE, comm);
+
+      sendc += ((ncoo >= 0)?ncoo:nsend) / type_size;
+      nsend = 0;
+
+    } else if (iam_last_in_pipe)
+    {
+      transport_recv(pbuf0, my_pa->packet_size, MPI_BYTE, prev_in_pipe, MPI_ANY_TAG, comm, &status);
+      MPI_Get_count(&status, MPI_BYTE, &nrecv); recvc += nrecv / type_size;
+
+      if (status.MPI_TAG == PIPE_COO_TAG_COO) coo_ops->co_uc_add2_uc(nrecv, pbuf0, current_packet, (void *) sbuf, NULL, rbuf);
+      else
+      {
+        rle_next = 0.0;
+        rle_ops->cf_uc_add3_uc(nrecv / type_size, pbuf0, current_packet, (void *) sbuf, current_packet, rbuf, &nread0, &nread1, &nwrite, &rle_next);
+      }
+
+    } else
+    {
+      if (nsend > 0)
+      {
+        transport_sendrecv(pbufs, nsend, MPI_BYTE, next_in_pipe, stag, pbuf0, my_pa->packet_size, MPI_BYTE, prev_in_pipe, MPI_ANY_TAG, comm, &status);
+        sendc += nsend / type_size;
+
+      } else transport_recv(pbuf0, my_pa->packet_size, MPI_BYTE, prev_in_pipe, MPI_ANY_TAG, comm, &status);
+
+      MPI_Get_count(&status, MPI_BYTE, &nrecv); recvc += nrecv / type_size;
+
+      if (status.MPI_TAG == PIPE_COO_TAG_COO)
+      {
+        nsend = current_packet * type_size;
+        coo_ops->co_uc_add2_co(nrecv, pbuf0, current_packet, (void *) sbuf, DBLV_COO_VARINT, &nsend, pbuf1);
+        pbufs = pbuf1;
+        stag = PIPE_COO_TAG_COO;
+
+        if (nsend < 0)
+        {
+          /* result too dense, continue zero-RLE encoded */
+          coo_ops->co_uc_add2_uc(nrecv, pbuf0, current_packet, (void *) sbuf, NULL, pbuf1);
+          rle_ops->compress(current_packet, pbuf1, &nsend, pbuf0);
+          nsend *= type_size;
+          xswap(pbuf0, pbuf1, pbuft);
+          pbufs = pbuf1;
+          stag = PIPE_COO_TAG_RLE;
+        }
+
+      } else
+      {
+        nsend = current_packet;
+        rle_ops->cf_uc_add2_cb(nrecv / type_size, pbuf0, current_packet, (void *) sbuf, &nsend, (void **) &pbufs);
+        nsend *= type_size;
+        xswap(pbuf0, pbuf1, pbuft);
+        stag = PIPE_COO_TAG_RLE;
+      }
+    }
+
+    sbuf += current_packet * type_size;
+    rbuf += current_packet * type_size;
+
+    done += current_packet;
+  }
+
+  if (nsend > 0)
+  {
+    transport_send(pbufs, nsend, MPI_BYTE, next_in_pipe, stag, comm);
+    sendc += nsend / type_size;
+  }
+
+  if (my_pa == &local_pa) pipe_attr_free_buf(&local_pa);
+
+end:
+
+  sendc_global = sendc;
+  recvc_global = recvc;
+
+  return MPI_SUCCESS;
+}
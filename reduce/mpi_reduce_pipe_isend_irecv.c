@@ -27,9 +27,11 @@
 #include "timing.h"
 #include "trace.h"
 #include "reduce_op.h"
+#include "reduce_transport.h"
 
 #include "mpi_reduce_common.h"
 #include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
 
 
 #define PIPE_ISEND_IRECV_TALL          0
@@ -58,7 +60,7 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
   char *rbuf = recvbuf;
   char *buf0, *buf1, *buf2, *buft;
 
-  MPI_Request reqs[2];
+  transport_request reqs[2];
   MPI_Status stats[2];
 
   pipe_attr local_pa, *my_pa;
@@ -77,8 +79,10 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
   timing_zero(PIPE_ISEND_IRECV_TIMES, current_times);
   timing_sstart();
 
-  MPI_Comm_rank(comm, &comm_rank);
-  MPI_Comm_size(comm, &comm_size);
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
 
   iam_first_in_pipe = (first_in_pipe == comm_rank);
   iam_last_in_pipe = (last_in_pipe == comm_rank);
@@ -88,7 +92,7 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
   if (default_pa.buf_size < default_pa.packet_size || !default_pa.buf[0] || !default_pa.buf[1] || !default_pa.buf[2])
   {
     local_pa.packet_size = default_pa.packet_size;
-    pipe_attr_alloc_buf(&local_pa, local_pa.packet_size, 2);
+    pipe_attr_alloc_buf(&local_pa, local_pa.packet_size, 3);
     my_pa = &local_pa;
 
   } else my_pa = &default_pa;
@@ -123,12 +127,12 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
 
     if (iam_first_in_pipe)
     {
-      if (current_packet > 0) MPI_Send(&sbuf[offset], current_packet, datatype, next_in_pipe, tag, comm);
+      if (current_packet > 0) transport_send(&sbuf[offset], current_packet, datatype, next_in_pipe, tag, comm);
 
     } else if (iam_last_in_pipe)
     {
-      if (current_packet > 0) MPI_Irecv(&rbuf[offset], current_packet, datatype, prev_in_pipe, tag, comm, &reqs[0]);
-      else reqs[0] = MPI_REQUEST_NULL;
+      if (current_packet > 0) transport_irecv(&rbuf[offset], current_packet, datatype, prev_in_pipe, tag, comm, &reqs[0]);
+      else transport_request_null(&reqs[0]);
 
       if (prev_packet > 0)
       {
@@ -137,15 +141,15 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
         current_times[PIPE_ISEND_IRECV_TRED] = timing_send();
       }
 
-      MPI_Waitall(1, reqs, stats);
+      transport_wait(&reqs[0], &stats[0]);
 
     } else
     {
-      if (current_packet > 0) MPI_Irecv(buf0, current_packet, datatype, prev_in_pipe, tag, comm, &reqs[0]);
-      else reqs[0] = MPI_REQUEST_NULL;
+      if (current_packet > 0) transport_irecv(buf0, current_packet, datatype, prev_in_pipe, tag, comm, &reqs[0]);
+      else transport_request_null(&reqs[0]);
 
-      if (pprev_packet > 0) MPI_Isend(buf2, pprev_packet, datatype, next_in_pipe, tag, comm, &reqs[1]);
-      else reqs[1] = MPI_REQUEST_NULL;
+      if (pprev_packet > 0) transport_isend(buf2, pprev_packet, datatype, next_in_pipe, tag, comm, &reqs[1]);
+      else transport_request_null(&reqs[1]);
 
       if (prev_packet > 0)
       {
@@ -154,7 +158,8 @@ int MPI_Reduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, M
         current_times[PIPE_ISEND_IRECV_TRED] = timing_send();
       }
 
-      MPI_Waitall(2, reqs, stats);
+      transport_wait(&reqs[0], &stats[0]);
+      transport_wait(&reqs[1], &stats[1]);
 
       buft = buf2;
       buf2 = buf1;
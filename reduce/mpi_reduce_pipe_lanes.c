@@ -0,0 +1,208 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <mpi.h>
+
+#include "reduce_op.h"
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
+#include "mpi_ireduce_pipe.h"
+
+
+/* Multi-lane pipelines: the vector is split into default_pa.lanes slices that are reduced concurrently by
+   nonblocking pipelines (see mpi_ireduce_pipe.h), each on its own lane communicator with a different ring order.
+   Lane l orders the processes by rank * stride_l mod comm_size with strides 1, comm_size - 1, 2, ... that are
+   coprime to comm_size, so that the neighbors (and links) of a process differ between the lanes. The root has rank
+   root * stride_l mod comm_size in lane l and receives the results directly into the slices of its receive buffer.
+   The lanes are advanced round-robin, the reductions of their packets use reduce_op_2 (i.e., the thread pool if
+   enabled).
+
+   The ring of a lane is the same for all roots, so the lane communicators are created once per communicator and
+   number of lanes (cached as attribute). */
+
+typedef struct _pipe_lanes
+{
+  int nlanes;
+  int strides[PIPE_LANES_MAX];
+  MPI_Comm comms[PIPE_LANES_MAX];
+
+} pipe_lanes;
+
+static int pipe_lanes_keyval = MPI_KEYVAL_INVALID;
+
+
+static void pipe_lanes_free(pipe_lanes *pl)
+{
+  int l;
+
+  for (l = 0; l < pl->nlanes; l++) MPI_Comm_free(&pl->comms[l]);
+
+  free(pl);
+}
+
+
+static int pipe_lanes_delete(MPI_Comm comm, int keyval, void *attribute_val, void *extra_state)
+{
+  pipe_lanes_free(attribute_val);
+
+  return MPI_SUCCESS;
+}
+
+
+static int pipe_lanes_gcd(int a, int b)
+{
+  int t;
+
+  while (b) { t = a % b; a = b; b = t; }
+
+  return a;
+}
+
+
+static pipe_lanes *pipe_lanes_get(MPI_Comm comm, int nlanes)
+{
+  pipe_lanes *pl;
+  int comm_rank, comm_size, flag, l, n, i, stride;
+  int *strides;
+
+  if (pipe_lanes_keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, pipe_lanes_delete, &pipe_lanes_keyval, NULL);
+
+  MPI_Comm_get_attr(comm, pipe_lanes_keyval, &pl, &flag);
+
+  if (flag && pl->nlanes == nlanes) return pl;
+
+  /* replaces (and frees) a previous attribute */
+  if (flag) MPI_Comm_delete_attr(comm, pipe_lanes_keyval);
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  pl = malloc(sizeof(pipe_lanes));
+  pl->nlanes = nlanes;
+
+  strides = pl->strides;
+
+  /* distinct ring orders (repeated if there are fewer than lanes) */
+  n = 0;
+  for (i = 1; i < comm_size && n < nlanes; i++)
+  {
+    stride = (i % 2)?((i + 1) / 2):(comm_size - i / 2);
+    if (pipe_lanes_gcd(stride, comm_size) != 1) continue;
+    for (l = 0; l < n; l++) if (strides[l] == stride) break;
+    if (l >= n) strides[n++] = stride;
+  }
+  if (n == 0) strides[n++] = 1;
+  for (l = n; l < nlanes; l++) strides[l] = strides[l % n];
+
+  for (l = 0; l < nlanes; l++) MPI_Comm_split(comm, 0, (int) (((long) comm_rank * strides[l]) % comm_size), &pl->comms[l]);
+
+  MPI_Comm_set_attr(comm, pipe_lanes_keyval, pl);
+
+  return pl;
+}
+
+
+static int MPI_Reduce_pipe_lanes_variant(int variant, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int nlanes, l, lane_count, lane_offset, lane_root, active, flag;
+
+  pipe_lanes *pl;
+  ZMPI_Ireduce_pipe_request reqs[PIPE_LANES_MAX];
+
+
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  nlanes = (default_pa.lanes > 0)?default_pa.lanes:PIPE_LANES;
+  if (nlanes > PIPE_LANES_MAX) nlanes = PIPE_LANES_MAX;
+
+  pl = pipe_lanes_get(comm, nlanes);
+
+  for (l = 0; l < nlanes; l++)
+  {
+    lane_offset = (int) ((long) count * l / nlanes);
+    lane_count = (int) ((long) count * (l + 1) / nlanes) - lane_offset;
+
+    lane_root = (int) (((long) root * pl->strides[l]) % comm_size);
+
+    switch (variant)
+    {
+      case ZMPI_PIPE_STREAM_RLE:
+        ZMPI_Ireduce_pipe_stream_rle((const char *) sendbuf + lane_offset * type_size, (comm_rank == root)?((char *) recvbuf + lane_offset * type_size):recvbuf,
+          lane_count, datatype, op, lane_root, pl->comms[l], &reqs[l]);
+        break;
+      default:
+        ZMPI_Ireduce_pipe_stream((const char *) sendbuf + lane_offset * type_size, (comm_rank == root)?((char *) recvbuf + lane_offset * type_size):recvbuf,
+          lane_count, datatype, op, lane_root, pl->comms[l], &reqs[l]);
+        break;
+    }
+  }
+
+  do
+  {
+    active = 0;
+
+    for (l = 0; l < nlanes; l++)
+    {
+      if (reqs[l] == ZMPI_IREDUCE_PIPE_REQUEST_NULL) continue;
+
+      ZMPI_Ireduce_pipe_test(&reqs[l], &flag);
+      if (!flag) active++;
+    }
+
+    /* let the other processes run if the node is oversubscribed */
+    if (active) sched_yield();
+
+  } while (active);
+
+end:
+
+  return MPI_SUCCESS;
+}
+
+
+int MPI_Reduce_pipe_lanes(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  return MPI_Reduce_pipe_lanes_variant(ZMPI_PIPE_STREAM, sendbuf, recvbuf, count, datatype, op, root, comm);
+}
+
+
+int MPI_Reduce_pipe_lanes_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  return MPI_Reduce_pipe_lanes_variant(ZMPI_PIPE_STREAM_RLE, sendbuf, recvbuf, count, datatype, op, root, comm);
+}
@@ -27,8 +27,10 @@
 #include "timing.h"
 #include "trace.h"
 #include "reduce_op.h"
+#include "reduce_transport.h"
 
 #include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
 
 
 #define PIPE_SEND_RECV_TALL   0
@@ -73,8 +75,10 @@ int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI
   timing_zero(PIPE_SEND_RECV_TIMES, current_times);
   timing_sstart();
 
-  MPI_Comm_rank(comm, &comm_rank);
-  MPI_Comm_size(comm, &comm_size);
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
 
   iam_first_in_pipe = (first_in_pipe == comm_rank);
   iam_last_in_pipe = (last_in_pipe == comm_rank);
@@ -109,6 +113,7 @@ int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI
   buf0 = my_pa->buf[0];
 
 #ifdef SEND_RECV_INIT
+  /* persistent requests are only available with MPI, not with the loopback transport */
   MPI_Recv_init(buf0, max_packet, datatype, prev_in_pipe, tag, comm, &reqs[0]);
   MPI_Send_init(buf0, max_packet, datatype, next_in_pipe, tag, comm, &reqs[1]);
 #endif
@@ -131,9 +136,9 @@ int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI
     {
       timing_sstart();
 #ifdef SEND_RECV_INIT
-      MPI_Send(&sbuf[offset], max_packet, datatype, next_in_pipe, tag, comm);
+      transport_send(&sbuf[offset], max_packet, datatype, next_in_pipe, tag, comm);
 #else
-      MPI_Send(&sbuf[offset], current_packet, datatype, next_in_pipe, tag, comm);
+      transport_send(&sbuf[offset], current_packet, datatype, next_in_pipe, tag, comm);
 #endif
       current_times[PIPE_SEND_RECV_TSEND] += timing_send();
 
@@ -141,9 +146,9 @@ int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI
     {
       timing_sstart();
 #ifdef SEND_RECV_INIT
-      MPI_Recv(&rbuf[offset], max_packet, datatype, prev_in_pipe, tag, comm, &status);
+      transport_recv(&rbuf[offset], max_packet, datatype, prev_in_pipe, tag, comm, &status);
 #else
-      MPI_Recv(&rbuf[offset], current_packet, datatype, prev_in_pipe, tag, comm, &status);
+      transport_recv(&rbuf[offset], current_packet, datatype, prev_in_pipe, tag, comm, &status);
 #endif
       current_times[PIPE_SEND_RECV_TRECV] += timing_send();
 
@@ -162,7 +167,7 @@ int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI
       MPI_Start(&reqs[0]);
       MPI_Wait(&reqs[0], &status);
 #else
-      MPI_Recv(buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
+      transport_recv(buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
 #endif
       current_times[PIPE_SEND_RECV_TRECV] += timing_send();
 
@@ -179,7 +184,7 @@ int MPI_Reduce_pipe_send_recv(const void *sendbuf, void *recvbuf, int count, MPI
       MPI_Start(&reqs[1]);
       MPI_Wait(&reqs[1], &status);
 #else
-      MPI_Send(buf0, current_packet, datatype, next_in_pipe, tag, comm);
+      transport_send(buf0, current_packet, datatype, next_in_pipe, tag, comm);
 #endif
       current_times[PIPE_SEND_RECV_TSEND] += timing_send();
     }
@@ -28,12 +28,14 @@
 #include "trace.h"
 #include "reduce_op.h"
 #include "logging.h"
+#include "reduce_transport.h"
 
 #ifdef USE_DBLV
  #include "dblv.h"
 #endif
 
 #include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
 
 
 // #define RLE
@@ -65,8 +67,9 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
 
   const int tag = 0;
 
-  int max_packet, npackets, current_packet, prev_packet;
-  int done, offset;
+  int packet_size, max_packet, npackets, current_packet, prev_packet;
+  int done, offset, nsteps;
+  double t_tune = 0.0;
 
   int iam_first_in_pipe, iam_last_in_pipe;
 
@@ -75,8 +78,9 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
   char *buf0, *buf1, *buft;
 
 #ifdef RLE
+  const dblv_rle_ops *rle_ops;
   int rle_sendcount, rle_recvcount;
-  double *rle_sendbuf;
+  char *rle_sendbuf;
   int rle_sendcounts = 0, rle_recvcounts = 0;
 #endif
 
@@ -87,14 +91,23 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
   timing_zero(PIPE_SENDRECV_TIMES, current_times);
   timing_sstart();
 
-  MPI_Comm_rank(comm, &comm_rank);
-  MPI_Comm_size(comm, &comm_size);
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
 
   iam_first_in_pipe = (first_in_pipe == comm_rank);
   iam_last_in_pipe = (last_in_pipe == comm_rank);
 
   MPI_Type_size(datatype, &type_size);
 
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed pipeline */
+  if (!rle_ops) return MPI_Reduce_pipe_sendrecv(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
   if (default_pa.logging) mainlog_printf("MPI_Reduce_pipe_sendrecv: %d  %d  %d\n", count, type_size, comm_size);
 
   if (comm_size == 1)
@@ -103,25 +116,31 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
     goto end;
   }
 
-  if (default_pa.buf_size < default_pa.packet_size || !default_pa.buf[0] || !default_pa.buf[1])
+  packet_size = (default_pa.tune)?pipe_tune_packet_size(comm, (long) count * type_size):default_pa.packet_size;
+
+  if (default_pa.buf_size < packet_size || !default_pa.buf[0] || !default_pa.buf[1])
   {
-    local_pa.packet_size = default_pa.packet_size;
+    local_pa.packet_size = packet_size;
     pipe_attr_alloc_buf(&local_pa, local_pa.packet_size, 2);
     my_pa = &local_pa;
 
   } else my_pa = &default_pa;
 
-  max_packet = my_pa->packet_size / type_size;
+  max_packet = packet_size / type_size;
 
   if (!max_packet)
   {
-    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, type_size, my_pa->packet_size);
+    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, type_size, packet_size);
     max_packet = 1;
   }
 
   npackets = count / max_packet;
   if (count % max_packet) npackets++;
 
+  nsteps = npackets + comm_size - 2;
+
+  if (default_pa.tune) t_tune = MPI_Wtime();
+
   buf0 = my_pa->buf[0];
   buf1 = my_pa->buf[1];
 
@@ -141,20 +160,20 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
       if (current_packet > 0)
       {
 #ifdef RLE_FIRST
-        rle_sendbuf = (double *) buf0;
+        rle_sendbuf = buf0;
 
         timing_sstart();
-        dblv_rle_zero_compress(current_packet, (double *) &sbuf[offset], &rle_sendcount, rle_sendbuf);
+        rle_ops->compress(current_packet, (void *) &sbuf[offset], &rle_sendcount, rle_sendbuf);
         current_times[PIPE_SENDRECV_TRED] += timing_send();
 
         rle_sendcounts += rle_sendcount;
 
         timing_sstart();
-        MPI_Send(rle_sendbuf, rle_sendcount, datatype, next_in_pipe, tag, comm);
+        transport_send(rle_sendbuf, rle_sendcount, datatype, next_in_pipe, tag, comm);
         current_times[PIPE_SENDRECV_TSEND] += timing_send();
 #else
         timing_sstart();
-        MPI_Send(&sbuf[offset], current_packet, datatype, next_in_pipe, tag, comm);
+        transport_send(&sbuf[offset], current_packet, datatype, next_in_pipe, tag, comm);
         current_times[PIPE_SENDRECV_TSEND] += timing_send();
 #endif
       }
@@ -164,7 +183,7 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
       if (current_packet > 0)
       {
         timing_sstart();
-        MPI_Recv(&rbuf[offset], current_packet, datatype, prev_in_pipe, tag, comm, &status);
+        transport_recv(&rbuf[offset], current_packet, datatype, prev_in_pipe, tag, comm, &status);
         current_times[PIPE_SENDRECV_TRECV] += timing_send();
 
 #ifdef RLE
@@ -172,7 +191,7 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
         rle_sendcount = current_packet;
 
         timing_sstart();
-        dblv_rle_zero_cf_uc_add2_ub(rle_recvcount, (double *) &rbuf[offset], current_packet, (double *) &sbuf[offset], &rle_sendcount, &rle_sendbuf);
+        rle_ops->cf_uc_add2_ub(rle_recvcount, &rbuf[offset], current_packet, (void *) &sbuf[offset], &rle_sendcount, (void **) &rle_sendbuf);
         current_times[PIPE_SENDRECV_TRED] += timing_send();
 
         rle_sendcounts += rle_sendcount;
@@ -191,16 +210,16 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
         if (done == 0)
         {
           timing_sstart();
-          MPI_Recv(buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
+          transport_recv(buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
           current_times[PIPE_SENDRECV_TRECV] += timing_send();
 
         } else
         {
           timing_sstart();
 #ifdef RLE
-          MPI_Sendrecv(rle_sendbuf, rle_sendcount, datatype, next_in_pipe, tag, buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
+          transport_sendrecv(rle_sendbuf, rle_sendcount, datatype, next_in_pipe, tag, buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
 #else
-          MPI_Sendrecv(buf1, prev_packet, datatype, next_in_pipe, tag, buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
+          transport_sendrecv(buf1, prev_packet, datatype, next_in_pipe, tag, buf0, current_packet, datatype, prev_in_pipe, tag, comm, &status);
 #endif
           current_times[PIPE_SENDRECV_TSENDRECV] += timing_send();
         }
@@ -210,7 +229,7 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
         rle_sendcount = current_packet;
 
         timing_sstart();
-        dblv_rle_zero_cf_uc_add2_cb(rle_recvcount, (double *) buf0, current_packet, (double *) &sbuf[offset], &rle_sendcount, &rle_sendbuf);
+        rle_ops->cf_uc_add2_cb(rle_recvcount, buf0, current_packet, (void *) &sbuf[offset], &rle_sendcount, (void **) &rle_sendbuf);
         current_times[PIPE_SENDRECV_TRED] += timing_send();
 
         rle_sendcounts += rle_sendcount;
@@ -225,9 +244,9 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
       {
         timing_sstart();
 #ifdef RLE
-        MPI_Send(rle_sendbuf, rle_sendcount, datatype, next_in_pipe, tag, comm);
+        transport_send(rle_sendbuf, rle_sendcount, datatype, next_in_pipe, tag, comm);
 #else
-        MPI_Send(buf1, prev_packet, datatype, next_in_pipe, tag, comm);
+        transport_send(buf1, prev_packet, datatype, next_in_pipe, tag, comm);
 #endif
         current_times[PIPE_SENDRECV_TSEND] += timing_send();
       }
@@ -244,6 +263,17 @@ int MOD_PIPE(MPI_Reduce_pipe_sendrecv)(const void *sendbuf, void *recvbuf, int c
 
   current_times[PIPE_SENDRECV_TLOOP] = timing_send();
 
+  if (default_pa.tune)
+  {
+#ifdef TIMING
+    /* sum of the send, receive and reduction times of the steps */
+    t_tune = current_times[PIPE_SENDRECV_TSEND] + current_times[PIPE_SENDRECV_TRECV] + current_times[PIPE_SENDRECV_TSENDRECV] + current_times[PIPE_SENDRECV_TRED];
+#else
+    t_tune = MPI_Wtime() - t_tune;
+#endif
+    pipe_tune_update(comm, (long) count * type_size, packet_size, nsteps, t_tune);
+  }
+
   if (my_pa == &local_pa) pipe_attr_free_buf(&local_pa);
 
 end:
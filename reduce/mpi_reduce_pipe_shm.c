@@ -0,0 +1,262 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "reduce_op.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_hier.h"
+
+
+// #define RLE
+
+/* Shared-memory pipeline: only the node leaders (see mpi_reduce_hier.h) form the pipeline to the root. For every
+   packet, a leader adds the packets of all processes of its node to the received packet, reading their send
+   buffers directly in shared memory. The other processes of a node copy their send buffers into the window of
+   the node once, or nothing at all if all send buffers were allocated with ZMPI_Reduce_shm_alloc. With RLE, the
+   packets between the leaders are zero-RLE compressed. */
+
+#define PIPE_SHM_TAG  0
+
+#ifndef MOD_PIPE_SHM
+ #define MOD_PIPE_SHM(s) s
+#endif
+
+
+/* out = in_0 + ... + in_(n-1) (init) or out += in_0 + ... + in_(n-1) (!init) for the packet at offset */
+static void pipe_shm_sum(int n, long offset, int ninputs, char **inputs, int init, char *out, MPI_Datatype datatype, MPI_Op op, int type_size)
+{
+  int i = 0;
+
+  if (init)
+  {
+    if (ninputs > 1) reduce_op_3(n, 0, datatype, op, inputs[0] + offset * type_size, inputs[1] + offset * type_size, out);
+    else memcpy(out, inputs[0] + offset * type_size, (long) n * type_size);
+    i = (ninputs > 1)?2:1;
+  }
+
+  for (; i < ninputs; i++) reduce_op_2(n, 0, datatype, op, inputs[i] + offset * type_size, out);
+}
+
+
+int MOD_PIPE_SHM(MPI_Reduce_pipe_shm)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int node_rank, node_size, registered, i, disp_unit;
+  int max_packet, npackets, k, n, prev, next;
+  long offset;
+  MPI_Aint info[4], *infos, size;
+  MPI_Win win;
+
+  char *rbuf = recvbuf;
+  char **inputs, *bufs, *buf[2], *out;
+
+  reduce_hier *rh;
+
+  MPI_Request rreq, sreq[2];
+
+#ifdef RLE
+  const dblv_rle_ops *rle_ops;
+  MPI_Status status;
+  int recv_count, send_count;
+  char *sum, *send_buf;
+#endif
+
+
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed pipeline */
+  if (!rle_ops) return MPI_Reduce_pipe_shm(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  rh = reduce_hier_get(comm, root);
+
+  MPI_Comm_rank(rh->node_comm, &node_rank);
+  MPI_Comm_size(rh->node_comm, &node_size);
+
+  /* the send buffers are read in place if all of them are in the same registered window of the node */
+  registered = reduce_shm_lookup(sendbuf, (MPI_Aint) count * type_size, rh->node_comm, &info[0], &win, &i, &info[3]);
+  info[2] = i;
+
+  infos = malloc(4 * node_size * sizeof(MPI_Aint));
+  MPI_Allgather(info, 4, MPI_AINT, infos, 4, MPI_AINT, rh->node_comm);
+
+  for (i = 0; i < node_size; i++) if (infos[4 * i + 0] != info[0] || infos[4 * i + 1] != info[1]) registered = 0;
+
+  if (!registered)
+  {
+    reduce_hier_alloc(rh, 0, (MPI_Aint) count * type_size);
+    win = rh->win;
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+    if (node_rank != 0)
+    {
+      MPI_Win_shared_query(win, node_rank, &size, &disp_unit, &out);
+      memcpy(out, sendbuf, (long) count * type_size);
+    }
+  }
+
+  /* the send buffers are ready */
+  MPI_Win_sync(win);
+  MPI_Barrier(rh->node_comm);
+  MPI_Win_sync(win);
+
+  if (node_rank != 0) goto done;
+
+  inputs = malloc(node_size * sizeof(char *));
+
+  inputs[0] = (char *) sendbuf;
+
+  for (i = 1; i < node_size; i++)
+  {
+    if (registered)
+    {
+      MPI_Win_shared_query(win, (int) infos[4 * i + 2], &size, &disp_unit, &inputs[i]);
+      inputs[i] += infos[4 * i + 3];
+
+    } else MPI_Win_shared_query(win, i, &size, &disp_unit, &inputs[i]);
+  }
+
+  /* pipeline of the node leaders */
+  comm = rh->leader_comm;
+  root = rh->leader_root;
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  prev = prev_in_pipe;
+  next = next_in_pipe;
+
+  max_packet = default_pa.packet_size / type_size;
+
+  if (max_packet <= 0)
+  {
+    verbose_printf("%d here: size of datatype (%d bytes) exceeds packet size (%d bytes)!\n", comm_rank, type_size, default_pa.packet_size);
+    max_packet = 1;
+  }
+
+  npackets = (count + max_packet - 1) / max_packet;
+
+#ifdef RLE
+  bufs = malloc(3 * (long) max_packet * type_size);
+  sum = bufs + 2 * (long) max_packet * type_size;
+#else
+  bufs = (next >= 0)?malloc(2 * (long) max_packet * type_size):NULL;
+#endif
+  buf[0] = bufs;
+  buf[1] = bufs + (long) max_packet * type_size;
+
+  rreq = sreq[0] = sreq[1] = MPI_REQUEST_NULL;
+
+  if (prev >= 0) MPI_Irecv((next < 0)?rbuf:buf[0], (max_packet < count)?max_packet:count, datatype, prev, PIPE_SHM_TAG, comm, &rreq);
+
+  for (k = 0; k < npackets; k++)
+  {
+    offset = (long) k * max_packet;
+    n = count - k * max_packet; if (n > max_packet) n = max_packet;
+
+    out = (next < 0)?(rbuf + offset * type_size):buf[k % 2];
+
+    if (prev >= 0)
+    {
+#ifdef RLE
+      MPI_Wait(&rreq, &status);
+      MPI_Get_count(&status, datatype, &recv_count);
+#else
+      MPI_Wait(&rreq, MPI_STATUS_IGNORE);
+#endif
+
+      /* the next packet is received into the buffer of the previous send */
+      if (k + 1 < npackets)
+      {
+        MPI_Wait(&sreq[(k + 1) % 2], MPI_STATUS_IGNORE);
+        MPI_Irecv((next < 0)?(rbuf + (offset + max_packet) * type_size):buf[(k + 1) % 2], (count - (k + 1) * max_packet < max_packet)?(count - (k + 1) * max_packet):max_packet,
+          datatype, prev, PIPE_SHM_TAG, comm, &rreq);
+      }
+
+    } else MPI_Wait(&sreq[k % 2], MPI_STATUS_IGNORE);
+
+#ifdef RLE
+    pipe_shm_sum(n, offset, node_size, inputs, 1, sum, datatype, op, type_size);
+
+    send_count = n;
+
+    if (prev < 0)
+    {
+      if (next < 0) memcpy(out, sum, (long) n * type_size);
+      else
+      {
+        rle_ops->compress(n, sum, &send_count, out);
+        send_buf = out;
+      }
+
+    } else if (next < 0) rle_ops->cf_uc_add2_ub(recv_count, out, n, sum, &send_count, NULL);
+    else rle_ops->cf_uc_add2_cb(recv_count, out, n, sum, &send_count, (void **) &send_buf);
+
+    if (next >= 0) MPI_Isend(send_buf, send_count, datatype, next, PIPE_SHM_TAG, comm, &sreq[k % 2]);
+#else
+    pipe_shm_sum(n, offset, node_size, inputs, (prev < 0), out, datatype, op, type_size);
+
+    if (next >= 0) MPI_Isend(out, n, datatype, next, PIPE_SHM_TAG, comm, &sreq[k % 2]);
+#endif
+  }
+
+  MPI_Waitall(2, sreq, MPI_STATUSES_IGNORE);
+
+  free(bufs);
+  free(inputs);
+
+done:
+
+  /* the send buffers are no longer read */
+  MPI_Win_sync(win);
+  MPI_Barrier(rh->node_comm);
+
+  if (!registered) MPI_Win_unlock_all(win);
+
+  free(infos);
+
+end:
+
+  return MPI_SUCCESS;
+}
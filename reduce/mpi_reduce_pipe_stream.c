@@ -28,17 +28,33 @@
 #include "trace.h"
 #include "reduce_op.h"
 #include "logging.h"
+#include "reduce_transport.h"
 
 #ifdef USE_DBLV
  #include "dblv.h"
 #endif
 
 #include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
 
 /*#define RLE*/
 /*#define RLE_PACKET*/
 /*#define RLE_PACKET_FIRST_UNCOMPRESSED*/
 /*#define RLE_PACKET_THRESHOLD  1.0*/
+/*#define RLE_PACKET_ADAPTIVE*/
+
+#ifdef RLE_PACKET_ADAPTIVE
+ /* raw or compressed is decided for every packet, the packets are tagged accordingly */
+ #undef RLE_PACKET_FIRST_UNCOMPRESSED
+ #undef RLE_PACKET_THRESHOLD
+ #define PIPE_STREAM_TAG_RAW  3
+ #define PIPE_STREAM_RECV_TAG  MPI_ANY_TAG
+ #define PIPE_STREAM_SAMPLES  64
+ /* expected compression ratio of randomly placed non-zeros: each non-zero plus a zero run behind it */
+ #define PIPE_STREAM_RATIO(f)  ((f) + (f) * (1.0 - (f)))
+#else
+ #define PIPE_STREAM_RECV_TAG  tag
+#endif
 
 #ifndef MOD_PIPE_STREAM
  #define MOD_PIPE_STREAM(s) s
@@ -52,19 +68,28 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
 
   const int tag = 0;
 
-  int max_packet, sends, recvs;
+  int packet_size, max_packet, sends, recvs;
+  double t_tune = 0.0;
   int received, receivedc, processed, processedc;
 
   int iam_first_in_pipe, iam_last_in_pipe;
 
+  int stag = tag;
+
   const char *sbuf = sendbuf;
   char *rbuf = recvbuf;
   char *pbufs, *pbufr, *pbuf0, *pbuf1, *pbuft;
 
 #ifdef RLE
+  const dblv_rle_ops *rle_ops;
  #ifndef RLE_PACKET
+  /* carry of a zero run, large enough for a token of every supported datatype */
   double vin0_next = 0.0;
  #endif
+ #ifdef RLE_PACKET_ADAPTIVE
+  int rtag = tag;
+  double threshold, ratio;
+ #endif
 #endif
 
   int sendc = 0, recvc = 0;
@@ -73,29 +98,44 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
 
   pipe_attr local_pa, *my_pa;
 
-  MPI_Comm_rank(comm, &comm_rank);
-  MPI_Comm_size(comm, &comm_size);
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
+  transport_comm_rank(comm, &comm_rank);
+  transport_comm_size(comm, &comm_size);
 
   iam_first_in_pipe = (first_in_pipe == comm_rank);
   iam_last_in_pipe = (last_in_pipe == comm_rank);
 
   MPI_Type_size(datatype, &type_size);
 
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed pipeline */
+  if (!rle_ops) return MPI_Reduce_pipe_stream(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
+#ifdef RLE_PACKET_ADAPTIVE
+  threshold = (default_pa.rle_threshold > 0)?default_pa.rle_threshold:PIPE_RLE_THRESHOLD;
+#endif
+
   if (comm_size == 1)
   {
     memcpy(recvbuf, sendbuf, type_size * count);
     goto end;
   }
 
-  if (default_pa.buf_size < default_pa.packet_size || !default_pa.buf[0] || !default_pa.buf[1])
+  packet_size = (default_pa.tune)?pipe_tune_packet_size(comm, (long) count * type_size):default_pa.packet_size;
+
+  if (default_pa.buf_size < packet_size || !default_pa.buf[0] || !default_pa.buf[1])
   {
-    local_pa.packet_size = default_pa.packet_size;
+    local_pa.packet_size = packet_size;
     pipe_attr_alloc_buf(&local_pa, local_pa.packet_size, 2);
     my_pa = &local_pa;
 
   } else my_pa = &default_pa;
 
-  max_packet = my_pa->packet_size / type_size;
+  max_packet = packet_size / type_size;
 
   pbuf0 = my_pa->buf[0];
   pbuf1 = my_pa->buf[1];
@@ -106,6 +146,8 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
   sends = recvs = 0;
   received = receivedc = processed = processedc = 0;
 
+  if (default_pa.tune) t_tune = MPI_Wtime();
+
   while (sends < count || recvs < count)
   {
     if (iam_first_in_pipe)
@@ -122,15 +164,28 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
  #ifdef RLE_PACKET
       received = count - recvs; if (received > max_packet) received = max_packet;
       processed = processedc = received;
-  #ifndef RLE_PACKET_FIRST_UNCOMPRESSED
-      dblv_rle_zero_compress2(received, (double *) sbuf, &processedc, (double *) pbufs);
+  #if defined(RLE_PACKET_ADAPTIVE)
+      /* dense packets are sent uncompressed */
+      if (PIPE_STREAM_RATIO(reduce_nonzero_fraction(datatype, received, sbuf, PIPE_STREAM_SAMPLES)) > threshold)
+      {
+        pbufs = (char *) sbuf;
+        stag = PIPE_STREAM_TAG_RAW;
+
+      } else
+      {
+        pbufs = pbuf1;
+        rle_ops->compress(received, (void *) sbuf, &processedc, pbufs);
+        stag = tag;
+      }
+  #elif !defined(RLE_PACKET_FIRST_UNCOMPRESSED)
+      rle_ops->compress(received, (void *) sbuf, &processedc, pbufs);
   #else
       pbufs = (char *) sbuf;
   #endif
       /* prepare send-buffer */
  #else
       received = count - recvs;
-      dblv_rle_zero_compress3(received, (double *) sbuf, max_packet, (double *) pbufs, &processed, &processedc);
+      rle_ops->compress3(received, (void *) sbuf, max_packet, pbufs, &processed, &processedc);
 /*      processed = processedc = (received > max_packet)?max_packet:received;*/
       /* prepare send-buffer */
  #endif
@@ -140,7 +195,7 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
       recvs += processed;
 
       /* send */
-      MPI_Send(pbufs, processedc, datatype, next_in_pipe, tag, comm); sendc += processedc;
+      transport_send(pbufs, processedc, datatype, next_in_pipe, stag, comm); sendc += processedc;
       sends += processed;
 
     } else if (iam_last_in_pipe)
@@ -154,7 +209,7 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
 #endif
 
       /* recv */
-      MPI_Recv(pbufr, max_packet, datatype, prev_in_pipe, tag, comm, &status);
+      transport_recv(pbufr, max_packet, datatype, prev_in_pipe, PIPE_STREAM_RECV_TAG, comm, &status);
       MPI_Get_count(&status, datatype, &receivedc); recvc += receivedc;
 
       /* op */
@@ -167,10 +222,14 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
       /* calculate packet size, for backward-decompression! */
       received = count - recvs; if (received > max_packet) received = max_packet;
       processed = processedc = received;
-      dblv_rle_zero_cf_uc_add2_ub(receivedc, (double *) pbufr, received, (double *) sbuf, &processedc, NULL);
+  #ifdef RLE_PACKET_ADAPTIVE
+      if (status.MPI_TAG == PIPE_STREAM_TAG_RAW) reduce_op_2(received, 0, datatype, op, sbuf, pbufr);
+      else
+  #endif
+      rle_ops->cf_uc_add2_ub(receivedc, pbufr, received, (void *) sbuf, &processedc, NULL);
       /* prepare recv-buffer */
  #else
-      dblv_rle_zero_cf_uc_add3_uc(receivedc, (double *) pbufr, count - recvs, (double *) sbuf, count - recvs, (double *) rbuf, &received, &processed, &processedc, &vin0_next);
+      rle_ops->cf_uc_add3_uc(receivedc, pbufr, count - recvs, (void *) sbuf, count - recvs, rbuf, &received, &processed, &processedc, &vin0_next);
 /*      received = receivedc;
       processed = processedc = received;*/
       receivedc -= received; if (receivedc != 0) printf("ERROR: root hast receivedc != 0 (%d)\n", receivedc);
@@ -192,23 +251,26 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
         if (processedc <= 0)  /* nothing to send? */
         {
           /* recv */
-          MPI_Recv(pbufr, max_packet, datatype, prev_in_pipe, tag, comm, &status);
+          transport_recv(pbufr, max_packet, datatype, prev_in_pipe, PIPE_STREAM_RECV_TAG, comm, &status);
 
         } else  /* something to send! */
         {
           /* send / recv */
-          MPI_Sendrecv(pbufs, processedc, datatype, next_in_pipe, tag, pbufr, max_packet, datatype, prev_in_pipe, tag, comm, &status); sendc += processedc;
+          transport_sendrecv(pbufs, processedc, datatype, next_in_pipe, stag, pbufr, max_packet, datatype, prev_in_pipe, PIPE_STREAM_RECV_TAG, comm, &status); sendc += processedc;
           sends += processed;
         }
 
         MPI_Get_count(&status, datatype, &receivedc); recvc += receivedc;
+#ifdef RLE_PACKET_ADAPTIVE
+        rtag = status.MPI_TAG;
+#endif
 
       } else  /* something received or nothing left to receive! */
       {
         if (processedc > 0)  /* something to send? */
         {
           /* send */
-          MPI_Send(pbufs, processedc, datatype, next_in_pipe, tag, comm); sendc += processedc;
+          transport_send(pbufs, processedc, datatype, next_in_pipe, stag, comm); sendc += processedc;
           sends += processed;
         }
       }
@@ -229,13 +291,52 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
       /* calculate packet size, for backward-decompression! */
       received = count - recvs; if (received > max_packet) received = max_packet;
       processed = processedc = received;
-#ifndef RLE_PACKET_THRESHOLD
+#if defined(RLE_PACKET_ADAPTIVE)
+      if (received > 0)
+      {
+        /* estimated ratio of the result from the own packet and the received packet (sampled if raw, otherwise its actual ratio) */
+        ratio = reduce_nonzero_fraction(datatype, received, sbuf, PIPE_STREAM_SAMPLES);
+        if (rtag == PIPE_STREAM_TAG_RAW)
+        {
+          ratio += reduce_nonzero_fraction(datatype, received, pbufr, PIPE_STREAM_SAMPLES);
+          ratio = PIPE_STREAM_RATIO((ratio < 1.0)?ratio:1.0);
+
+          if (ratio > threshold)
+          {
+            reduce_op_2(received, 0, datatype, op, sbuf, pbufr);
+            pbufs = pbufr;
+            stag = PIPE_STREAM_TAG_RAW;
+
+          } else
+          {
+            rle_ops->uc_uc_add2_cf(received, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
+            stag = tag;
+          }
+
+        } else
+        {
+          ratio = PIPE_STREAM_RATIO(ratio);
+          if (ratio < (double) receivedc / received) ratio = (double) receivedc / received;
+
+          if (ratio > threshold)
+          {
+            rle_ops->cf_uc_add2_ub(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
+            stag = PIPE_STREAM_TAG_RAW;
+
+          } else
+          {
+            rle_ops->cf_uc_add2_cb(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
+            stag = tag;
+          }
+        }
+      }
+#elif !defined(RLE_PACKET_THRESHOLD)
 /*      printf("%d here: X  %d\n", comm_rank, receivedc);*/
   #ifdef RLE_PACKET_FIRST_UNCOMPRESSED
-      if (second_in_pipe == comm_rank) dblv_rle_zero_uc_uc_add2_cf(receivedc, (double *) pbufr, received, (double *) sbuf, &processedc, (double **) &pbufs);
+      if (second_in_pipe == comm_rank) rle_ops->uc_uc_add2_cf(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
       else
   #endif
-        dblv_rle_zero_cf_uc_add2_cb(receivedc, (double *) pbufr, received, (double *) sbuf, &processedc, (double **) &pbufs);
+        rle_ops->cf_uc_add2_cb(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
 #else
 /*      printf("%d here: %d >= %d (max_packet = %d)\n", comm_rank, receivedc, received, max_packet);*/
       /* uncompressed? */
@@ -243,7 +344,7 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
       {
 /*        printf("%d here: Z  %d\n", comm_rank, received);*/
   #ifdef RLE_PACKET_FIRST_UNCOMPRESSED
-        if (second_in_pipe == comm_rank) dblv_rle_zero_uc_uc_add2_cf(receivedc, (double *) pbufr, received, (double *) sbuf, &processedc, (double **) &pbufs);
+        if (second_in_pipe == comm_rank) rle_ops->uc_uc_add2_cf(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
         else
   #endif
           reduce_op_2(received, 0, datatype, op, sbuf, pbufr);
@@ -254,12 +355,12 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
         if (received * RLE_PACKET_THRESHOLD < receivedc)
         {
 /*          printf("%d here: X  %d\n", comm_rank, receivedc);*/
-          dblv_rle_zero_cf_uc_add2_ub(receivedc, (double *) pbufr, received, (double *) sbuf, &processedc, (double **) &pbufs);
+          rle_ops->cf_uc_add2_ub(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
 
         } else
         {
 /*          printf("%d here: Y\n", comm_rank);*/
-          dblv_rle_zero_cf_uc_add2_cb(receivedc, (double *) pbufr, received, (double *) sbuf, &processedc, (double **) &pbufs);
+          rle_ops->cf_uc_add2_cb(receivedc, pbufr, received, (void *) sbuf, &processedc, (void **) &pbufs);
         }
       }
 #endif
@@ -269,7 +370,7 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
       pbufr = pbuf0;
       received = receivedc = 0;
  #else
-      dblv_rle_zero_cf_uc_add3_cf(receivedc, (double *) pbufr, count - recvs, (double *) sbuf, max_packet, (double *) pbufs, &received, &processed, &processedc, &vin0_next);
+      rle_ops->cf_uc_add3_cf(receivedc, pbufr, count - recvs, (void *) sbuf, max_packet, pbufs, &received, &processed, &processedc, &vin0_next);
       receivedc -= received; if (receivedc > 0) pbufr += received * type_size; else pbufr = pbuf0;
  #endif
 #endif
@@ -279,6 +380,9 @@ int MOD_PIPE_STREAM(MPI_Reduce_pipe_stream)(const void *sendbuf, void *recvbuf,
     }
   }
 
+  /* steps of the pipeline: packets plus the fill */
+  if (default_pa.tune) pipe_tune_update(comm, (long) count * type_size, packet_size, (count + max_packet - 1) / max_packet + comm_size - 2, MPI_Wtime() - t_tune);
+
   if (my_pa == &local_pa) pipe_attr_free_buf(&local_pa);
 
 end:
@@ -34,6 +34,7 @@
 #endif
 
 #include "mpi_reduce_pipe.h"
+#include "mpi_reduce_topo.h"
 
 
 int MPI_Reduce_pipe_stream_plain(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
@@ -55,6 +56,8 @@ int MPI_Reduce_pipe_stream_plain(const void *sendbuf, void *recvbuf, int count,
 
   pipe_attr local_pa, *my_pa;
 
+  if (default_pa.topo) comm = reduce_topo_comm(comm, &root);
+
   MPI_Comm_rank(comm, &comm_rank);
   MPI_Comm_size(comm, &comm_size);
 
@@ -0,0 +1,305 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+
+#include "mpi_reduce_pipe.h"
+
+
+/* Online packet size tuning of the pipeline algorithms (default_pa.tune). Every communicator keeps a state for
+   every size class (log2 of the bytes of the vectors) as an MPI attribute. While a class is tuned, every call is a
+   probe: the per-step time of the pipeline (maximum of all processes) is measured for the packet size of the call.
+   The per-step time is modeled as alpha + c * packet_size, fitted to all probes, and the next probe is the packet
+   size that minimizes (comm_size - 2 + bytes / packet_size) * (alpha + c * packet_size). The class is converged if
+   this packet size was already probed (or after PIPE_TUNE_PROBES calls), the fastest probe is kept.
+
+   Converged choices are kept per (comm_size, size class) and used by new communicators. They are read from the file
+   given by the environment variable ZMPI_PIPE_TUNE_FILE at the first use and written to it by rank 0 of
+   MPI_COMM_WORLD on every convergence (or with pipe_tune_load and pipe_tune_save). The state of a size class is
+   initialized with the choice of rank 0 of the communicator, such that all processes use the same packet sizes. */
+
+#define PIPE_TUNE_CLASSES     64
+#define PIPE_TUNE_PROBES      6
+#define PIPE_TUNE_MIN_PACKET  (4 * 1024)
+#define PIPE_TUNE_MAX_PACKET  (16 * 1024 * 1024)
+
+
+typedef struct _pipe_tune_class
+{
+  int packet_size, converged;
+
+  int nprobes;
+  int probe_size[PIPE_TUNE_PROBES];
+  double probe_step[PIPE_TUNE_PROBES], probe_time[PIPE_TUNE_PROBES];
+
+} pipe_tune_class;
+
+typedef struct _pipe_tune_choice
+{
+  int comm_size, size_class, packet_size;
+
+} pipe_tune_choice;
+
+static int pipe_tune_keyval = MPI_KEYVAL_INVALID;
+
+static pipe_tune_choice *pipe_tune_choices = NULL;
+static int pipe_tune_nchoices = 0, pipe_tune_alloc = 0, pipe_tune_loaded = 0;
+
+
+static int pipe_tune_delete(MPI_Comm comm, int keyval, void *attribute_val, void *extra_state)
+{
+  free(attribute_val);
+
+  return MPI_SUCCESS;
+}
+
+
+static int pipe_tune_size_class(long bytes)
+{
+  int c;
+
+  for (c = 0; c < PIPE_TUNE_CLASSES - 1 && (1L << (c + 1)) <= bytes; c++);
+
+  return c;
+}
+
+
+static pipe_tune_class *pipe_tune_get_class(MPI_Comm comm, int size_class)
+{
+  pipe_tune_class *classes;
+  int flag;
+  char *filename;
+
+  if (!pipe_tune_loaded)
+  {
+    filename = getenv("ZMPI_PIPE_TUNE_FILE");
+    if (filename) pipe_tune_load(filename);
+    pipe_tune_loaded = 1;
+  }
+
+  if (pipe_tune_keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, pipe_tune_delete, &pipe_tune_keyval, NULL);
+
+  MPI_Comm_get_attr(comm, pipe_tune_keyval, &classes, &flag);
+
+  if (!flag)
+  {
+    classes = calloc(PIPE_TUNE_CLASSES, sizeof(pipe_tune_class));
+    MPI_Comm_set_attr(comm, pipe_tune_keyval, classes);
+  }
+
+  return &classes[size_class];
+}
+
+
+/* power of two within the limits and not larger than needed for the vector */
+static int pipe_tune_round(double packet_size, long bytes)
+{
+  int p;
+
+  for (p = PIPE_TUNE_MIN_PACKET; p < PIPE_TUNE_MAX_PACKET && p < packet_size && p < bytes; p *= 2);
+
+  return p;
+}
+
+
+static void pipe_tune_choose(int comm_size, int size_class, int packet_size)
+{
+  int i;
+
+  for (i = 0; i < pipe_tune_nchoices; i++)
+  if (pipe_tune_choices[i].comm_size == comm_size && pipe_tune_choices[i].size_class == size_class)
+  {
+    pipe_tune_choices[i].packet_size = packet_size;
+    return;
+  }
+
+  if (pipe_tune_nchoices >= pipe_tune_alloc)
+  {
+    pipe_tune_alloc = (pipe_tune_alloc > 0)?(2 * pipe_tune_alloc):16;
+    pipe_tune_choices = realloc(pipe_tune_choices, pipe_tune_alloc * sizeof(pipe_tune_choice));
+  }
+
+  pipe_tune_choices[pipe_tune_nchoices].comm_size = comm_size;
+  pipe_tune_choices[pipe_tune_nchoices].size_class = size_class;
+  pipe_tune_choices[pipe_tune_nchoices].packet_size = packet_size;
+  pipe_tune_nchoices++;
+}
+
+
+int pipe_tune_packet_size(MPI_Comm comm, long bytes)
+{
+  int comm_size, i, size_class = pipe_tune_size_class(bytes);
+  pipe_tune_class *tc = pipe_tune_get_class(comm, size_class);
+  int seed[2];
+
+  if (tc->packet_size > 0) return tc->packet_size;
+
+  MPI_Comm_size(comm, &comm_size);
+
+  /* the first probe uses the configured packet size */
+  seed[0] = pipe_tune_round((default_pa.packet_size > 0)?default_pa.packet_size:PIPE_TUNE_MIN_PACKET, bytes);
+  seed[1] = 0;
+
+  /* a previous choice for the same number of processes and size class */
+  for (i = 0; i < pipe_tune_nchoices; i++)
+  if (pipe_tune_choices[i].comm_size == comm_size && pipe_tune_choices[i].size_class == size_class)
+  {
+    seed[0] = pipe_tune_choices[i].packet_size;
+    seed[1] = 1;
+    break;
+  }
+
+  /* the choices (and the files they were read from) may differ between the processes, all use those of rank 0 */
+  MPI_Bcast(seed, 2, MPI_INT, 0, comm);
+
+  tc->packet_size = seed[0];
+  tc->converged = seed[1];
+
+  return tc->packet_size;
+}
+
+
+void pipe_tune_update(MPI_Comm comm, long bytes, int packet_size, int nsteps, double time)
+{
+  int comm_size, world_rank, i, best, next, size_class = pipe_tune_size_class(bytes);
+  pipe_tune_class *tc = pipe_tune_get_class(comm, size_class);
+  double sm, ss, smm, sms, alpha, c, m;
+  char *filename;
+
+  if (tc->converged || packet_size != tc->packet_size) return;
+
+  MPI_Comm_size(comm, &comm_size);
+
+  /* all processes have to make the same decision */
+  MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+  tc->probe_size[tc->nprobes] = packet_size;
+  tc->probe_step[tc->nprobes] = time / ((nsteps > 0)?nsteps:1);
+  tc->probe_time[tc->nprobes] = time;
+  tc->nprobes++;
+
+  best = 0;
+  for (i = 1; i < tc->nprobes; i++) if (tc->probe_time[i] < tc->probe_time[best]) best = i;
+
+  next = -1;
+
+  if (tc->nprobes == 1)
+  {
+    /* a second point for the fit */
+    next = pipe_tune_round(packet_size / 4, bytes);
+    if (next == packet_size) next = pipe_tune_round(packet_size * 4, bytes);
+
+  } else if (tc->nprobes < PIPE_TUNE_PROBES)
+  {
+    /* least squares fit of the per-step time */
+    sm = ss = smm = sms = 0.0;
+    for (i = 0; i < tc->nprobes; i++)
+    {
+      sm += tc->probe_size[i];
+      ss += tc->probe_step[i];
+      smm += (double) tc->probe_size[i] * tc->probe_size[i];
+      sms += tc->probe_size[i] * tc->probe_step[i];
+    }
+
+    c = (tc->nprobes * smm - sm * sm != 0)?((tc->nprobes * sms - sm * ss) / (tc->nprobes * smm - sm * sm)):0.0;
+    alpha = (ss - c * sm) / tc->nprobes;
+
+    if (c > 0 && alpha > 0)
+    {
+      m = (comm_size > 2)?sqrt(bytes * alpha / ((comm_size - 2) * c)):bytes;
+      next = pipe_tune_round(m, bytes);
+
+    } else if (tc->nprobes == 2)
+    {
+      /* no usable fit, continue beyond the faster of the two */
+      next = (tc->probe_size[best] < tc->probe_size[1 - best])?pipe_tune_round(tc->probe_size[best] / 4, bytes):pipe_tune_round(tc->probe_size[best] * 4.0, bytes);
+    }
+  }
+
+  /* converged if the next packet size was already probed */
+  for (i = 0; i < tc->nprobes; i++) if (tc->probe_size[i] == next) next = -1;
+
+  if (next > 0)
+  {
+    tc->packet_size = next;
+    return;
+  }
+
+  tc->packet_size = tc->probe_size[best];
+  tc->converged = 1;
+
+  pipe_tune_choose(comm_size, size_class, tc->packet_size);
+
+  filename = getenv("ZMPI_PIPE_TUNE_FILE");
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+  if (filename && world_rank == 0) pipe_tune_save(filename);
+}
+
+
+int pipe_tune_converged(MPI_Comm comm, long bytes)
+{
+  return pipe_tune_get_class(comm, pipe_tune_size_class(bytes))->converged;
+}
+
+
+int pipe_tune_load(const char *filename)
+{
+  FILE *file;
+  char line[128];
+  int comm_size, size_class, packet_size;
+
+  pipe_tune_loaded = 1;
+
+  file = fopen(filename, "r");
+  if (!file) return 1;
+
+  while (fgets(line, sizeof(line), file))
+  {
+    if (line[0] == '#') continue;
+
+    if (sscanf(line, "%d %d %d", &comm_size, &size_class, &packet_size) == 3 && packet_size > 0) pipe_tune_choose(comm_size, size_class, packet_size);
+  }
+
+  fclose(file);
+
+  return MPI_SUCCESS;
+}
+
+
+int pipe_tune_save(const char *filename)
+{
+  FILE *file;
+  int i;
+
+  file = fopen(filename, "w");
+  if (!file) return 1;
+
+  fprintf(file, "# pipeline packet sizes: comm_size  size class (log2 bytes)  packet_size\n");
+
+  for (i = 0; i < pipe_tune_nchoices; i++) fprintf(file, "%d %d %d\n", pipe_tune_choices[i].comm_size, pipe_tune_choices[i].size_class, pipe_tune_choices[i].packet_size);
+
+  fclose(file);
+
+  return MPI_SUCCESS;
+}
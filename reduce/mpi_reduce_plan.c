@@ -0,0 +1,301 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <mpi.h>
+
+#include "reduce_op.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_common.h"
+#include "mpi_ireduce_pipe.h"
+#include "mpi_reduce_plan.h"
+
+
+#define PLAN_GATHER_TAG  2
+
+#if MPI_VERSION >= 4
+ #define PLAN_MPI_PERSISTENT
+#endif
+
+struct _ZMPI_Reduce_plan
+{
+  int algorithm, active;
+
+  const void *sendbuf;
+  void *recvbuf;
+  int count, type_size;
+  MPI_Datatype datatype;
+  MPI_Op op;
+  int root;
+  MPI_Comm comm;
+
+  /* pipeline */
+  ZMPI_Ireduce_pipe_request pipe;
+
+  /* gather: preallocated receive (root) or compression buffer, number of processes received from (root) */
+  int comm_rank, comm_size;
+  const dblv_rle_ops *rle_ops;
+  char *tbuf;
+  int recvs;
+
+  MPI_Request request;
+};
+
+
+int ZMPI_Reduce_init(int algorithm, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Reduce_plan *plan)
+{
+  ZMPI_Reduce_plan p;
+
+  *plan = ZMPI_REDUCE_PLAN_NULL;
+
+  if (algorithm < 0 || algorithm > ZMPI_REDUCE_PLAN_MPI) return 1;
+
+  int ret = MPI_Reduce_check(sendbuf, recvbuf, count, datatype, op, root, comm);
+  if (ret != MPI_SUCCESS)
+  {
+    return ret;
+  }
+
+  p = calloc(1, sizeof(struct _ZMPI_Reduce_plan));
+
+  p->algorithm = algorithm;
+  p->sendbuf = sendbuf;
+  p->recvbuf = recvbuf;
+  p->count = count;
+  p->datatype = datatype;
+  p->op = op;
+  p->root = root;
+  p->comm = comm;
+
+  MPI_Type_size(datatype, &p->type_size);
+  MPI_Comm_rank(comm, &p->comm_rank);
+  MPI_Comm_size(comm, &p->comm_size);
+
+  p->pipe = ZMPI_IREDUCE_PIPE_REQUEST_NULL;
+  p->request = MPI_REQUEST_NULL;
+
+  switch (algorithm)
+  {
+    case ZMPI_REDUCE_PLAN_GATHER:
+    case ZMPI_REDUCE_PLAN_GATHER_RLE:
+      /* datatypes without zero-run encoding use the uncompressed gather */
+      p->rle_ops = (algorithm == ZMPI_REDUCE_PLAN_GATHER_RLE)?reduce_rle_ops(datatype, op):NULL;
+      if (p->comm_size > 1 && (p->comm_rank == root || p->rle_ops)) p->tbuf = malloc((size_t) count * p->type_size);
+      break;
+    case ZMPI_REDUCE_PLAN_MPI:
+#ifdef PLAN_MPI_PERSISTENT
+      ret = MPI_Reduce_init(sendbuf, recvbuf, count, datatype, op, root, comm, MPI_INFO_NULL, &p->request);
+#endif
+      break;
+    default:
+      ret = ZMPI_Reduce_pipe_init(algorithm, sendbuf, recvbuf, count, datatype, op, root, comm, &p->pipe);
+      break;
+  }
+
+  if (ret != MPI_SUCCESS)
+  {
+    free(p);
+    return ret;
+  }
+
+  *plan = p;
+
+  return MPI_SUCCESS;
+}
+
+
+/* the sources are received in a fixed order, with MPI_ANY_SOURCE a process that already started the next
+   reduction could be received twice */
+static void plan_gather_post(ZMPI_Reduce_plan p)
+{
+  MPI_Irecv(p->tbuf, p->count, p->datatype, (p->root + 1 + p->recvs) % p->comm_size, PLAN_GATHER_TAG, p->comm, &p->request);
+}
+
+
+static void plan_gather_start(ZMPI_Reduce_plan p)
+{
+  int sendc;
+  const void *sbuf;
+
+  if (p->comm_size == 1)
+  {
+    MPI_Reduce_self(p->sendbuf, p->recvbuf, p->count, p->datatype, p->op, p->root, p->comm);
+    return;
+  }
+
+  if (p->count <= 0) return;
+
+  if (p->comm_rank == p->root)
+  {
+    memcpy(p->recvbuf, p->sendbuf, (size_t) p->count * p->type_size);
+
+    p->recvs = 0;
+    plan_gather_post(p);
+
+  } else
+  {
+    sendc = p->count;
+    sbuf = p->sendbuf;
+
+    if (p->rle_ops)
+    {
+      p->rle_ops->compress(p->count, (void *) p->sendbuf, &sendc, p->tbuf);
+      sbuf = p->tbuf;
+    }
+
+    MPI_Isend(sbuf, sendc, p->datatype, p->root, PLAN_GATHER_TAG, p->comm, &p->request);
+  }
+}
+
+
+static int plan_gather_test(ZMPI_Reduce_plan p)
+{
+  int flag, receivedc, processedc;
+  MPI_Status status;
+
+  while (p->request != MPI_REQUEST_NULL)
+  {
+    MPI_Test(&p->request, &flag, &status);
+    if (!flag) return 0;
+
+    if (p->comm_rank != p->root) break;
+
+    if (p->rle_ops)
+    {
+      MPI_Get_count(&status, p->datatype, &receivedc);
+      processedc = p->count;
+      p->rle_ops->uc_cf_add2_uc(p->count, p->recvbuf, receivedc, p->tbuf, &processedc, NULL);
+
+    } else reduce_op_2(p->count, 0, p->datatype, p->op, p->tbuf, p->recvbuf);
+
+    p->recvs++;
+
+    if (p->recvs < p->comm_size - 1) plan_gather_post(p);
+  }
+
+  return 1;
+}
+
+
+int ZMPI_Reduce_start(ZMPI_Reduce_plan plan)
+{
+  if (plan == ZMPI_REDUCE_PLAN_NULL || plan->active) return 1;
+
+  plan->active = 1;
+
+  switch (plan->algorithm)
+  {
+    case ZMPI_REDUCE_PLAN_GATHER:
+    case ZMPI_REDUCE_PLAN_GATHER_RLE:
+      plan_gather_start(plan);
+      break;
+    case ZMPI_REDUCE_PLAN_MPI:
+#ifdef PLAN_MPI_PERSISTENT
+      MPI_Start(&plan->request);
+#else
+      MPI_Ireduce(plan->sendbuf, plan->recvbuf, plan->count, plan->datatype, plan->op, plan->root, plan->comm, &plan->request);
+#endif
+      break;
+    default:
+      ZMPI_Ireduce_pipe_start(&plan->pipe);
+      break;
+  }
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Reduce_test(ZMPI_Reduce_plan plan, int *flag)
+{
+  *flag = 1;
+
+  if (plan == ZMPI_REDUCE_PLAN_NULL || !plan->active) return MPI_SUCCESS;
+
+  switch (plan->algorithm)
+  {
+    case ZMPI_REDUCE_PLAN_GATHER:
+    case ZMPI_REDUCE_PLAN_GATHER_RLE:
+      *flag = plan_gather_test(plan);
+      break;
+    case ZMPI_REDUCE_PLAN_MPI:
+      MPI_Test(&plan->request, flag, MPI_STATUS_IGNORE);
+      break;
+    default:
+      ZMPI_Ireduce_pipe_test(&plan->pipe, flag);
+      break;
+  }
+
+  if (*flag) plan->active = 0;
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Reduce_wait(ZMPI_Reduce_plan plan)
+{
+  int flag;
+
+  while (1)
+  {
+    ZMPI_Reduce_test(plan, &flag);
+    if (flag) break;
+
+    sched_yield();
+  }
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Reduce_plan_free(ZMPI_Reduce_plan *plan)
+{
+  ZMPI_Reduce_plan p = *plan;
+
+  if (p == ZMPI_REDUCE_PLAN_NULL) return MPI_SUCCESS;
+
+  if (p->active) ZMPI_Reduce_wait(p);
+
+  ZMPI_Ireduce_pipe_request_free(&p->pipe);
+
+#ifdef PLAN_MPI_PERSISTENT
+  if (p->request != MPI_REQUEST_NULL) MPI_Request_free(&p->request);
+#endif
+
+  free(p->tbuf);
+  free(p);
+
+  *plan = ZMPI_REDUCE_PLAN_NULL;
+
+  return MPI_SUCCESS;
+}
+
+
+MPI_Request ZMPI_Reduce_plan_request(ZMPI_Reduce_plan plan)
+{
+  return (plan && plan->algorithm == ZMPI_REDUCE_PLAN_MPI)?plan->request:MPI_REQUEST_NULL;
+}
@@ -0,0 +1,56 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __MPI_REDUCE_PLAN_H__
+#define __MPI_REDUCE_PLAN_H__
+
+
+/* Persistent reductions (in the spirit of MPI_Reduce_init). A plan captures the arguments, the communication
+   schedule and all buffers once, every start of the plan is then free of allocations. Plans are started with
+   ZMPI_Reduce_start and completed with ZMPI_Reduce_test or ZMPI_Reduce_wait, the buffers must not be accessed
+   in between. Pipeline plans use persistent pipeline requests (see mpi_ireduce_pipe.h).
+
+   ZMPI_REDUCE_PLAN_MPI uses the persistent MPI_Reduce_init of MPI >= 4 (otherwise MPI_Ireduce on every start),
+   its MPI request is available with ZMPI_Reduce_plan_request, e.g., for MPI_Startall and MPI_Waitall. */
+
+#define ZMPI_REDUCE_PLAN_PIPE_SENDRECV      ZMPI_PIPE_SENDRECV
+#define ZMPI_REDUCE_PLAN_PIPE_SENDRECV_RLE  ZMPI_PIPE_SENDRECV_RLE
+#define ZMPI_REDUCE_PLAN_PIPE_ISEND_IRECV   ZMPI_PIPE_ISEND_IRECV
+#define ZMPI_REDUCE_PLAN_PIPE_STREAM        ZMPI_PIPE_STREAM
+#define ZMPI_REDUCE_PLAN_PIPE_STREAM_RLE    ZMPI_PIPE_STREAM_RLE
+#define ZMPI_REDUCE_PLAN_GATHER             5
+#define ZMPI_REDUCE_PLAN_GATHER_RLE         6
+#define ZMPI_REDUCE_PLAN_MPI                7
+
+typedef struct _ZMPI_Reduce_plan *ZMPI_Reduce_plan;
+
+#define ZMPI_REDUCE_PLAN_NULL  NULL
+
+int ZMPI_Reduce_init(int algorithm, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm, ZMPI_Reduce_plan *plan);
+int ZMPI_Reduce_start(ZMPI_Reduce_plan plan);
+int ZMPI_Reduce_test(ZMPI_Reduce_plan plan, int *flag);
+int ZMPI_Reduce_wait(ZMPI_Reduce_plan plan);
+int ZMPI_Reduce_plan_free(ZMPI_Reduce_plan *plan);
+
+MPI_Request ZMPI_Reduce_plan_request(ZMPI_Reduce_plan plan);
+
+
+#endif /* __MPI_REDUCE_PLAN_H__ */
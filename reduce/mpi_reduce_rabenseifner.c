@@ -13,6 +13,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "reduce_op.h"
+#include "reduce_transport.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_allreduce.h"
+#include "mpi_reduce_rabenseifner.h"
+
+
+rabenseifner_stats rabenseifner_last_stats;
+
 #ifdef CRAY
 #      define SCR_LNG_OPTIM(bytelng)  128 + ((bytelng+127)/256) * 256;
                                  /* =  16 + multiple of 32 doubles*/
@@ -390,22 +403,22 @@ Benchmark results on CRAY T3E
 
 #ifdef USE_Irecv
 #define  MPI_I_Sendrecv(sb,sc,sd,dest,st,rb,rc,rd,source,rt,comm,stat) \
-           { MPI_Request req;                                          \
-             MPI_Irecv(rb,rc,rd,source,rt,comm,&req);                  \
-             MPI_Send(sb,sc,sd,dest,st,comm);                          \
-             MPI_Wait(&req,stat);                                      \
+           { transport_request req;                                    \
+             transport_irecv(rb,rc,rd,source,rt,comm,&req);            \
+             transport_send(sb,sc,sd,dest,st,comm);                    \
+             transport_wait(&req,stat);                                \
            }
 #else
 #ifdef USE_Isend
 #define  MPI_I_Sendrecv(sb,sc,sd,dest,st,rb,rc,rd,source,rt,comm,stat) \
-           { MPI_Request req;                                          \
-             MPI_Isend(sb,sc,sd,dest,st,comm,&req);                    \
-             MPI_Recv(rb,rc,rd,source,rt,comm,stat);                   \
-             MPI_Wait(&req,stat);                                      \
+           { transport_request req;                                    \
+             transport_isend(sb,sc,sd,dest,st,comm,&req);              \
+             transport_recv(rb,rc,rd,source,rt,comm,stat);             \
+             transport_wait(&req,stat);                                \
            }
 #else
 #define  MPI_I_Sendrecv(sb,sc,sd,dest,st,rb,rc,rd,source,rt,comm,stat) \
-           MPI_Sendrecv(sb,sc,sd,dest,st,rb,rc,rd,source,rt,comm,stat)
+           transport_sendrecv(sb,sc,sd,dest,st,rb,rc,rd,source,rt,comm,stat)
 #endif
 #endif
 
@@ -496,9 +509,40 @@ void MPI_I_do_op(void* b1, void* b2, void* rslt, int cnt,
 
 REDUCE_LIMITS
 
-int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype mpi_datatype, MPI_Op mpi_op, int root, MPI_Comm comm, int is_all)
+/* bytes sent and received in the given step, dense are the bytes of the uncompressed messages */
+#define MPI_I_STATS(step, s, r, d)                                     \
+   { rabenseifner_last_stats.sent[step]     += (long) (s) * typelng;       \
+     rabenseifner_last_stats.received[step] += (long) (r) * typelng;       \
+     rabenseifner_last_stats.dense[step]    += (long) (d) * typelng; }
+
+#ifdef USE_DBLV
+/* exchange with zero-run encoding: compresses the sc elements of sb into zb, receives at most rc
+   compressed elements into rb and returns the number of elements received */
+static int MPI_I_Sendrecv_rle(const dblv_rle_ops *rle_ops, void *sb, int sc, int dest, int st,
+                              void *rb, int rc, int source, int rt,
+                              MPI_Datatype mpi_datatype, MPI_Comm comm, void *zb, int step)
+{
+  MPI_Status status;
+  int zc, typelng;
+
+  rle_ops->compress(sc, sb, &zc, zb);
+  MPI_I_Sendrecv(zb, zc, mpi_datatype, dest, st,
+                 rb, rc, mpi_datatype, source, rt, comm, &status);
+  MPI_Get_count(&status, mpi_datatype, &rc);
+
+  MPI_Type_size(mpi_datatype, &typelng);
+  MPI_I_STATS(step, zc, rc, sc);
+
+  return rc;
+}
+#endif
+
+/* with rle_ops != NULL, all messages are compressed and the received halves are reduced
+   with the fused compressed+uncompressed kernels instead of MPI_I_do_op, received parts
+   of the result (steps 6.n and 7) are uncompressed */
+int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype mpi_datatype, MPI_Op mpi_op, int root, MPI_Comm comm, int is_all, const struct _dblv_rle_ops *rle_ops)
 {
-  char *scr1buf, *scr2buf, *scr3buf, *xxx, *sendbuf, *recvbuf;
+  char *scr1buf, *scr2buf, *scr3buf, *scr4buf, *xxx, *sendbuf, *recvbuf;
   int myrank, size, x_base, x_size, computed, idx;
   int x_start, x_count, r, n, mynewrank, newroot, partner;
   int start_even[20], start_odd[20], count_even[20], count_odd[20];
@@ -507,6 +551,7 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
   size_t scrlng;
   int new_prot;
   MPIM_Datatype datatype; MPIM_Op op;
+  double rle_next; int rle_count;
 
   if     (mpi_datatype==MPI_SHORT         ) datatype=MPIM_SHORT;
   else if(mpi_datatype==MPI_INT           ) datatype=MPIM_INT;
@@ -530,7 +575,8 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
   else if(mpi_op==MPI_BXOR    ) op=MPIM_BXOR;
 
   new_prot = 0;
-  MPI_Comm_size(comm, &size);
+  rabenseifner_last_stats.nsteps = 0;
+  transport_comm_size(comm, &size);
   if (size > 1) /*otherwise no balancing_protocol*/
   { register int ss;
     if      (size==2) ss=0;
@@ -583,7 +629,7 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
   {
     sendbuf = (char*) Sendbuf;
     recvbuf = (char*) Recvbuf;
-    MPI_Comm_rank(comm, &myrank);
+    transport_comm_rank(comm, &myrank);
     // MPI_Type_extent(mpi_datatype, &typelng);
     MPI_Type_get_extent(mpi_datatype, &typelb, &typelng);
     scrlng  = typelng * count;
@@ -600,6 +646,7 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
     scr3buf = scr2buf + 2*scrlng; /* be used for malloc because  */
                                   /* they are interchanged below.*/
 #endif
+    scr4buf = rle_ops ? malloc(scrlng) : NULL; /* compressed messages */
     computed = 0;
     if (is_all) root = myrank; /* for correct recvbuf handling */
 
@@ -613,6 +660,22 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
     /* x_sixe == 2**n */
     r = size - x_size;
 
+    /* statistics slots: 2, 5.1 ... 5.n, 6.0, 6.1 ... 6.n, 7 */
+#   define STEP_2       0
+#   define STEP_5(idx)  (1+(idx))
+#   define STEP_60      (n+1)
+#   define STEP_6(idx)  (n+1+(n-(idx)))
+#   define STEP_7       (2*n+2)
+    rabenseifner_last_stats.nsteps = 2*n+3;
+    for (idx=0; idx<2*n+3; idx++)
+    {
+      rabenseifner_last_stats.sent[idx] = rabenseifner_last_stats.received[idx] = rabenseifner_last_stats.dense[idx] = 0;
+      if (idx == STEP_2) sprintf(rabenseifner_last_stats.names[idx], "2");
+      else if (idx <= n) sprintf(rabenseifner_last_stats.names[idx], "5.%d", idx);
+      else if (idx < STEP_7) sprintf(rabenseifner_last_stats.names[idx], "6.%d", idx-n-1);
+      else sprintf(rabenseifner_last_stats.names[idx], "7");
+    }
+
   /*...step 2 */
 
 #   ifdef DEBUG
@@ -622,14 +685,36 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
     {
       if ((myrank % 2) == 0 /*even*/)
       {
+#ifdef USE_DBLV
+       if (rle_ops)
+       {
+        rle_count = MPI_I_Sendrecv_rle(rle_ops, sendbuf + (count/2)*typelng,
+                       count - count/2, myrank+1, 1220,
+                       scr2buf, count/2, myrank+1, 1221,
+                       mpi_datatype, comm, scr4buf, STEP_2);
+        rle_next = 0;
+        rle_ops->cf_uc_add3_uc(rle_count, scr2buf, count/2, sendbuf,
+                    count/2, scr1buf, NULL, NULL, NULL, &rle_next);
+        transport_recv(scr2buf + (count/2)*typelng, count - count/2,
+                       mpi_datatype, myrank+1, 1223, comm, &status);
+        MPI_Get_count(&status, mpi_datatype, &rle_count);
+        MPI_I_STATS(STEP_2, 0, rle_count, 0);
+        rle_ops->uncompress(rle_count, scr2buf + (count/2)*typelng,
+                    NULL, scr1buf + (count/2)*typelng);
+       }
+       else
+#endif
+       {
         MPI_I_Sendrecv(sendbuf + (count/2)*typelng,
                        count - count/2, mpi_datatype, myrank+1, 1220,
                        scr2buf, count/2,mpi_datatype, myrank+1, 1221,
                        comm, &status);
         MPI_I_do_op(sendbuf, scr2buf, scr1buf,
                     count/2, datatype, op);
-        MPI_Recv(scr1buf + (count/2)*typelng, count - count/2,
-                 mpi_datatype, myrank+1, 1223, comm, &status);
+        transport_recv(scr1buf + (count/2)*typelng, count - count/2,
+                       mpi_datatype, myrank+1, 1223, comm, &status);
+        MPI_I_STATS(STEP_2, count - count/2, count, count - count/2);
+       }
         computed = 1;
 #       ifdef DEBUG
         { int i; printf("[%2d] after step 2: val=",
@@ -641,6 +726,25 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 #       endif
       }
       else /*odd*/
+#ifdef USE_DBLV
+      if (rle_ops)
+      {
+        rle_count = MPI_I_Sendrecv_rle(rle_ops, sendbuf, count/2, myrank-1, 1221,
+                       scr2buf + (count/2)*typelng,
+                       count - count/2, myrank-1, 1220,
+                       mpi_datatype, comm, scr4buf, STEP_2);
+        /* the result is sent compressed */
+        rle_next = 0;
+        rle_ops->cf_uc_add3_cf(rle_count, scr2buf + (count/2)*typelng,
+                    count - count/2, sendbuf + (count/2)*typelng,
+                    count - count/2, scr1buf + (count/2)*typelng,
+                    NULL, NULL, &rle_count, &rle_next);
+        transport_send(scr1buf + (count/2)*typelng, rle_count,
+                       mpi_datatype, myrank-1, 1223, comm);
+        MPI_I_STATS(STEP_2, rle_count, 0, count - count/2);
+      }
+      else
+#endif
       {
         MPI_I_Sendrecv(sendbuf, count/2,mpi_datatype, myrank-1, 1221,
                        scr2buf + (count/2)*typelng,
@@ -650,8 +754,9 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
                     sendbuf + (count/2)*typelng,
                     scr1buf + (count/2)*typelng,
                     count - count/2, datatype, op);
-        MPI_Send(scr1buf + (count/2)*typelng, count - count/2,
-                 mpi_datatype, myrank-1, 1223, comm);
+        transport_send(scr1buf + (count/2)*typelng, count - count/2,
+                       mpi_datatype, myrank-1, 1223, comm);
+        MPI_I_STATS(STEP_2, count, count - count/2, count);
       }
     }
 
@@ -687,18 +792,41 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 #         endif
           x_start = start_even[idx];
           x_count = count_even[idx];
+#ifdef USE_DBLV
+         if (rle_ops)
+         {
+          rle_count = MPI_I_Sendrecv_rle(rle_ops, (computed ? scr1buf : sendbuf)
+                         + start_odd[idx]*typelng, count_odd[idx],
+                         OLDRANK(mynewrank+x_base), 1231,
+                         scr2buf + x_start*typelng, x_count,
+                         OLDRANK(mynewrank+x_base), 1232,
+                         mpi_datatype, comm, scr4buf, STEP_5(idx));
+          rle_next = 0;
+          rle_ops->cf_uc_add3_uc(rle_count, scr2buf + x_start*typelng,
+                      x_count, (computed?scr1buf:sendbuf) + x_start*typelng,
+                      x_count,
+                      ((root==myrank) && (idx==(n-1))
+                        ? recvbuf + x_start*typelng
+                        : scr3buf + x_start*typelng),
+                      NULL, NULL, NULL, &rle_next);
+         }
+         else
+#endif
+         {
           MPI_I_Sendrecv((computed ? scr1buf : sendbuf)
                          + start_odd[idx]*typelng, count_odd[idx],
                          mpi_datatype, OLDRANK(mynewrank+x_base), 1231,
                          scr2buf + x_start*typelng, x_count,
                          mpi_datatype, OLDRANK(mynewrank+x_base), 1232,
                          comm, &status);
+          MPI_I_STATS(STEP_5(idx), count_odd[idx], x_count, count_odd[idx]);
           MPI_I_do_op((computed?scr1buf:sendbuf) + x_start*typelng,
                       scr2buf                    + x_start*typelng,
                       ((root==myrank) && (idx==(n-1))
                         ? recvbuf + x_start*typelng
                         : scr3buf + x_start*typelng),
                       x_count, datatype, op);
+         }
         }
         else /*odd*/
         {
@@ -708,18 +836,41 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 #         endif
           x_start = start_odd[idx];
           x_count = count_odd[idx];
+#ifdef USE_DBLV
+         if (rle_ops)
+         {
+          rle_count = MPI_I_Sendrecv_rle(rle_ops, (computed ? scr1buf : sendbuf)
+                         +start_even[idx]*typelng, count_even[idx],
+                         OLDRANK(mynewrank-x_base), 1232,
+                         scr2buf + x_start*typelng, x_count,
+                         OLDRANK(mynewrank-x_base), 1231,
+                         mpi_datatype, comm, scr4buf, STEP_5(idx));
+          rle_next = 0;
+          rle_ops->cf_uc_add3_uc(rle_count, scr2buf + x_start*typelng,
+                      x_count, (computed?scr1buf:sendbuf) + x_start*typelng,
+                      x_count,
+                      ((root==myrank) && (idx==(n-1))
+                        ? recvbuf + x_start*typelng
+                        : scr3buf + x_start*typelng),
+                      NULL, NULL, NULL, &rle_next);
+         }
+         else
+#endif
+         {
           MPI_I_Sendrecv((computed ? scr1buf : sendbuf)
                          +start_even[idx]*typelng, count_even[idx],
                          mpi_datatype, OLDRANK(mynewrank-x_base), 1232,
                          scr2buf + x_start*typelng, x_count,
                          mpi_datatype, OLDRANK(mynewrank-x_base), 1231,
                          comm, &status);
+          MPI_I_STATS(STEP_5(idx), count_even[idx], x_count, count_even[idx]);
           MPI_I_do_op(scr2buf                    + x_start*typelng,
                       (computed?scr1buf:sendbuf) + x_start*typelng,
                       ((root==myrank) && (idx==(n-1))
                         ? recvbuf + x_start*typelng
                         : scr3buf + x_start*typelng),
                       x_count, datatype, op);
+         }
         }
         xxx = scr3buf; scr3buf = scr1buf; scr1buf = xxx;
         computed = 1;
@@ -754,6 +905,30 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 #         ifdef DEBUG
             printf("[%2d](%2d) step 6.%d begin\n",myrank,mynewrank,n-idx); fflush(stdout);
 #         endif
+#ifdef USE_DBLV
+          if (rle_ops)
+          {
+            if (((mynewrank/x_base) % 2) == 0 /*even*/)
+            { x_start = start_odd[idx]; x_count = count_odd[idx];
+              partner = mynewrank+x_base;
+              rle_count = MPI_I_Sendrecv_rle(rle_ops,
+                           recvbuf + start_even[idx]*typelng, count_even[idx],
+                           OLDRANK(partner), 1241,
+                           scr2buf + x_start*typelng, x_count,
+                           OLDRANK(partner), 1242, mpi_datatype, comm, scr4buf, STEP_6(idx)); }
+            else /*odd*/
+            { x_start = start_even[idx]; x_count = count_even[idx];
+              partner = mynewrank-x_base;
+              rle_count = MPI_I_Sendrecv_rle(rle_ops,
+                           recvbuf + start_odd[idx]*typelng, count_odd[idx],
+                           OLDRANK(partner), 1242,
+                           scr2buf + x_start*typelng, x_count,
+                           OLDRANK(partner), 1241, mpi_datatype, comm, scr4buf, STEP_6(idx)); }
+            rle_ops->uncompress(rle_count, scr2buf + x_start*typelng,
+                                NULL, recvbuf + x_start*typelng);
+          }
+          else
+#endif
           if (((mynewrank/x_base) % 2) == 0 /*even*/)
           {
             MPI_I_Sendrecv(recvbuf + start_even[idx]*typelng,
@@ -763,6 +938,7 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
                                      count_odd[idx],
                            mpi_datatype, OLDRANK(mynewrank+x_base),1242,
                            comm, &status);
+            MPI_I_STATS(STEP_6(idx), count_even[idx], count_odd[idx], count_even[idx]);
 #           ifdef DEBUG
               x_start = start_odd[idx];
               x_count = count_odd[idx];
@@ -777,6 +953,7 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
                                      count_even[idx],
                            mpi_datatype, OLDRANK(mynewrank-x_base),1241,
                            comm, &status);
+            MPI_I_STATS(STEP_6(idx), count_odd[idx], count_even[idx], count_odd[idx]);
 #           ifdef DEBUG
               x_start = start_even[idx];
               x_count = count_even[idx];
@@ -805,10 +982,27 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 #       ifdef DEBUG
           printf("[%2d] step 7 begin\n",myrank); fflush(stdout);
 #       endif
+#ifdef USE_DBLV
+        if (rle_ops)
+        {
+          if (myrank%2 == 0 /*even*/)
+          { rle_ops->compress(count, recvbuf, &rle_count, scr4buf);
+            transport_send(scr4buf, rle_count, mpi_datatype, myrank+1, 1253, comm);
+            MPI_I_STATS(STEP_7, rle_count, 0, count); }
+          else /*odd*/
+          { transport_recv(scr2buf, count, mpi_datatype, myrank-1, 1253, comm, &status);
+            MPI_Get_count(&status, mpi_datatype, &rle_count);
+            MPI_I_STATS(STEP_7, 0, rle_count, 0);
+            rle_ops->uncompress(rle_count, scr2buf, NULL, recvbuf); }
+        }
+        else
+#endif
         if (myrank%2 == 0 /*even*/)
-          MPI_Send(recvbuf, count, mpi_datatype, myrank+1, 1253, comm);
+        { transport_send(recvbuf, count, mpi_datatype, myrank+1, 1253, comm);
+          MPI_I_STATS(STEP_7, count, 0, count); }
         else /*odd*/
-          MPI_Recv(recvbuf, count, mpi_datatype, myrank-1, 1253, comm, &status);
+        { transport_recv(recvbuf, count, mpi_datatype, myrank-1, 1253, comm, &status);
+          MPI_I_STATS(STEP_7, 0, count, 0); }
       }
 
     }
@@ -825,7 +1019,15 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
         if (myrank == 0) /* then mynewrank==0, x_start==0
                                  x_count == count/x_size  */
         {
-          MPI_Send(scr1buf,x_count,mpi_datatype,root,1241,comm);
+#ifdef USE_DBLV
+          if (rle_ops)
+          { rle_ops->compress(x_count, scr1buf, &rle_count, scr4buf);
+            transport_send(scr4buf,rle_count,mpi_datatype,root,1241,comm);
+            MPI_I_STATS(STEP_60, rle_count, 0, x_count); }
+          else
+#endif
+          { transport_send(scr1buf,x_count,mpi_datatype,root,1241,comm);
+            MPI_I_STATS(STEP_60, x_count, 0, x_count); }
           mynewrank = -1;
         }
 
@@ -844,7 +1046,16 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
             x_start = start_even[idx];
             x_count = count_even[idx];
           }
-          MPI_Recv(recvbuf,x_count,mpi_datatype,0,1241,comm,&status);
+#ifdef USE_DBLV
+          if (rle_ops)
+          { transport_recv(scr2buf,x_count,mpi_datatype,0,1241,comm,&status);
+            MPI_Get_count(&status, mpi_datatype, &rle_count);
+            rle_ops->uncompress(rle_count, scr2buf, NULL, recvbuf);
+            MPI_I_STATS(STEP_60, 0, rle_count, 0); }
+          else
+#endif
+          { transport_recv(recvbuf,x_count,mpi_datatype,0,1241,comm,&status);
+            MPI_I_STATS(STEP_60, 0, x_count, 0); }
         }
         newroot = 0;
       }
@@ -874,8 +1085,20 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
             else
             { x_start = start_odd[idx]; x_count = count_odd[idx];
               partner = mynewrank-x_base; }
-            MPI_Send(scr1buf + x_start*typelng, x_count, mpi_datatype,
-                     OLDRANK(partner), 1244, comm);
+#ifdef USE_DBLV
+            if (rle_ops)
+            { rle_ops->compress(x_count, scr1buf + x_start*typelng, &rle_count, scr4buf);
+              transport_send(scr4buf, rle_count, mpi_datatype,
+                             OLDRANK(partner), 1244, comm);
+              MPI_I_STATS(STEP_6(idx), rle_count, 0, x_count); }
+            else
+#endif
+            { transport_send(scr1buf + x_start*typelng, x_count, mpi_datatype,
+                             OLDRANK(partner), 1244, comm);
+              MPI_I_STATS(STEP_6(idx), x_count, 0, x_count); }
+            /* the result of this node is sent, i.e. it is done (otherwise it would
+               exchange parts not computed with nodes that are done too) */
+            break;
           }
           else /*odd*/
           {
@@ -885,9 +1108,20 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
             else
             { x_start = start_even[idx]; x_count = count_even[idx];
               partner = mynewrank-x_base; }
-            MPI_Recv((myrank==root ? recvbuf : scr1buf)
-                     + x_start*typelng, x_count, mpi_datatype,
-                     OLDRANK(partner), 1244, comm, &status);
+#ifdef USE_DBLV
+            if (rle_ops)
+            { transport_recv(scr2buf + x_start*typelng, x_count, mpi_datatype,
+                             OLDRANK(partner), 1244, comm, &status);
+              MPI_Get_count(&status, mpi_datatype, &rle_count);
+              rle_ops->uncompress(rle_count, scr2buf + x_start*typelng, NULL,
+                       (myrank==root ? recvbuf : scr1buf) + x_start*typelng);
+              MPI_I_STATS(STEP_6(idx), 0, rle_count, 0); }
+            else
+#endif
+            { transport_recv((myrank==root ? recvbuf : scr1buf)
+                             + x_start*typelng, x_count, mpi_datatype,
+                             OLDRANK(partner), 1244, comm, &status);
+              MPI_I_STATS(STEP_6(idx), 0, x_count, 0); }
 #           ifdef DEBUG
             { int i; printf("[%2d](%2d) after step 6.%d   end: start=%2d  count=%2d  val=",
                             myrank,mynewrank,n-idx,x_start,x_count);
@@ -911,13 +1145,19 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 #   else
      free(scr2buf); /* scr1buf and scr3buf are part of scr2buf */
 #   endif
+    if (scr4buf) free(scr4buf);
+#   undef STEP_2
+#   undef STEP_5
+#   undef STEP_60
+#   undef STEP_6
+#   undef STEP_7
     return(MPI_SUCCESS);
   } /* new_prot */
   /*otherwise:*/
   if (is_all)
-   return( MPI_Allreduce(Sendbuf, Recvbuf, count, mpi_datatype, mpi_op, comm) );
+   return( transport_allreduce(Sendbuf, Recvbuf, count, mpi_datatype, mpi_op, comm) );
   else
-   return( MPI_Reduce(Sendbuf,Recvbuf, count,mpi_datatype,mpi_op, root, comm) );
+   return( transport_reduce(Sendbuf,Recvbuf, count,mpi_datatype,mpi_op, root, comm) );
 }
 #endif /*REDUCE_LIMITS*/
 
@@ -925,9 +1165,9 @@ int MPI_I_anyReduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype
 int MPI_MYreduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
 {
 #ifdef REDUCE_LIMITS
-  return( MPI_I_anyReduce(Sendbuf, Recvbuf, count, datatype, op, root, comm, 0) );
+  return( MPI_I_anyReduce(Sendbuf, Recvbuf, count, datatype, op, root, comm, 0, NULL) );
 #else
-  return( MPI_Reduce(Sendbuf, Recvbuf, count, datatype, op, root, comm) );
+  return( transport_reduce(Sendbuf, Recvbuf, count, datatype, op, root, comm) );
 
 #endif
 }
@@ -935,8 +1175,40 @@ int MPI_MYreduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype dat
 int MPI_MYallreduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
 {
 #ifdef REDUCE_LIMITS
-  return( MPI_I_anyReduce(Sendbuf, Recvbuf, count, datatype, op,   -1, comm, 1) );
+  return( MPI_I_anyReduce(Sendbuf, Recvbuf, count, datatype, op,   -1, comm, 1, NULL) );
 #else
-  return( MPI_Allreduce(Sendbuf, Recvbuf, count, datatype, op, comm) );
+  return( transport_allreduce(Sendbuf, Recvbuf, count, datatype, op, comm) );
 #endif
 }
+
+
+int MPI_Reduce_rabenseifner_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+#ifdef REDUCE_LIMITS
+  const struct _dblv_rle_ops *rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed exchanges */
+  if (rle_ops) return MPI_I_anyReduce(sendbuf, recvbuf, count, datatype, op, root, comm, 0, rle_ops);
+#endif
+
+  return MPI_MYreduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+}
+
+
+int ZMPI_Allreduce_rabenseifner(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+  return MPI_MYallreduce(sendbuf, recvbuf, count, datatype, op, comm);
+}
+
+
+int ZMPI_Allreduce_rabenseifner_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+#ifdef REDUCE_LIMITS
+  const struct _dblv_rle_ops *rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed exchanges */
+  if (rle_ops) return MPI_I_anyReduce(sendbuf, recvbuf, count, datatype, op, -1, comm, 1, rle_ops);
+#endif
+
+  return MPI_MYallreduce(sendbuf, recvbuf, count, datatype, op, comm);
+}
@@ -26,5 +26,24 @@
 
 int MPI_MYreduce(const void* Sendbuf, void* Recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
 
+/* all messages are RLE-compressed (MPI_FLOAT and MPI_DOUBLE with MPI_SUM, MPI_MAX or MPI_MIN) */
+int MPI_Reduce_rabenseifner_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+
+#define RABENSEIFNER_MAX_STEPS  (2 * 20 + 3)
+
+/* communication of the last call on this process, steps are named as in mpi_reduce_rabenseifner.c
+   (2: pairing of non-power-of-two ranks, 5.x: reduce-scatter, 6.x: gather or allgather, 7: allreduce result to the paired ranks),
+   dense are the bytes the sent messages would have without compression */
+typedef struct _rabenseifner_stats
+{
+  int nsteps;
+  char names[RABENSEIFNER_MAX_STEPS][8];
+  long sent[RABENSEIFNER_MAX_STEPS], received[RABENSEIFNER_MAX_STEPS], dense[RABENSEIFNER_MAX_STEPS];
+
+} rabenseifner_stats;
+
+extern rabenseifner_stats rabenseifner_last_stats;
+
 
 #endif /* __MPI_REDUCE_RABENSEIFNER_H__ */
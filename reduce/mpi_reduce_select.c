@@ -0,0 +1,404 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+
+#include "reduce_op.h"
+#include "logging.h"
+
+#include "mpi_reduce_common.h"
+#include "mpi_reduce_rabenseifner.h"
+#include "mpi_reduce_pipe.h"
+#include "mpi_reduce_gather.h"
+#include "mpi_reduce_tree.h"
+#include "mpi_reduce_select.h"
+
+
+const ZMPI_Reduce_algorithm ZMPI_Reduce_algorithms[] =
+{
+#define SELECT_MPI                    0
+  { "MPI_Reduce", MPI_Reduce, 0 },
+#define SELECT_RABENSEIFNER           1
+  { "MPI_Reduce_rabenseifner", MPI_Reduce_rabenseifner, 0 },
+#define SELECT_RABENSEIFNER_RLE       2
+  { "MPI_Reduce_rabenseifner_rle", MPI_Reduce_rabenseifner_rle, 0 },
+#define SELECT_PIPE_SENDRECV          3
+  { "MPI_Reduce_pipe_sendrecv", MPI_Reduce_pipe_sendrecv, 1 },
+#define SELECT_PIPE_SENDRECV_RLE      4
+  { "MPI_Reduce_pipe_sendrecv_rle", MPI_Reduce_pipe_sendrecv_rle, 1 },
+#define SELECT_PIPE_ISEND_IRECV       5
+  { "MPI_Reduce_pipe_isend_irecv", MPI_Reduce_pipe_isend_irecv, 1 },
+#define SELECT_PIPE_STREAM            6
+  { "MPI_Reduce_pipe_stream", MPI_Reduce_pipe_stream, 1 },
+#define SELECT_PIPE_STREAM_RLE        7
+  { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle, 1 },
+#define SELECT_PIPE_STREAM_ADAPTIVE   8
+  { "MPI_Reduce_pipe_stream_adaptive", MPI_Reduce_pipe_stream_adaptive, 1 },
+#define SELECT_GATHER                 9
+  { "MPI_Reduce_gather", MPI_Reduce_gather, 0 },
+#define SELECT_GATHER_RLE            10
+  { "MPI_Reduce_gather_rle", MPI_Reduce_gather_rle, 0 },
+#define SELECT_TREE                  11
+  { "MPI_Reduce_tree", MPI_Reduce_tree, 0 },
+#define SELECT_TREE_RLE              12
+  { "MPI_Reduce_tree_rle", MPI_Reduce_tree_rle, 0 },
+};
+
+#define SELECT_NALGORITHMS  (int) (sizeof(ZMPI_Reduce_algorithms) / sizeof(ZMPI_Reduce_algorithms[0]))
+
+const int ZMPI_Reduce_nalgorithms = SELECT_NALGORITHMS;
+
+select_attr default_sa = { SELECT_ALPHA, SELECT_BETA, SELECT_GAMMA, SELECT_SAMPLES, 0 };
+
+
+/* range of packet sizes chosen by the cost model */
+#define SELECT_MIN_PACKET  (4 * 1024)
+#define SELECT_MAX_PACKET  (16 * 1024 * 1024)
+
+/* table points are used up to these distances (factor 2 of comm_size and bytes, factor 10 of density) */
+#define SELECT_MAX_DIST_SIZE     1.0
+#define SELECT_MAX_DIST_BYTES    1.0
+#define SELECT_MAX_DIST_DENSITY  1.0
+#define SELECT_MIN_DENSITY       1.0e-4
+
+/* inputs with fewer elements than this times the number of samples are assumed to be dense (no estimate) */
+#define SELECT_SAMPLES_MIN_FACTOR  16
+
+#define SELECT_NAME_MAX  64
+
+
+typedef struct _select_entry
+{
+  int comm_size;
+  long bytes;
+  double density;
+
+  int algorithm, packet_size;
+  double time;
+
+} select_entry;
+
+static select_entry *select_table = NULL;
+static int select_table_size = 0, select_table_alloc = 0, select_table_loaded = 0;
+
+
+int ZMPI_Reduce_algorithm_index(const char *name)
+{
+  int i;
+
+  for (i = 0; i < ZMPI_Reduce_nalgorithms; i++)
+  if (strcmp(ZMPI_Reduce_algorithms[i].name, name) == 0) return i;
+
+  return -1;
+}
+
+
+void ZMPI_Reduce_table_clear()
+{
+  free(select_table);
+
+  select_table = NULL;
+  select_table_size = select_table_alloc = 0;
+
+  /* an explicitly cleared table is not replaced by the file of the environment */
+  select_table_loaded = 1;
+}
+
+
+void ZMPI_Reduce_table_add(int comm_size, long bytes, double density, int algorithm, int packet_size, double time)
+{
+  int i;
+
+  select_table_loaded = 1;
+
+  if (algorithm < 0 || algorithm >= ZMPI_Reduce_nalgorithms) return;
+
+  /* the faster measurement of a point is kept */
+  for (i = 0; i < select_table_size; i++)
+  if (select_table[i].comm_size == comm_size && select_table[i].bytes == bytes && select_table[i].density == density)
+  {
+    if (time < select_table[i].time)
+    {
+      select_table[i].algorithm = algorithm;
+      select_table[i].packet_size = packet_size;
+      select_table[i].time = time;
+    }
+    return;
+  }
+
+  if (select_table_size >= select_table_alloc)
+  {
+    select_table_alloc = (select_table_alloc > 0)?(2 * select_table_alloc):64;
+    select_table = realloc(select_table, select_table_alloc * sizeof(select_entry));
+  }
+
+  select_table[select_table_size].comm_size = comm_size;
+  select_table[select_table_size].bytes = bytes;
+  select_table[select_table_size].density = density;
+  select_table[select_table_size].algorithm = algorithm;
+  select_table[select_table_size].packet_size = packet_size;
+  select_table[select_table_size].time = time;
+  select_table_size++;
+}
+
+
+int ZMPI_Reduce_table_load(const char *filename)
+{
+  FILE *file;
+  char line[256], name[SELECT_NAME_MAX];
+  int comm_size, packet_size, algorithm;
+  long bytes;
+  double density, time, alpha, beta, gamma;
+
+  select_table_loaded = 1;
+
+  file = fopen(filename, "r");
+  if (!file) return 1;
+
+  while (fgets(line, sizeof(line), file))
+  {
+    if (line[0] == '#') continue;
+
+    if (sscanf(line, "model %lf %lf %lf", &alpha, &beta, &gamma) == 3)
+    {
+      default_sa.alpha = alpha;
+      default_sa.beta = beta;
+      default_sa.gamma = gamma;
+      continue;
+    }
+
+    if (sscanf(line, "%d %ld %lf %63s %d %lf", &comm_size, &bytes, &density, name, &packet_size, &time) != 6) continue;
+
+    /* algorithms unknown to this version are ignored */
+    algorithm = ZMPI_Reduce_algorithm_index(name);
+    if (algorithm >= 0) ZMPI_Reduce_table_add(comm_size, bytes, density, algorithm, packet_size, time);
+  }
+
+  fclose(file);
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Reduce_table_save(const char *filename)
+{
+  FILE *file;
+  int i;
+
+  file = fopen(filename, "w");
+  if (!file) return 1;
+
+  fprintf(file, "# ZMPI_Reduce decision table\n");
+  fprintf(file, "model %e %e %e\n", default_sa.alpha, default_sa.beta, default_sa.gamma);
+  fprintf(file, "# comm_size  bytes  density  algorithm  packet_size  time\n");
+
+  for (i = 0; i < select_table_size; i++)
+    fprintf(file, "%d %ld %f %s %d %e\n", select_table[i].comm_size, select_table[i].bytes, select_table[i].density,
+      ZMPI_Reduce_algorithms[select_table[i].algorithm].name, select_table[i].packet_size, select_table[i].time);
+
+  fclose(file);
+
+  return MPI_SUCCESS;
+}
+
+
+static int select_table_lookup(int comm_size, long bytes, double density, int *packet_size)
+{
+  int i, best = -1;
+  double ds, db, dd, d, best_d = 0.0;
+
+  if (bytes < 1) bytes = 1;
+  if (density < SELECT_MIN_DENSITY) density = SELECT_MIN_DENSITY;
+
+  for (i = 0; i < select_table_size; i++)
+  {
+    ds = fabs(log2((double) select_table[i].comm_size / comm_size));
+    db = fabs(log2((double) ((select_table[i].bytes > 1)?select_table[i].bytes:1) / bytes));
+    dd = fabs(log10(((select_table[i].density > SELECT_MIN_DENSITY)?select_table[i].density:SELECT_MIN_DENSITY) / density));
+
+    if (ds > SELECT_MAX_DIST_SIZE || db > SELECT_MAX_DIST_BYTES || dd > SELECT_MAX_DIST_DENSITY) continue;
+
+    /* a different number of processes weighs most */
+    d = 4.0 * ds + db + dd;
+
+    if (best < 0 || d < best_d)
+    {
+      best = i;
+      best_d = d;
+    }
+  }
+
+  if (best < 0) return -1;
+
+  *packet_size = select_table[best].packet_size;
+
+  return select_table[best].algorithm;
+}
+
+
+/* compression ratio of randomly placed non-zeros (each non-zero plus a zero run behind it, see mpi_reduce_pipe_stream.c) */
+static double select_ratio(double density)
+{
+  double r = density + density * (1.0 - density);
+
+  return (r < 1.0)?r:1.0;
+}
+
+
+/* density of the sum of k vectors with independently placed non-zeros */
+static double select_merged(double density, double k)
+{
+  return 1.0 - pow(1.0 - density, k);
+}
+
+
+/* pipeline packet size that balances the fill time of the pipeline against the per-packet latency */
+static int select_packet_size(int comm_size, double n, double per_byte)
+{
+  double m;
+  int packet_size;
+
+  m = (comm_size > 2)?sqrt(n * default_sa.alpha / ((comm_size - 2) * per_byte)):n;
+
+  for (packet_size = SELECT_MIN_PACKET; packet_size < SELECT_MAX_PACKET && packet_size < m; packet_size *= 2);
+
+  return packet_size;
+}
+
+
+static double select_cost_pipe(int comm_size, double n, double per_byte, int packet_size)
+{
+  return (comm_size - 2 + ceil(n / packet_size)) * (default_sa.alpha + ((packet_size < n)?packet_size:n) * per_byte);
+}
+
+
+static int select_model(int comm_size, long bytes, double density, int *packet_size)
+{
+  const double a = default_sa.alpha, b = default_sa.beta, g = default_sa.gamma;
+  const double n = (double) bytes, p = comm_size;
+  const double steps = ceil(log2(p)), share = (p - 1) / p;
+
+  double r1, rp, cost[SELECT_NALGORITHMS];
+  int i, best, ps, ps_rle;
+
+  /* ratio of the inputs and of the partial results halfway */
+  r1 = select_ratio(density);
+  rp = select_ratio(select_merged(density, p / 2));
+
+  ps = select_packet_size(comm_size, n, b + g);
+  ps_rle = select_packet_size(comm_size, n, rp * b + g);
+
+  for (i = 0; i < SELECT_NALGORITHMS; i++) cost[i] = -1.0;
+
+  cost[SELECT_RABENSEIFNER] = 2.0 * steps * a + 2.0 * n * share * b + n * share * g;
+  cost[SELECT_RABENSEIFNER_RLE] = 2.0 * steps * a + 2.0 * n * share * rp * b + n * share * g;
+  cost[SELECT_PIPE_STREAM] = select_cost_pipe(comm_size, n, b + g, ps);
+  cost[SELECT_PIPE_STREAM_RLE] = select_cost_pipe(comm_size, n, rp * b + g, ps_rle);
+  cost[SELECT_GATHER] = (p - 1) * (a + n * (b + g));
+  cost[SELECT_GATHER_RLE] = n * g + (p - 1) * (a + r1 * n * (b + g));
+  cost[SELECT_TREE] = steps * (a + n * (b + g));
+  cost[SELECT_TREE_RLE] = steps * (a + rp * n * (b + g));
+
+  best = SELECT_PIPE_STREAM;
+  for (i = 0; i < SELECT_NALGORITHMS; i++)
+  if (cost[i] >= 0 && cost[i] < cost[best]) best = i;
+
+  *packet_size = (best == SELECT_PIPE_STREAM_RLE)?ps_rle:ps;
+
+  return best;
+}
+
+
+int ZMPI_Reduce_select(int comm_size, long bytes, double density, int *packet_size)
+{
+  int algorithm;
+  char *filename;
+
+  if (!select_table_loaded)
+  {
+    filename = getenv("ZMPI_REDUCE_TABLE");
+    if (filename) ZMPI_Reduce_table_load(filename);
+    select_table_loaded = 1;
+  }
+
+  algorithm = select_table_lookup(comm_size, bytes, density, packet_size);
+
+  if (algorithm < 0) algorithm = select_model(comm_size, bytes, density, packet_size);
+
+  return algorithm;
+}
+
+
+int ZMPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_size, comm_rank, type_size;
+  int algorithm, packet_size, ret, sampled;
+  double density = 1.0, selected[3];
+
+  ret = MPI_Reduce_check(sendbuf, recvbuf, count, datatype, op, root, comm);
+  if (ret != MPI_SUCCESS) return ret;
+
+  MPI_Comm_size(comm, &comm_size);
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Type_size(datatype, &type_size);
+
+  /* the estimates are averaged at the root */
+  sampled = (comm_size > 1 && default_sa.samples > 0 && count >= SELECT_SAMPLES_MIN_FACTOR * default_sa.samples);
+  if (sampled)
+  {
+    density = reduce_nonzero_fraction(datatype, count, sendbuf, default_sa.samples);
+    MPI_Reduce((comm_rank == root)?MPI_IN_PLACE:&density, &density, 1, MPI_DOUBLE, MPI_SUM, root, comm);
+    density /= comm_size;
+  }
+
+  /* the tables of the processes may differ, so the root selects and broadcasts the algorithm
+     (reduce and broadcast replace the allreduce of the estimates) */
+  if (comm_rank == root)
+  {
+    selected[1] = ZMPI_Reduce_select(comm_size, (long) count * type_size, density, &packet_size);
+    selected[0] = density;
+    selected[2] = packet_size;
+  }
+
+  if (comm_size > 1) MPI_Bcast(selected, 3, MPI_DOUBLE, root, comm);
+
+  density = selected[0];
+  algorithm = (int) selected[1];
+  packet_size = (int) selected[2];
+
+  if (default_sa.logging)
+    mainlog_printf("ZMPI_Reduce: %d  %d  %d  %f  %s  %d\n", count, type_size, comm_size, density, ZMPI_Reduce_algorithms[algorithm].name, packet_size);
+
+  if (ZMPI_Reduce_algorithms[algorithm].packets && packet_size > 0)
+  {
+    int pa_packet_size = default_pa.packet_size;
+
+    default_pa.packet_size = packet_size;
+    ret = ZMPI_Reduce_algorithms[algorithm].reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    default_pa.packet_size = pa_packet_size;
+
+  } else ret = ZMPI_Reduce_algorithms[algorithm].reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+  return ret;
+}
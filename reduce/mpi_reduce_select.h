@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MPI_REDUCE_SELECT_H__
+#define __MPI_REDUCE_SELECT_H__
+
+
+/* ZMPI_Reduce selects the algorithm and the packet size (default_pa.packet_size) of every call. The decision is
+   looked up in a decision table of measured (comm_size, bytes, density) points, if no point is close enough, it
+   is taken from an alpha-beta-gamma cost model. The density of the input is estimated from a few samples of every
+   process (see select_attr.samples) and averaged at the root. The root selects and broadcasts the algorithm and the
+   packet size, so that all processes use the same even if their tables differ.
+
+   The table is read from the file given by the environment variable ZMPI_REDUCE_TABLE at the first call (or with
+   ZMPI_Reduce_table_load), every process reads the file itself, but only the table of the root is used. Tables are
+   generated by sweeping all algorithms with 'zmpi_tests tune_reduce <file>'. Lines of the file:
+     model <alpha> <beta> <gamma>
+     <comm_size> <bytes> <density> <algorithm name> <packet size> <time> */
+
+typedef int (*ZMPI_Reduce_function)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+typedef struct _ZMPI_Reduce_algorithm
+{
+  const char *name;
+  ZMPI_Reduce_function reduce;
+
+  /* the algorithm uses default_pa.packet_size */
+  int packets;
+
+} ZMPI_Reduce_algorithm;
+
+/* candidates of the selection */
+extern const ZMPI_Reduce_algorithm ZMPI_Reduce_algorithms[];
+extern const int ZMPI_Reduce_nalgorithms;
+
+
+#define SELECT_ALPHA    5.0e-6
+#define SELECT_BETA     1.0e-9
+#define SELECT_GAMMA    2.5e-10
+#define SELECT_SAMPLES  64
+
+typedef struct _select_attr
+{
+  /* cost model: latency (seconds), transfer and reduction time (seconds per byte) */
+  double alpha, beta, gamma;
+
+  /* samples per process for the density estimate (0: inputs are assumed to be dense) */
+  int samples;
+
+  /* write the selections to the main log */
+  int logging;
+
+} select_attr;
+
+extern select_attr default_sa;
+
+
+int ZMPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+/* local decision for a vector of bytes with an average density of its non-zeros (returns the algorithm index) */
+int ZMPI_Reduce_select(int comm_size, long bytes, double density, int *packet_size);
+
+int ZMPI_Reduce_table_load(const char *filename);
+int ZMPI_Reduce_table_save(const char *filename);
+void ZMPI_Reduce_table_add(int comm_size, long bytes, double density, int algorithm, int packet_size, double time);
+void ZMPI_Reduce_table_clear();
+
+int ZMPI_Reduce_algorithm_index(const char *name);
+
+
+#endif /* __MPI_REDUCE_SELECT_H__ */
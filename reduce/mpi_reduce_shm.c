@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "mpi_reduce_topo.h"
+#include "mpi_reduce_hier.h"
+
+
+/* Registered shared-memory buffers: ZMPI_Reduce_shm_alloc allocates the buffer of every process in a window of
+   the processes of its node, so that the shared-memory pipelines can read the vectors of the other processes of
+   a node in place. The windows stay locked (lock_all) until they are freed. */
+
+typedef struct _reduce_shm_buf
+{
+  /* rank (in MPI_COMM_WORLD) of the first process of the window and its allocation counter */
+  MPI_Aint id[2];
+
+  char *base;
+  MPI_Aint size;
+
+  MPI_Comm node_comm;
+  MPI_Win win;
+
+  struct _reduce_shm_buf *next;
+
+} reduce_shm_buf;
+
+static reduce_shm_buf *reduce_shm_bufs = NULL;
+static int reduce_shm_nbufs = 0;
+
+
+int ZMPI_Reduce_shm_alloc(MPI_Aint size, MPI_Comm comm, void *baseptr)
+{
+  reduce_shm_buf *rsb;
+  int comm_rank, world_rank;
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+  rsb = malloc(sizeof(reduce_shm_buf));
+
+  rsb->size = size;
+
+  reduce_topo_split_node(comm, comm_rank, &rsb->node_comm);
+
+  /* the id of the first process identifies the window on all processes of the node */
+  rsb->id[0] = world_rank;
+  rsb->id[1] = reduce_shm_nbufs++;
+  MPI_Bcast(rsb->id, 2, MPI_AINT, 0, rsb->node_comm);
+
+  MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, rsb->node_comm, &rsb->base, &rsb->win);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, rsb->win);
+
+  rsb->next = reduce_shm_bufs;
+  reduce_shm_bufs = rsb;
+
+  *((void **) baseptr) = rsb->base;
+
+  return MPI_SUCCESS;
+}
+
+
+int ZMPI_Reduce_shm_free(void *base)
+{
+  reduce_shm_buf *rsb, **prsb;
+
+  for (prsb = &reduce_shm_bufs; *prsb && (*prsb)->base != base; prsb = &(*prsb)->next);
+
+  if (!*prsb) return MPI_ERR_ARG;
+
+  rsb = *prsb;
+  *prsb = rsb->next;
+
+  MPI_Win_unlock_all(rsb->win);
+  MPI_Win_free(&rsb->win);
+  MPI_Comm_free(&rsb->node_comm);
+
+  free(rsb);
+
+  return MPI_SUCCESS;
+}
+
+
+int reduce_shm_lookup(const void *buf, MPI_Aint size, MPI_Comm node_comm, MPI_Aint *id, MPI_Win *win, int *node_rank, MPI_Aint *offset)
+{
+  reduce_shm_buf *rsb;
+  MPI_Group group, win_group;
+  int result;
+
+  id[0] = id[1] = -1;
+
+  for (rsb = reduce_shm_bufs; rsb; rsb = rsb->next)
+  {
+    if ((const char *) buf < rsb->base || (const char *) buf + size > rsb->base + rsb->size) continue;
+
+    /* the window must span exactly the processes of node_comm (in any order) */
+    MPI_Comm_group(node_comm, &group);
+    MPI_Comm_group(rsb->node_comm, &win_group);
+    MPI_Group_compare(group, win_group, &result);
+    MPI_Group_free(&group);
+    MPI_Group_free(&win_group);
+
+    if (result != MPI_IDENT && result != MPI_SIMILAR) return 0;
+
+    id[0] = rsb->id[0];
+    id[1] = rsb->id[1];
+    *win = rsb->win;
+    MPI_Comm_rank(rsb->node_comm, node_rank);
+    *offset = (const char *) buf - rsb->base;
+
+    return 1;
+  }
+
+  return 0;
+}
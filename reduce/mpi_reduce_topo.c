@@ -0,0 +1,243 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "mpi_reduce_topo.h"
+
+
+typedef struct _reduce_topo_proc
+{
+  int host, node, rank;
+
+} reduce_topo_proc;
+
+typedef struct _reduce_topo
+{
+  /* groups of all processes sorted by host, node and rank (root-independent, NULL until needed) */
+  reduce_topo_proc *procs;
+
+  /* reordered communicators of the last roots (oldest first) */
+  int nroots, roots[REDUCE_TOPO_ROOTS];
+  MPI_Comm comms[REDUCE_TOPO_ROOTS];
+
+} reduce_topo;
+
+static int reduce_topo_keyval = MPI_KEYVAL_INVALID;
+
+
+static int reduce_topo_delete(MPI_Comm comm, int keyval, void *attribute_val, void *extra_state)
+{
+  reduce_topo *rt = attribute_val;
+  int i;
+
+  /* a reordered communicator is also cached in its own attribute (as root 0) */
+  for (i = 0; i < rt->nroots; i++) if (rt->comms[i] != comm) MPI_Comm_free(&rt->comms[i]);
+
+  free(rt->procs);
+  free(rt);
+
+  return MPI_SUCCESS;
+}
+
+
+static int reduce_topo_cmp(const void *a, const void *b)
+{
+  const reduce_topo_proc *pa = a, *pb = b;
+
+  if (pa->host != pb->host) return (pa->host < pb->host)?-1:1;
+  if (pa->node != pb->node) return (pa->node < pb->node)?-1:1;
+
+  return (pa->rank < pb->rank)?-1:((pa->rank > pb->rank)?1:0);
+}
+
+
+void reduce_topo_split_node(MPI_Comm comm, int key, MPI_Comm *node_comm)
+{
+  MPI_Comm shm_comm;
+  int comm_rank, nodes;
+  char *s;
+
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, key, MPI_INFO_NULL, &shm_comm);
+
+  s = getenv("ZMPI_REDUCE_TOPO_NODES");
+
+  if (s && (nodes = atoi(s)) > 0)
+  {
+    MPI_Comm_rank(comm, &comm_rank);
+    MPI_Comm_split(shm_comm, comm_rank % nodes, key, node_comm);
+    MPI_Comm_free(&shm_comm);
+
+  } else *node_comm = shm_comm;
+}
+
+
+static void reduce_topo_groups(MPI_Comm comm, int comm_rank, int comm_size, int *host, int *node)
+{
+  MPI_Comm node_comm;
+  char name[MPI_MAX_PROCESSOR_NAME], *names;
+  int i, len;
+
+  /* node (lowest rank of it) */
+  reduce_topo_split_node(comm, comm_rank, &node_comm);
+  MPI_Allreduce(&comm_rank, node, 1, MPI_INT, MPI_MIN, node_comm);
+  MPI_Comm_free(&node_comm);
+
+  /* simulated nodes are not grouped by hosts */
+  if (getenv("ZMPI_REDUCE_TOPO_NODES"))
+  {
+    *host = 0;
+    return;
+  }
+
+  /* host (lowest rank with the same hostname), keeps shared-memory domains of the same host adjacent */
+  memset(name, 0, sizeof(name));
+  MPI_Get_processor_name(name, &len);
+
+  names = malloc((long) comm_size * MPI_MAX_PROCESSOR_NAME);
+  MPI_Allgather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, names, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, comm);
+
+  for (i = 0; i < comm_size; i++) if (strncmp(name, names + (long) i * MPI_MAX_PROCESSOR_NAME, MPI_MAX_PROCESSOR_NAME) == 0) break;
+  *host = i;
+
+  free(names);
+}
+
+
+static reduce_topo *reduce_topo_create(MPI_Comm comm)
+{
+  reduce_topo *rt = malloc(sizeof(reduce_topo));
+
+  rt->procs = NULL;
+  rt->nroots = 0;
+
+  MPI_Comm_set_attr(comm, reduce_topo_keyval, rt);
+
+  return rt;
+}
+
+
+static void reduce_topo_procs(reduce_topo *rt, MPI_Comm comm, int comm_rank, int comm_size)
+{
+  int group[2], *groups, i;
+
+  reduce_topo_groups(comm, comm_rank, comm_size, &group[0], &group[1]);
+
+  groups = malloc(2 * comm_size * sizeof(int));
+  MPI_Allgather(group, 2, MPI_INT, groups, 2, MPI_INT, comm);
+
+  rt->procs = malloc(comm_size * sizeof(reduce_topo_proc));
+
+  for (i = 0; i < comm_size; i++)
+  {
+    rt->procs[i].host = groups[2 * i + 0];
+    rt->procs[i].node = groups[2 * i + 1];
+    rt->procs[i].rank = i;
+  }
+
+  qsort(rt->procs, comm_size, sizeof(reduce_topo_proc), reduce_topo_cmp);
+
+  free(groups);
+}
+
+
+static void reduce_topo_add(reduce_topo *rt, MPI_Comm comm, int root, MPI_Comm topo_comm)
+{
+  int i;
+
+  /* the oldest root is replaced (in the same order on all processes) */
+  if (rt->nroots >= REDUCE_TOPO_ROOTS)
+  {
+    if (rt->comms[0] != comm) MPI_Comm_free(&rt->comms[0]);
+    for (i = 1; i < rt->nroots; i++)
+    {
+      rt->roots[i - 1] = rt->roots[i];
+      rt->comms[i - 1] = rt->comms[i];
+    }
+    rt->nroots--;
+  }
+
+  rt->roots[rt->nroots] = root;
+  rt->comms[rt->nroots] = topo_comm;
+  rt->nroots++;
+}
+
+
+MPI_Comm reduce_topo_comm(MPI_Comm comm, int *root)
+{
+  reduce_topo *rt, *self;
+  reduce_topo_proc *procs;
+  MPI_Comm topo_comm;
+  int comm_rank, comm_size, flag, i, j, r, first, key;
+
+  if (reduce_topo_keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, reduce_topo_delete, &reduce_topo_keyval, NULL);
+
+  MPI_Comm_get_attr(comm, reduce_topo_keyval, &rt, &flag);
+
+  if (!flag) rt = reduce_topo_create(comm);
+
+  for (i = 0; i < rt->nroots; i++)
+  if (rt->roots[i] == *root)
+  {
+    *root = 0;
+    return rt->comms[i];
+  }
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  /* the groups are determined once per communicator */
+  if (!rt->procs) reduce_topo_procs(rt, comm, comm_rank, comm_size);
+
+  procs = rt->procs;
+
+  /* first process of the group of the root */
+  for (r = 0; procs[r].rank != *root; r++);
+  for (first = 0; procs[first].host != procs[r].host || procs[first].node != procs[r].node; first++);
+
+  /* the root, the rest of its group and the following groups (cyclically) */
+  key = 0;
+
+  if (comm_rank != *root)
+  {
+    for (j = 0, key = 1; j < comm_size; j++)
+    {
+      i = (first + j) % comm_size;
+      if (procs[i].rank == *root) continue;
+      if (procs[i].rank == comm_rank) break;
+      key++;
+    }
+  }
+
+  MPI_Comm_split(comm, 0, key, &topo_comm);
+
+  reduce_topo_add(rt, comm, *root, topo_comm);
+
+  /* the reordered communicator is already ordered for its root 0 */
+  self = reduce_topo_create(topo_comm);
+  reduce_topo_add(self, topo_comm, 0, topo_comm);
+
+  *root = 0;
+
+  return topo_comm;
+}
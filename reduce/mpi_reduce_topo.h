@@ -0,0 +1,44 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MPI_REDUCE_TOPO_H__
+#define __MPI_REDUCE_TOPO_H__
+
+
+/* Topology-aware rank order of the pipeline and tree algorithms (default_pa.topo, default_ta.topo). The processes
+   are grouped by hostname and by shared-memory domain (MPI_Comm_split_type with MPI_COMM_TYPE_SHARED) and reordered
+   such that the processes of a group are contiguous and the root is rank 0, followed by the other processes of its
+   group. A pipeline to the root thus crosses the network only between two groups and a binomial tree keeps its
+   smaller subtrees within the groups.
+
+   The groups are determined once per communicator, the reordered communicators of the last REDUCE_TOPO_ROOTS roots
+   are kept (cached as attribute), so alternating roots do not repeat the splits. The environment variable
+   ZMPI_REDUCE_TOPO_NODES=n splits the detected groups into n groups assigned round-robin to the ranks (i.e., a
+   block-cyclic placement of the processes on n nodes) for testing. */
+
+#define REDUCE_TOPO_ROOTS  4
+
+MPI_Comm reduce_topo_comm(MPI_Comm comm, int *root);
+
+/* processes of comm on the same node as the calling process (shared-memory domain, or simulated node), ordered by key */
+void reduce_topo_split_node(MPI_Comm comm, int key, MPI_Comm *node_comm);
+
+
+#endif /* __MPI_REDUCE_TOPO_H__ */
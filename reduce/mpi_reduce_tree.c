@@ -0,0 +1,210 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "debug.h"
+#include "timing.h"
+#include "trace.h"
+#include "reduce_op.h"
+#include "logging.h"
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "mpi_reduce_tree.h"
+#include "mpi_reduce_topo.h"
+
+
+// #define RLE
+
+/* Every node reduces the partial results of its children with its own vector and sends the result to its
+   parent. Trees are built on ranks relative to the root. With RLE, partial results stay compressed on the
+   way up and are merged compressed+compressed at inner nodes, the root uncompresses the final result. */
+
+#define TREE_TAG  0
+
+#define TREE_MAX_CHILDREN  32
+
+#ifndef MOD_TREE
+ #define MOD_TREE(s) s
+
+tree_attr default_ta = { 0, 0, 0 };
+#endif
+
+
+static int tree_parent(int rel_rank, int arity)
+{
+  if (arity < 2) return rel_rank & (rel_rank - 1);
+
+  return (rel_rank - 1) / arity;
+}
+
+
+/* children in the order their subtrees are expected to finish (smallest first) */
+static int tree_children(int rel_rank, int size, int arity, int *children)
+{
+  int n = 0, mask, c;
+
+  if (arity < 2)
+  {
+    for (mask = 1; mask < size && (rel_rank == 0 || mask < (rel_rank & -rel_rank)); mask <<= 1)
+    {
+      if (rel_rank + mask < size) children[n++] = rel_rank + mask;
+    }
+
+  } else
+  {
+    for (c = arity; c > 0; c--)
+    {
+      if ((long) rel_rank * arity + c < size) children[n++] = rel_rank * arity + c;
+    }
+  }
+
+  return n;
+}
+
+
+int MOD_TREE(MPI_Reduce_tree)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size;
+  int type_size;
+
+  int rel_rank, parent, nchildren, arity, i;
+  int *children;
+
+  int max_packet, current_packet, done;
+
+  const char *sbuf = sendbuf;
+  char *rbuf = recvbuf;
+  char *abuf, *bbuf;
+
+#ifndef RLE
+  char *acc;
+#else
+  const dblv_rle_ops *rle_ops;
+  char *cbuf, *tbuf;
+  int na, nb, nc;
+#endif
+
+  MPI_Status status;
+
+
+  if (default_ta.topo) comm = reduce_topo_comm(comm, &root);
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+
+  MPI_Type_size(datatype, &type_size);
+
+#ifdef RLE
+  rle_ops = reduce_rle_ops(datatype, op);
+
+  /* datatypes without zero-run encoding use the uncompressed tree */
+  if (!rle_ops) return MPI_Reduce_tree(sendbuf, recvbuf, count, datatype, op, root, comm);
+#endif
+
+  if (comm_size == 1)
+  {
+    memcpy(recvbuf, sendbuf, type_size * count);
+    goto end;
+  }
+
+  if (count <= 0) goto end;
+
+  arity = default_ta.arity;
+
+  rel_rank = (comm_rank - root + comm_size) % comm_size;
+  parent = (rel_rank == 0)?-1:((tree_parent(rel_rank, arity) + root) % comm_size);
+
+  children = malloc(((arity < 2)?TREE_MAX_CHILDREN:arity) * sizeof(int));
+  nchildren = tree_children(rel_rank, comm_size, arity, children);
+  for (i = 0; i < nchildren; i++) children[i] = (children[i] + root) % comm_size;
+
+  max_packet = (default_ta.packet_size > 0)?(default_ta.packet_size / type_size):count;
+  if (max_packet < 1) max_packet = 1;
+  if (max_packet > count) max_packet = count;
+
+#ifndef RLE
+  abuf = (parent >= 0 && nchildren > 0)?malloc(max_packet * type_size):NULL;
+#else
+  abuf = malloc(max_packet * type_size);
+#endif
+  bbuf = (nchildren > 0)?malloc(max_packet * type_size):NULL;
+#ifdef RLE
+  cbuf = (nchildren > 0)?malloc(max_packet * type_size):NULL;
+#endif
+
+  for (done = 0; done < count; done += current_packet)
+  {
+    current_packet = count - done; if (current_packet > max_packet) current_packet = max_packet;
+
+#ifndef RLE
+    /* leaves send directly from the send buffer, the root reduces in the receive buffer */
+    if (nchildren == 0)
+    {
+      MPI_Send(sbuf + done * type_size, current_packet, datatype, parent, TREE_TAG, comm);
+      continue;
+    }
+
+    acc = (parent < 0)?(rbuf + done * type_size):abuf;
+
+    memcpy(acc, sbuf + done * type_size, current_packet * type_size);
+
+    for (i = 0; i < nchildren; i++)
+    {
+      MPI_Recv(bbuf, current_packet, datatype, children[i], TREE_TAG, comm, &status);
+      reduce_op_2(current_packet, 0, datatype, op, bbuf, acc);
+    }
+
+    if (parent >= 0) MPI_Send(acc, current_packet, datatype, parent, TREE_TAG, comm);
+#else
+    rle_ops->compress(current_packet, (void *) (sbuf + done * type_size), &na, abuf);
+
+    for (i = 0; i < nchildren; i++)
+    {
+      MPI_Recv(bbuf, current_packet, datatype, children[i], TREE_TAG, comm, &status);
+      MPI_Get_count(&status, datatype, &nb);
+
+      rle_ops->cf_cf_add2_cf(na, abuf, nb, bbuf, &nc, cbuf);
+      tbuf = abuf; abuf = cbuf; cbuf = tbuf;
+      na = nc;
+    }
+
+    if (parent >= 0) MPI_Send(abuf, na, datatype, parent, TREE_TAG, comm);
+    else rle_ops->uncompress(na, abuf, NULL, rbuf + done * type_size);
+#endif
+  }
+
+  free(abuf);
+  free(bbuf);
+#ifdef RLE
+  free(cbuf);
+#endif
+  free(children);
+
+end:
+
+  return MPI_SUCCESS;
+}
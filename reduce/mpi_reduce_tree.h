@@ -0,0 +1,48 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MPI_REDUCE_TREE_H__
+#define __MPI_REDUCE_TREE_H__
+
+
+/* tree shape and packets of the tree algorithms */
+typedef struct _tree_attr
+{
+  /* number of children of the inner nodes, binomial tree if < 2 */
+  int arity;
+
+  /* size of the packets in bytes that are reduced and forwarded independently (pipelining within the tree),
+     the whole vector is a single packet if <= 0 */
+  int packet_size;
+
+  /* order the processes of the trees by hosts and shared-memory domains (see mpi_reduce_topo.h) */
+  int topo;
+
+} tree_attr;
+
+
+extern tree_attr default_ta;
+
+
+int MPI_Reduce_tree(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Reduce_tree_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+
+#endif /* __MPI_REDUCE_TREE_H__ */
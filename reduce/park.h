@@ -0,0 +1,130 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __PARK_H__
+#define __PARK_H__
+
+
+/* Spin-then-park waiting on a 32-bit word. Waiters spin for a bounded number of iterations and then sleep in
+   the kernel (futex on Linux, sched_yield elsewhere). Wakers only enter the kernel if a waiter is parked. */
+
+#include <limits.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __linux__
+ #include <sys/syscall.h>
+ #include <linux/futex.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+ #define park_pause()  __builtin_ia32_pause()
+#else
+ #define park_pause()  __asm__ __volatile__("" ::: "memory")
+#endif
+
+#define PARK_SPINS  (1 << 14)
+
+typedef struct _park_word
+{
+  unsigned value;
+  unsigned parked;
+
+} park_word;
+
+
+/* spinning only pays off if every thread has a CPU of its own */
+static inline int park_spins(int nthreads)
+{
+  long ncpus;
+#ifdef CPU_COUNT
+  cpu_set_t cpuset;
+
+  if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) ncpus = CPU_COUNT(&cpuset);
+  else
+#endif
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return (nthreads <= ncpus)?PARK_SPINS:0;
+}
+
+
+static inline unsigned park_load(park_word *w)
+{
+  return __atomic_load_n(&w->value, __ATOMIC_ACQUIRE);
+}
+
+
+static inline void park_wake(park_word *w)
+{
+  if (__atomic_load_n(&w->parked, __ATOMIC_SEQ_CST) == 0) return;
+
+#ifdef __linux__
+  syscall(SYS_futex, &w->value, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+
+static inline void park_store(park_word *w, unsigned value)
+{
+  __atomic_store_n(&w->value, value, __ATOMIC_SEQ_CST);
+  park_wake(w);
+}
+
+
+/* returns the new value */
+static inline unsigned park_add(park_word *w, unsigned value)
+{
+  unsigned v = __atomic_add_fetch(&w->value, value, __ATOMIC_SEQ_CST);
+
+  park_wake(w);
+
+  return v;
+}
+
+
+/* wait as long as the word is equal to value, returns the new value */
+static inline unsigned park_wait(park_word *w, unsigned value, int spins)
+{
+  unsigned v;
+
+  while (spins-- > 0)
+  {
+    if ((v = park_load(w)) != value) return v;
+    park_pause();
+  }
+
+  while ((v = park_load(w)) == value)
+  {
+    __atomic_add_fetch(&w->parked, 1, __ATOMIC_SEQ_CST);
+#ifdef __linux__
+    syscall(SYS_futex, &w->value, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+    if (__atomic_load_n(&w->value, __ATOMIC_SEQ_CST) == value) sched_yield();
+#endif
+    __atomic_sub_fetch(&w->parked, 1, __ATOMIC_SEQ_CST);
+  }
+
+  return v;
+}
+
+
+#endif /* __PARK_H__ */
@@ -0,0 +1,197 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <mpi.h>
+
+#ifdef USE_NUMA
+ #include <numa.h>
+ #include <numaif.h>
+#endif
+
+#include "reduce_op.h"
+#include "reduce_numa.h"
+
+
+static int numa_enabled = -1;
+
+
+int reduce_numa_enabled()
+{
+#ifdef USE_NUMA
+  const char *s;
+
+  if (numa_enabled < 0)
+  {
+    s = getenv("ZMPI_REDUCE_NUMA");
+
+    if (numa_available() < 0) numa_enabled = 0;
+    else if (s) numa_enabled = (atoi(s) != 0);
+    else numa_enabled = (numa_num_configured_nodes() > 1);
+  }
+
+#else
+  numa_enabled = 0;
+#endif
+
+  return numa_enabled;
+}
+
+
+int reduce_numa_nodes()
+{
+  int nodes = 1;
+
+#ifdef USE_NUMA
+  if (reduce_numa_enabled())
+  {
+    nodes = numa_num_configured_nodes();
+    if (nodes > REDUCE_NUMA_MAX_NODES) nodes = REDUCE_NUMA_MAX_NODES;
+  }
+#endif
+
+  return nodes;
+}
+
+
+static int reduce_numa_valid_node(int node)
+{
+  return (node >= 0 && node < reduce_numa_nodes())?node:0;
+}
+
+
+int reduce_numa_node_of_cpu(int cpu)
+{
+#ifdef USE_NUMA
+  if (reduce_numa_enabled()) return reduce_numa_valid_node(numa_node_of_cpu(cpu));
+#endif
+
+  return 0;
+}
+
+
+int reduce_numa_current_node()
+{
+#ifdef USE_NUMA
+  if (reduce_numa_enabled()) return reduce_numa_node_of_cpu(sched_getcpu());
+#endif
+
+  return 0;
+}
+
+
+void reduce_numa_run_on_node(int node)
+{
+#ifdef USE_NUMA
+  if (reduce_numa_enabled()) numa_run_on_node(node);
+#endif
+}
+
+
+/* threads are distributed blockwise over the nodes */
+int reduce_numa_thread_node(int tidx, int nthreads)
+{
+  return (int) (((long) tidx * reduce_numa_nodes()) / nthreads);
+}
+
+
+void reduce_numa_partition(int count, int type_size, const void *buf, int nthreads, const int *thread_nodes, int nblocks, int *bounds, int *owners)
+{
+  const long page_size = sysconf(_SC_PAGESIZE);
+
+  int b, d, w, nodes, ngroups;
+  int *status, *group_first, *group_threads, *group_blocks, *group_next, *threads;
+  void **pages;
+
+  nodes = reduce_numa_nodes();
+  ngroups = nodes + 1;  /* the last group contains all threads */
+
+  for (b = 0; b < nblocks; b++) bounds[b] = (int) (((long) b * count) / nblocks) & ~(REDUCE_CHUNK_ALIGN - 1);
+  bounds[nblocks] = count;
+
+  status = malloc(nblocks * sizeof(int));
+  pages = malloc(nblocks * sizeof(void *));
+
+  for (b = 0; b < nblocks; b++)
+  {
+    pages[b] = (void *) (((uintptr_t) buf + (size_t) bounds[b] * type_size) & ~(uintptr_t) (page_size - 1));
+    status[b] = -1;
+  }
+
+#ifdef USE_NUMA
+  if (reduce_numa_enabled() && move_pages(0, nblocks, pages, NULL, status, 0) != 0)
+  {
+    for (b = 0; b < nblocks; b++) status[b] = -1;
+  }
+#endif
+
+  group_first = calloc(ngroups + 1, sizeof(int));
+  group_threads = calloc(ngroups, sizeof(int));
+  group_blocks = calloc(ngroups, sizeof(int));
+  group_next = calloc(ngroups, sizeof(int));
+  threads = malloc(2 * nthreads * sizeof(int));
+
+  /* threads sorted by node, followed by all threads (sorted by node) as the last group */
+  for (w = 0; w < nthreads; w++) group_threads[reduce_numa_valid_node(thread_nodes[w])]++;
+  group_threads[nodes] = nthreads;
+
+  for (d = 0; d < ngroups; d++) group_first[d + 1] = group_first[d] + group_threads[d];
+
+  for (w = 0; w < nthreads; w++)
+  {
+    d = reduce_numa_valid_node(thread_nodes[w]);
+    threads[group_first[d] + group_next[d]++] = w;
+  }
+  for (w = 0; w < nthreads; w++) threads[group_first[nodes] + w] = threads[w];
+
+  /* group of every block */
+  for (b = 0; b < nblocks; b++)
+  {
+    d = status[b];
+    if (d < 0 || d >= nodes || group_threads[d] == 0) d = nodes;
+    status[b] = d;
+    group_blocks[d]++;
+  }
+
+  /* consecutive blocks of a group are distributed evenly over the threads of the group */
+  for (d = 0; d < ngroups; d++) group_next[d] = 0;
+
+  for (b = 0; b < nblocks; b++)
+  {
+    d = status[b];
+    owners[b] = threads[group_first[d] + (int) (((long) group_next[d]++ * group_threads[d]) / group_blocks[d])];
+  }
+
+  free(status);
+  free(pages);
+  free(group_first);
+  free(group_threads);
+  free(group_blocks);
+  free(group_next);
+  free(threads);
+}
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REDUCE_NUMA_H__
+#define __REDUCE_NUMA_H__
+
+
+/* NUMA-aware partitioning of threaded reductions. The vector is split into blocks and every block is assigned
+   to a thread running on the node that holds the block's pages (queried with move_pages). Blocks with unknown
+   nodes (e.g., pages not yet touched) or on nodes without threads are distributed over all threads.
+
+   The NUMA mode requires libnuma (CMake option USE_NUMA). It is enabled if the system has more than one node,
+   the environment variable ZMPI_REDUCE_NUMA=0/1 overrides this. Without the NUMA mode there is one node. */
+
+#define REDUCE_NUMA_MAX_NODES          64
+#define REDUCE_NUMA_BLOCKS_PER_THREAD  4
+#define REDUCE_NUMA_MIN_BYTES          (1024 * 1024)
+
+int reduce_numa_enabled();
+int reduce_numa_nodes();
+int reduce_numa_current_node();
+int reduce_numa_node_of_cpu(int cpu);
+void reduce_numa_run_on_node(int node);
+int reduce_numa_thread_node(int tidx, int nthreads);
+
+void reduce_numa_partition(int count, int type_size, const void *buf, int nthreads, const int *thread_nodes, int nblocks, int *bounds, int *owners);
+
+
+#endif /* __REDUCE_NUMA_H__ */
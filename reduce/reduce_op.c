@@ -18,117 +18,236 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <mpi.h>
 
-#ifdef USE_NUMA
- #include <numa.h>
+#ifdef USE_DBLV
+ #include "dblv.h"
 #endif
 
+#include "memory.h"
 #include "reduce_op.h"
+#include "reduce_pool.h"
+
+#define REDUCE_SUM(a, b)  ((a) + (b))
+#define REDUCE_MAX(a, b)  (((a) > (b))?(a):(b))
+#define REDUCE_MIN(a, b)  (((a) < (b))?(a):(b))
+
+#define REDUCE_LOOP_2(i, n, in, out, op)        for (i = 0; i < n; i++) out[i] = op(out[i], in[i])
+#define REDUCE_LOOP_3(i, n, in0, in1, out, op)  for (i = 0; i < n; i++) out[i] = op(in0[i], in1[i])
+
+#define REDUCE_TYPE_2(type, n, offset, op, in, out)  do { \
+  const type *in_ = (const type *) (in) + (offset); \
+  type *out_ = (type *) (out) + (offset); \
+  int i_; \
+  if (op == MPI_SUM) REDUCE_LOOP_2(i_, n, in_, out_, REDUCE_SUM); \
+  else if (op == MPI_MAX) REDUCE_LOOP_2(i_, n, in_, out_, REDUCE_MAX); \
+  else if (op == MPI_MIN) REDUCE_LOOP_2(i_, n, in_, out_, REDUCE_MIN); \
+} while (0)
+
+#define REDUCE_TYPE_3(type, n, offset, op, in0, in1, out)  do { \
+  const type *in0_ = (const type *) (in0) + (offset); \
+  const type *in1_ = (const type *) (in1) + (offset); \
+  type *out_ = (type *) (out) + (offset); \
+  int i_; \
+  if (op == MPI_SUM) REDUCE_LOOP_3(i_, n, in0_, in1_, out_, REDUCE_SUM); \
+  else if (op == MPI_MAX) REDUCE_LOOP_3(i_, n, in0_, in1_, out_, REDUCE_MAX); \
+  else if (op == MPI_MIN) REDUCE_LOOP_3(i_, n, in0_, in1_, out_, REDUCE_MIN); \
+} while (0)
+
+
+int reduce_op_supported(MPI_Datatype datatype, MPI_Op op)
+{
+  if (datatype != MPI_DOUBLE && datatype != MPI_FLOAT && datatype != MPI_INT && datatype != MPI_LONG) return 0;
 
-#define REDUCE_LOOP_2(i, n, in, out, op)        for (i = 0; i < n; i++) *(out++) op *(in++)
-#define REDUCE_LOOP_3(i, n, in0, in1, out, op)  for (i = 0; i < n; i++) *(out++) = *(in0++) op *(in1++)
+  if (op != MPI_SUM && op != MPI_MAX && op != MPI_MIN) return 0;
 
+  return 1;
+}
 
-void reduce_op_2(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out)
+
+const struct _dblv_rle_ops *reduce_rle_ops(MPI_Datatype datatype, MPI_Op op)
 {
-  int i;
+#ifdef USE_DBLV
+  int type, rop;
+
+  /* zero runs are encoded as NaN tokens (floating point types) or as values of a reserved range (integers) */
+  if (datatype == MPI_DOUBLE) type = DBLV_RLE_DOUBLE;
+  else if (datatype == MPI_FLOAT) type = DBLV_RLE_FLOAT;
+  else if (datatype == MPI_INT) type = DBLV_RLE_INT;
+  else if (datatype == MPI_LONG) type = DBLV_RLE_LONG;
+  else return NULL;
+
+  if (op == MPI_SUM) rop = DBLV_RLE_SUM;
+  else if (op == MPI_MAX) rop = DBLV_RLE_MAX;
+  else if (op == MPI_MIN) rop = DBLV_RLE_MIN;
+  else return NULL;
+
+  return dblv_rle_zero_ops(type, rop);
+#else
+  return NULL;
+#endif
+}
 
-  const double *dbl_in;
-  double *dbl_out, t;
 
-  t = MPI_Wtime();
-  if (datatype == MPI_DOUBLE)
-  {
-    dbl_in = in;
-    dbl_out = out;
+const struct _dblv_coo_ops *reduce_coo_ops(MPI_Datatype datatype, MPI_Op op)
+{
+#ifdef USE_DBLV
+  int type, rop;
 
-    dbl_in += offset;
-    dbl_out += offset;
+  /* index-value kernels exist for the floating point datatypes */
+  if (datatype == MPI_DOUBLE) type = DBLV_RLE_DOUBLE;
+  else if (datatype == MPI_FLOAT) type = DBLV_RLE_FLOAT;
+  else return NULL;
 
-    if (op == MPI_SUM)
-    {
-      REDUCE_LOOP_2(i, count, dbl_in, dbl_out, +=);
-    }
-  }
-  reduce_times[1] += MPI_Wtime() - t;
+  if (op == MPI_SUM) rop = DBLV_RLE_SUM;
+  else if (op == MPI_MAX) rop = DBLV_RLE_MAX;
+  else if (op == MPI_MIN) rop = DBLV_RLE_MIN;
+  else return NULL;
+
+  return dblv_coo_get_ops(type, rop);
+#else
+  return NULL;
+#endif
 }
 
 
-void reduce_op_3(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in0, const void *in1, void *out)
+#define REDUCE_NONZEROS(type, n, buf, samples, nz)  do { \
+  const type *v_ = (const type *) (buf); \
+  long i_; \
+  for (i_ = 0; i_ < samples; i_++) if (v_[i_ * n / samples] != 0) nz++; \
+} while (0)
+
+double reduce_nonzero_fraction(MPI_Datatype datatype, int count, const void *buf, int samples)
 {
-  int i;
+  int nz = 0;
 
-  const double *dbl_in0, *dbl_in1;
-  double *dbl_out, t;
+  if (count <= 0) return 0.0;
+  if (samples > count) samples = count;
 
-  t = MPI_Wtime();
-  if (datatype == MPI_DOUBLE)
-  {
-    dbl_in0 = in0;
-    dbl_in1 = in1;
-    dbl_out = out;
+  if (datatype == MPI_DOUBLE) REDUCE_NONZEROS(double, count, buf, samples, nz);
+  else if (datatype == MPI_FLOAT) REDUCE_NONZEROS(float, count, buf, samples, nz);
+  else if (datatype == MPI_INT) REDUCE_NONZEROS(int, count, buf, samples, nz);
+  else if (datatype == MPI_LONG) REDUCE_NONZEROS(long, count, buf, samples, nz);
 
-    dbl_in0 += offset;
-    dbl_in1 += offset;
-    dbl_out += offset;
+  return (double) nz / samples;
+}
 
-    if (op == MPI_SUM)
-    {
-      REDUCE_LOOP_3(i, count, dbl_in0, dbl_in1, dbl_out, +);
-    }
+
+void reduce_op_2_serial(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out)
+{
+  if (datatype == MPI_DOUBLE) REDUCE_TYPE_2(double, count, offset, op, in, out);
+  else if (datatype == MPI_FLOAT) REDUCE_TYPE_2(float, count, offset, op, in, out);
+  else if (datatype == MPI_INT) REDUCE_TYPE_2(int, count, offset, op, in, out);
+  else if (datatype == MPI_LONG) REDUCE_TYPE_2(long, count, offset, op, in, out);
+}
+
+
+void reduce_op_2(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out)
+{
+  int type_size, pooled = 0;
+  double t;
+
+  t = MPI_Wtime();
+  if (reduce_pool_enabled())
+  {
+    MPI_Type_size(datatype, &type_size);
+    pooled = ((long) count * type_size >= REDUCE_POOL_MIN_BYTES);
   }
+
+  if (pooled) reduce_pool_op_2(count, offset, datatype, op, in, out);
+  else reduce_op_2_serial(count, offset, datatype, op, in, out);
   reduce_times[1] += MPI_Wtime() - t;
 }
 
 
-#define bitmap_set(bm, n)    ((bm) |= (1 << (n)))
-#define bitmap_unset(bm, n)  ((bm) &= ~(1 << (n)))
-#define bitmap_get(bm, n)    (((bm) >> (n)) & 1)
-#define bitmap_setall(bm)    ((bm) = 0xFF)
-#define bitmap_unsetall(bm)  ((bm) = 0)
+void reduce_rle_op_2(const struct _dblv_rle_ops *rle_ops, int count, int nin, const void *in, void *out)
+{
+#ifdef USE_DBLV
+  double t;
+
+  t = MPI_Wtime();
+  if (reduce_pool_enabled() && (long) count * rle_ops->type_size >= REDUCE_POOL_MIN_BYTES) reduce_pool_rle_op_2(rle_ops, count, nin, in, out);
+  else rle_ops->uc_cf_add2_uc(count, out, nin, (void *) in, &count, NULL);
+  reduce_times[1] += MPI_Wtime() - t;
+#endif
+}
 
-double rt[8], rtimes[8];
 
-void *reduce_task(void *arg)
+void reduce_rle_merge(const struct _dblv_rle_ops *rle_ops, int count, int nin0, const void *in0, int nin1, const void *in1, int *nout, void *out)
 {
-  reduce_task_info *rti = (reduce_task_info *) arg;
+#ifdef USE_DBLV
+  double t;
 
-#ifdef USE_NUMA
-/*  numa_run_on_node((rti->tidx + 1) / 2);*/
-  numa_run_on_node(rti->tidx);
+  /* the work depends on the compressed sizes */
+  t = MPI_Wtime();
+  if (reduce_pool_enabled() && (long) (nin0 + nin1) * rle_ops->type_size >= REDUCE_POOL_MIN_BYTES) reduce_pool_rle_merge(rle_ops, count, nin0, in0, nin1, in1, nout, out);
+  else rle_ops->cf_cf_add2_cf(nin0, (void *) in0, nin1, (void *) in1, nout, out);
+  reduce_times[1] += MPI_Wtime() - t;
 #endif
+}
 
-  while (1)
+
+void reduce_op_3(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in0, const void *in1, void *out)
+{
+  double t;
+
+  t = MPI_Wtime();
+  if (datatype == MPI_DOUBLE) REDUCE_TYPE_3(double, count, offset, op, in0, in1, out);
+  else if (datatype == MPI_FLOAT) REDUCE_TYPE_3(float, count, offset, op, in0, in1, out);
+  else if (datatype == MPI_INT) REDUCE_TYPE_3(int, count, offset, op, in0, in1, out);
+  else if (datatype == MPI_LONG) REDUCE_TYPE_3(long, count, offset, op, in0, in1, out);
+  reduce_times[1] += MPI_Wtime() - t;
+}
+
+
+static void reduce_task_run(threaded_reduce_info *tri, reduce_task_info *rti)
+{
+  int i;
+  double t;
+
+  t = MPI_Wtime();
+  if (tri->partitioned)
   {
-    pthread_mutex_lock(&rti->tri->mutex);
-    while (!bitmap_get(rti->tri->run, rti->tidx))
+    rti->last_count = 0;
+    for (i = 0; i < tri->nblocks; i++)
+    if (tri->owners[i] == rti->tidx)
     {
-      pthread_cond_wait(&rti->tri->cond, &rti->tri->mutex);
+      reduce_op_2_serial(tri->bounds[i + 1] - tri->bounds[i], tri->bounds[i], rti->datatype, rti->op, rti->in, rti->out);
+      rti->last_count += tri->bounds[i + 1] - tri->bounds[i];
     }
-    pthread_mutex_unlock(&rti->tri->mutex);
 
-    if (rti->tri->exit) break;
+  } else
+  {
+    reduce_op_2_serial(rti->count, rti->offset, rti->datatype, rti->op, rti->in, rti->out);
+    rti->last_count = rti->count;
+  }
+  rti->last_time = MPI_Wtime() - t;
+  rti->time += rti->last_time;
+}
+
+void *reduce_task(void *arg)
+{
+  reduce_task_info *rti = (reduce_task_info *) arg;
+  threaded_reduce_info *tri = rti->tri;
+
+  unsigned generation = 0;
 
-    rt[rti->tidx] = MPI_Wtime();
-    reduce_op_2(rti->count, rti->offset, rti->datatype, rti->op, rti->in, rti->out);
-    rtimes[rti->tidx] += MPI_Wtime() - rt[rti->tidx];
+  if (tri->numa) reduce_numa_run_on_node(tri->thread_nodes[rti->tidx]);
 
-/*    pthread_mutex_lock(&rti->tri->mutex_done);
-    bitmap_unset(rti->tri->run, rti->tidx);
-    rti->tri->done++;
-    pthread_mutex_unlock(&rti->tri->mutex_done);
+  while (1)
+  {
+    generation = park_wait(&tri->generation, generation, tri->spins);
 
-    pthread_cond_signal(&rti->tri->cond_done);*/
+    if (__atomic_load_n(&tri->exit, __ATOMIC_ACQUIRE)) break;
 
-    pthread_mutex_lock(&rti->tri->mutex);
-    bitmap_unset(rti->tri->run, rti->tidx);
-    if (++rti->tri->done >= rti->tri->nreduce_tasks) pthread_cond_signal(&rti->tri->cond_done);
-/*    rti->tri->done++;*/
-    pthread_mutex_unlock(&rti->tri->mutex);
+    reduce_task_run(tri, rti);
+
+    park_store(&rti->done, generation);
   }
 
   return NULL;
@@ -138,75 +257,79 @@ void threaded_reduce_init(threaded_reduce_info *tri, int nthreads)
 {
   int i;
 
-/*  printf("threaded_reduce_init\n");*/
-
-/*  numa_run_on_node(0);*/
+  tri->generation.value = tri->generation.parked = 0;
+  tri->exit = 0;
+  tri->spins = park_spins(nthreads);
+  tri->stats = NULL;
 
-  pthread_mutex_init(&tri->mutex, NULL);
-  pthread_mutex_init(&tri->mutex_done, NULL);
-  pthread_cond_init(&tri->cond, NULL);
-  pthread_cond_init(&tri->cond_done, NULL);
+  tri->numa = reduce_numa_enabled();
+  tri->partitioned = 0;
+  tri->nblocks = REDUCE_NUMA_BLOCKS_PER_THREAD * nthreads;
+  tri->thread_nodes = malloc(nthreads * sizeof(int));
+  tri->bounds = malloc((tri->nblocks + 1) * sizeof(int));
+  tri->owners = malloc(tri->nblocks * sizeof(int));
 
-  tri->exit = 0;
-  tri->done = 1;
-  bitmap_unsetall(tri->run);
+  /* the calling thread (last task) stays where it is, its node is determined for every call */
+  for (i = 0; i < nthreads; i++) tri->thread_nodes[i] = (tri->numa)?reduce_numa_thread_node(i, nthreads):0;
 
   tri->nreduce_tasks = nthreads;
-  tri->rtis = (reduce_task_info *) malloc(nthreads * sizeof(reduce_task_info));
+  tri->rtis = (reduce_task_info *) malloc_aligned(nthreads * sizeof(reduce_task_info), REDUCE_CACHE_LINE, &tri->rtis_free);
 
-  for (i = 0; i < nthreads - 1; i++)
+  for (i = 0; i < nthreads; i++)
   {
     tri->rtis[i].tri = tri;
     tri->rtis[i].tidx = i;
-    pthread_create(&tri->rtis[i].tid, NULL, reduce_task, (void *) &tri->rtis[i]);
+    tri->rtis[i].done.value = tri->rtis[i].done.parked = 0;
+    tri->rtis[i].time = 0.0;
+    tri->rtis[i].last_count = 0;
+    tri->rtis[i].last_time = 0.0;
   }
-  tri->rtis[i].tri = tri;
-  tri->rtis[i].tidx = nthreads - 1;
 
-  rtimes[0] = rtimes[1] = rtimes[2] = rtimes[3] = 0.0;
-
-/*  printf("threaded_reduce_init done\n");*/
+  for (i = 0; i < nthreads - 1; i++) pthread_create(&tri->rtis[i].tid, NULL, reduce_task, (void *) &tri->rtis[i]);
 }
 
 void threaded_reduce_destroy(threaded_reduce_info *tri)
 {
   int i;
 
-/*  printf("threaded_reduce_destroy\n");*/
-
   double t = MPI_Wtime();
 
-  pthread_mutex_lock(&tri->mutex);
-  tri->exit = 1;
-  bitmap_setall(tri->run);
-  pthread_cond_broadcast(&tri->cond);
-  pthread_mutex_unlock(&tri->mutex);
+  __atomic_store_n(&tri->exit, 1, __ATOMIC_RELEASE);
+  park_add(&tri->generation, 1);
 
   for (i = 0; i < tri->nreduce_tasks - 1; i++) pthread_join(tri->rtis[i].tid, NULL);
 
-  free(tri->rtis);
+  free(tri->rtis_free);
+  free(tri->thread_nodes);
+  free(tri->bounds);
+  free(tri->owners);
 
-  pthread_mutex_destroy(&tri->mutex);
-  pthread_mutex_destroy(&tri->mutex_done);
-  pthread_cond_destroy(&tri->cond);
-  pthread_cond_destroy(&tri->cond_done);
+  if (tri->stats) tri->stats->destroy_time += MPI_Wtime() - t;
+}
 
-  printf("threaded_reduce_destroy = %f\n", MPI_Wtime() - t);
+void threaded_reduce_set_stats(threaded_reduce_info *tri, threaded_reduce_stats *stats)
+{
+  tri->stats = stats;
+}
 
-  printf("threaded_reduce times: %f  %f  %f  %f  %f  %f  %f  %f\n", rtimes[0], rtimes[1], rtimes[2], rtimes[3], rtimes[4], rtimes[5], rtimes[6], rtimes[7]);
+double threaded_reduce_get_time(threaded_reduce_info *tri, int tidx)
+{
+  return (tidx >= 0 && tidx < tri->nreduce_tasks)?tri->rtis[tidx].time:0.0;
 }
 
-void threaded_reduce_op_2(threaded_reduce_info *tri, int count, MPI_Datatype datatype, MPI_Op op, void *in, void *out)
+void threaded_reduce_op_2(threaded_reduce_info *tri, int count, MPI_Datatype datatype, MPI_Op op, const void *in, void *out)
 {
-  int i;
+  int i, type_size;
+  unsigned generation, done;
+  double t, node_time[REDUCE_NUMA_MAX_NODES];
   reduce_task_info *rti_last = &tri->rtis[tri->nreduce_tasks - 1];
 
-/*  printf("threaded_reduce_op_2\n");*/
+  MPI_Type_size(datatype, &type_size);
 
   for (i = 0; i < tri->nreduce_tasks; i++)
   {
-    tri->rtis[i].offset = (i * count) / tri->nreduce_tasks;
-    tri->rtis[i].count = ((i + 1) * count) / tri->nreduce_tasks;
+    tri->rtis[i].offset = (int) (((long) i * count) / tri->nreduce_tasks) & ~(REDUCE_CHUNK_ALIGN - 1);
+    tri->rtis[i].count = (i + 1 < tri->nreduce_tasks)?((int) (((long) (i + 1) * count) / tri->nreduce_tasks) & ~(REDUCE_CHUNK_ALIGN - 1)):count;
     tri->rtis[i].count -= tri->rtis[i].offset;
 
     tri->rtis[i].datatype = datatype;
@@ -215,90 +338,53 @@ void threaded_reduce_op_2(threaded_reduce_info *tri, int count, MPI_Datatype dat
     tri->rtis[i].out = out;
   }
 
-  pthread_mutex_lock(&tri->mutex);
-  tri->done = 1;
-  tri->exit = 0;
-  bitmap_setall(tri->run);
-  pthread_mutex_unlock(&tri->mutex);
+  tri->partitioned = (tri->numa && (long) count * type_size >= REDUCE_NUMA_MIN_BYTES);
 
-  pthread_cond_broadcast(&tri->cond);
+  if (tri->partitioned)
+  {
+    tri->thread_nodes[tri->nreduce_tasks - 1] = reduce_numa_current_node();
+    reduce_numa_partition(count, type_size, out, tri->nreduce_tasks, tri->thread_nodes, tri->nblocks, tri->bounds, tri->owners);
+  }
 
-  rt[rti_last->tidx] = MPI_Wtime();
-  reduce_op_2(rti_last->count, rti_last->offset, rti_last->datatype, rti_last->op, rti_last->in, rti_last->out);
-  rtimes[rti_last->tidx] += MPI_Wtime() - rt[rti_last->tidx];
+  /* the new generation releases the workers */
+  generation = park_add(&tri->generation, 1);
 
-/*  printf("thread %d done at %f\n", rti_last->tidx, MPI_Wtime());*/
+  reduce_task_run(tri, rti_last);
 
-  double t = MPI_Wtime();
-  pthread_mutex_lock(&tri->mutex);
-  while (tri->done < tri->nreduce_tasks) pthread_cond_wait(&tri->cond_done, &tri->mutex);
-  pthread_mutex_unlock(&tri->mutex);
-  t = MPI_Wtime() - t;
+  if (tri->stats) tri->stats->reduce_time += rti_last->last_time;
 
-  printf("threaded_reduce_op_2 %f\n", t);
-}
+  t = MPI_Wtime();
+  for (i = 0; i < tri->nreduce_tasks - 1; i++)
+  {
+    while ((done = park_load(&tri->rtis[i].done)) != generation) park_wait(&tri->rtis[i].done, done, tri->spins);
+  }
 
+  if (tri->stats)
+  {
+    tri->stats->wait_time += MPI_Wtime() - t;
+    tri->stats->ncalls++;
 
-#define REDUCE_THREADS  4
+    for (i = 0; i < REDUCE_NUMA_MAX_NODES; i++) node_time[i] = 0.0;
 
-typedef struct _double_reduce_task_info
-{
-  double *in, *out;
-  int count;
+    for (i = 0; i < tri->nreduce_tasks; i++)
+    {
+      tri->stats->node_bytes[tri->thread_nodes[i]] += (double) tri->rtis[i].last_count * type_size;
+      if (tri->rtis[i].last_time > node_time[tri->thread_nodes[i]]) node_time[tri->thread_nodes[i]] = tri->rtis[i].last_time;
+    }
 
-} double_reduce_task_info;
+    for (i = 0; i < REDUCE_NUMA_MAX_NODES; i++) tri->stats->node_time[i] += node_time[i];
+  }
+}
 
-reduce_task_info reduce_task_infos[REDUCE_THREADS];
 
 double reduce_times[3];
 
-void *static_reduce_task(void *arg)
-{
-  reduce_task_info *rti = (reduce_task_info *) arg;
-
-  int i;
-
-  const double *dbl_in = rti->in;
-  double *dbl_out = rti->out;
-
-  REDUCE_LOOP_2(i, rti->count, dbl_in, dbl_out, +=);
-
-  return 0;
-}
-
 
 void static_threaded_reduce_op_2(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out)
 {
-  int i, n;
-
-  const double *dbl_in = in;
-  double *dbl_out = out;
-
   double t;
 
-  pthread_t ths[REDUCE_THREADS - 1];
-
-  n = count / REDUCE_THREADS;
-
   t = MPI_Wtime();
-  for (i = 0; i < REDUCE_THREADS - 1; i++)
-  {
-    reduce_task_infos[i].in = dbl_in + (i * n);
-    reduce_task_infos[i].out = dbl_out + (i * n);
-    reduce_task_infos[i].count = n;
-
-    pthread_create(&ths[i], NULL, static_reduce_task, (void *) &reduce_task_infos[i]);
-  }
-  reduce_times[0] += MPI_Wtime() - t;
-
-  dbl_in += (REDUCE_THREADS - 1) * n;
-  dbl_out += (REDUCE_THREADS - 1) * n;
-
-  t = MPI_Wtime();
-  REDUCE_LOOP_2(i, count - ((REDUCE_THREADS - 1) * n), dbl_in, dbl_out, +=);
+  reduce_pool_op_2(count, offset, datatype, op, in, out);
   reduce_times[1] += MPI_Wtime() - t;
-
-  t = MPI_Wtime();
-  for (i = 0; i < REDUCE_THREADS - 1; i++) pthread_join(ths[i], NULL);
-  reduce_times[2] += MPI_Wtime() - t;
 }
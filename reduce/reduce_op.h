@@ -22,44 +22,96 @@
 #define __REDUCE_OP_H__
 
 
+#include "park.h"
+#include "reduce_numa.h"
+
+
+#define REDUCE_CACHE_LINE   64
+
+/* chunk boundaries of threaded reductions are aligned to this number of elements to avoid false sharing */
+#define REDUCE_CHUNK_ALIGN  16
+
 struct _reduce_task_info;
+struct _dblv_rle_ops;
+struct _dblv_coo_ops;
 
-typedef struct _threaded_reduce_info
+/* optional statistics of a threaded reduction (see threaded_reduce_set_stats), times in seconds */
+typedef struct _threaded_reduce_stats
 {
-  pthread_mutex_t mutex, mutex_done;
-  pthread_cond_t cond, cond_done;
-  int exit, done;
+  long ncalls;
+  double reduce_time, wait_time, destroy_time;
 
-  int run;
+  /* bytes reduced by the threads of each node and the time they needed (per call the slowest thread),
+     i.e., node_bytes[i] / node_time[i] is the reduce bandwidth of node i */
+  double node_bytes[REDUCE_NUMA_MAX_NODES], node_time[REDUCE_NUMA_MAX_NODES];
+
+} threaded_reduce_stats;
+
+typedef struct _threaded_reduce_info
+{
+  park_word generation;
+  int exit, spins;
 
   int nreduce_tasks;
   struct _reduce_task_info *rtis;
+  void *rtis_free;
+
+  threaded_reduce_stats *stats;
+
+  /* NUMA-aware partitioning (see reduce_numa.h) */
+  int numa, partitioned, nblocks;
+  int *thread_nodes, *bounds, *owners;
 
 } threaded_reduce_info;
 
 
-typedef struct _reduce_task_info
+/* per-worker state, each on its own cache line(s) */
+typedef struct __attribute__((aligned(REDUCE_CACHE_LINE))) _reduce_task_info
 {
   threaded_reduce_info *tri;
 
   int tidx;
   pthread_t tid;
 
+  /* generation of the last completed task */
+  park_word done;
+
   int count, offset;
   MPI_Datatype datatype;
   MPI_Op op;
   const void *in;
   void *out;
 
+  double time;
+
+  /* elements reduced and time needed in the last call */
+  int last_count;
+  double last_time;
+
 } reduce_task_info;
 
 
+int reduce_op_supported(MPI_Datatype datatype, MPI_Op op);
+const struct _dblv_rle_ops *reduce_rle_ops(MPI_Datatype datatype, MPI_Op op);
+const struct _dblv_coo_ops *reduce_coo_ops(MPI_Datatype datatype, MPI_Op op);
+
+/* fraction of non-zero elements estimated from evenly spaced samples of buf */
+double reduce_nonzero_fraction(MPI_Datatype datatype, int count, const void *buf, int samples);
+
+void reduce_op_2_serial(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out);
 void reduce_op_2(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out);
 void reduce_op_3(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in0, const void *in1, void *out);
 
+/* reductions with compressed operands that use the pool for large vectors as reduce_op_2 (see reduce_pool.h),
+   out (count elements) op= in (nin compressed elements) and out = in0 op in1 (compressed, out needs count elements) */
+void reduce_rle_op_2(const struct _dblv_rle_ops *rle_ops, int count, int nin, const void *in, void *out);
+void reduce_rle_merge(const struct _dblv_rle_ops *rle_ops, int count, int nin0, const void *in0, int nin1, const void *in1, int *nout, void *out);
+
 void threaded_reduce_init(threaded_reduce_info *tri, int nthreads);
 void threaded_reduce_destroy(threaded_reduce_info *tri);
-void threaded_reduce_op_2(threaded_reduce_info *tri, int count, MPI_Datatype datatype, MPI_Op op, void *in, void *out);
+void threaded_reduce_set_stats(threaded_reduce_info *tri, threaded_reduce_stats *stats);
+double threaded_reduce_get_time(threaded_reduce_info *tri, int tidx);
+void threaded_reduce_op_2(threaded_reduce_info *tri, int count, MPI_Datatype datatype, MPI_Op op, const void *in, void *out);
 
 extern double reduce_times[3];
 
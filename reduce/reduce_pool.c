@@ -0,0 +1,563 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <mpi.h>
+
+#ifdef USE_DBLV
+ #include "dblv.h"
+#endif
+
+#include "park.h"
+#include "reduce_op.h"
+#include "reduce_pool.h"
+
+
+typedef struct _reduce_pool
+{
+  pthread_mutex_t mutex;
+
+  int configured, enabled;
+  int ncpus, *cpus;
+
+  int started, nthreads, spins;
+  pthread_t *tids;
+  unsigned start_generation;
+
+  int numa, nblocks;
+  int *thread_nodes, *bounds, *owners;
+
+  park_word generation, pending;
+  int busy, exit;
+
+  int task, partitioned;
+
+  int count, offset;
+  MPI_Datatype datatype;
+  MPI_Op op;
+  const void *in;
+  void *out;
+
+  /* compressed operands (see reduce_pool_rle_op_2 and reduce_pool_rle_merge) */
+  const struct _dblv_rle_ops *rle_ops;
+  int nin0, nin1;
+  const void *in1;
+  struct _reduce_pool_rle_part *parts;
+
+} reduce_pool;
+
+/* part of a reduction with compressed operands: first uncompressed element, positions in the compressed
+   operands and the rest of their zero runs at the first element, compressed elements written */
+typedef struct _reduce_pool_rle_part
+{
+  int b, i0, i1, nwrite;
+  double next0, next1;
+
+} reduce_pool_rle_part;
+
+static reduce_pool pool = { PTHREAD_MUTEX_INITIALIZER, -1, -1 };
+
+#define REDUCE_POOL_TASK_OP     0
+#define REDUCE_POOL_TASK_TOUCH  1
+
+#define REDUCE_POOL_TASK_RLE_OP     2
+#define REDUCE_POOL_TASK_RLE_MERGE  3
+
+
+static int reduce_pool_parse_cpus(const char *s, int **cpus)
+{
+  int n = 0, max = 0, a, b;
+  char *e;
+
+  *cpus = NULL;
+
+  while (*s)
+  {
+    a = b = strtol(s, &e, 10);
+    if (e == s) break;
+    s = e;
+
+    if (*s == '-')
+    {
+      s++;
+      b = strtol(s, &e, 10);
+      if (e == s) break;
+      s = e;
+    }
+
+    for (; a <= b; a++)
+    {
+      if (n >= max)
+      {
+        max = (max > 0)?2 * max:16;
+        *cpus = realloc(*cpus, max * sizeof(int));
+      }
+      (*cpus)[n++] = a;
+    }
+
+    if (*s == ',') s++;
+  }
+
+  return n;
+}
+
+
+/* with pool.mutex locked */
+static void reduce_pool_config()
+{
+  const char *s;
+
+  if (pool.configured >= 0) return;
+
+  s = getenv("ZMPI_REDUCE_THREADS");
+  pool.configured = (s)?atoi(s):0;
+  if (pool.configured < 0) pool.configured = 0;
+
+  s = getenv("ZMPI_REDUCE_AFFINITY");
+  if (s && !pool.cpus) pool.ncpus = reduce_pool_parse_cpus(s, &pool.cpus);
+
+  __atomic_store_n(&pool.enabled, (pool.configured > 1), __ATOMIC_RELEASE);
+}
+
+
+static void reduce_pool_chunk(int w)
+{
+  int b0, b1;
+  long page_size;
+
+  if (pool.task == REDUCE_POOL_TASK_TOUCH)
+  {
+    /* pool.count bytes, page-aligned chunks */
+    page_size = sysconf(_SC_PAGESIZE);
+    b0 = (int) ((((long) w * pool.count) / pool.nthreads) & ~(page_size - 1));
+    b1 = (w + 1 < pool.nthreads)?((int) ((((long) (w + 1) * pool.count) / pool.nthreads) & ~(page_size - 1))):pool.count;
+
+    if (b1 > b0) memset((char *) pool.out + b0, 0, b1 - b0);
+    return;
+  }
+
+#ifdef USE_DBLV
+  if (pool.task == REDUCE_POOL_TASK_RLE_OP || pool.task == REDUCE_POOL_TASK_RLE_MERGE)
+  {
+    reduce_pool_rle_part *p = &pool.parts[w];
+    int size = pool.rle_ops->type_size, n = pool.parts[w + 1].b - p->b;
+
+    if (n <= 0) return;
+
+    /* out[b, b + n) op= in0, in place */
+    if (pool.task == REDUCE_POOL_TASK_RLE_OP)
+    {
+      void *out = (char *) pool.out + (long) p->b * size;
+      pool.rle_ops->cf_uc_add3_uc(pool.nin0 - p->i0, (char *) pool.in + (long) p->i0 * size, n, out, n, out, NULL, NULL, NULL, &p->next0);
+      return;
+    }
+
+    /* the part of in0 ends with the end of a zero run, i.e., the merge stops after n elements and the
+       compressed result is not longer than n */
+    pool.rle_ops->cf_cf_add3_cf(pool.parts[w + 1].i0 - p->i0, (char *) pool.in + (long) p->i0 * size, pool.nin1 - p->i1, (char *) pool.in1 + (long) p->i1 * size,
+      n, (char *) pool.out + (long) p->b * size, NULL, NULL, &p->nwrite, &p->next0, &p->next1);
+    return;
+  }
+#endif
+
+  if (pool.partitioned)
+  {
+    for (b0 = 0; b0 < pool.nblocks; b0++)
+    if (pool.owners[b0] == w) reduce_op_2_serial(pool.bounds[b0 + 1] - pool.bounds[b0], pool.offset + pool.bounds[b0], pool.datatype, pool.op, pool.in, pool.out);
+    return;
+  }
+
+  b0 = (int) (((long) w * pool.count) / pool.nthreads) & ~(REDUCE_CHUNK_ALIGN - 1);
+  b1 = (w + 1 < pool.nthreads)?((int) (((long) (w + 1) * pool.count) / pool.nthreads) & ~(REDUCE_CHUNK_ALIGN - 1)):pool.count;
+
+  if (b1 > b0) reduce_op_2_serial(b1 - b0, pool.offset + b0, pool.datatype, pool.op, pool.in, pool.out);
+}
+
+
+static void *reduce_pool_worker(void *arg)
+{
+  int w = (int) (long) arg;
+  unsigned generation = pool.start_generation;
+
+  cpu_set_t cpuset;
+
+  if (pool.ncpus > 0)
+  {
+    CPU_ZERO(&cpuset);
+    CPU_SET(pool.cpus[(w - 1) % pool.ncpus], &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+
+  } else if (pool.numa) reduce_numa_run_on_node(pool.thread_nodes[w]);
+
+  while (1)
+  {
+    generation = park_wait(&pool.generation, generation, pool.spins);
+
+    if (__atomic_load_n(&pool.exit, __ATOMIC_ACQUIRE)) break;
+
+    reduce_pool_chunk(w);
+
+    park_add(&pool.pending, (unsigned) -1);
+  }
+
+  return NULL;
+}
+
+
+/* with pool.mutex locked */
+static void reduce_pool_start()
+{
+  int i;
+
+  if (pool.started) return;
+
+  reduce_pool_config();
+
+  pool.nthreads = (pool.configured > 0)?pool.configured:REDUCE_POOL_THREADS;
+
+  pool.spins = park_spins(pool.nthreads);
+
+  pool.tids = malloc((pool.nthreads - 1) * sizeof(pthread_t));
+  pool.parts = malloc((pool.nthreads + 1) * sizeof(reduce_pool_rle_part));
+
+  pool.numa = reduce_numa_enabled();
+  pool.nblocks = REDUCE_NUMA_BLOCKS_PER_THREAD * pool.nthreads;
+  pool.thread_nodes = malloc(pool.nthreads * sizeof(int));
+  pool.bounds = malloc((pool.nblocks + 1) * sizeof(int));
+  pool.owners = malloc(pool.nblocks * sizeof(int));
+
+  /* workers with affinity are on the node of their CPU, otherwise they are bound to a node,
+     the node of the caller (thread 0) is determined for every call */
+  for (i = 0; i < pool.nthreads; i++)
+  {
+    if (!pool.numa) pool.thread_nodes[i] = 0;
+    else if (i > 0 && pool.ncpus > 0) pool.thread_nodes[i] = reduce_numa_node_of_cpu(pool.cpus[(i - 1) % pool.ncpus]);
+    else pool.thread_nodes[i] = reduce_numa_thread_node(i, pool.nthreads);
+  }
+
+  pool.start_generation = park_load(&pool.generation);
+
+  for (i = 1; i < pool.nthreads; i++) pthread_create(&pool.tids[i - 1], NULL, reduce_pool_worker, (void *) (long) i);
+
+  __atomic_store_n(&pool.started, 1, __ATOMIC_RELEASE);
+}
+
+
+/* with pool.mutex locked */
+static void reduce_pool_stop()
+{
+  int i;
+
+  if (!pool.started) return;
+
+  __atomic_store_n(&pool.exit, 1, __ATOMIC_RELEASE);
+  park_add(&pool.generation, 1);
+
+  for (i = 1; i < pool.nthreads; i++) pthread_join(pool.tids[i - 1], NULL);
+
+  free(pool.tids);
+  free(pool.thread_nodes);
+  free(pool.bounds);
+  free(pool.owners);
+  free(pool.parts);
+  pool.tids = NULL;
+  pool.parts = NULL;
+  pool.thread_nodes = pool.bounds = pool.owners = NULL;
+
+  pool.exit = 0;
+  __atomic_store_n(&pool.started, 0, __ATOMIC_RELEASE);
+}
+
+
+void reduce_pool_set_threads(int nthreads)
+{
+  pthread_mutex_lock(&pool.mutex);
+
+  reduce_pool_config();
+  reduce_pool_stop();
+
+  pool.configured = (nthreads > 0)?nthreads:0;
+  __atomic_store_n(&pool.enabled, (pool.configured > 1), __ATOMIC_RELEASE);
+
+  pthread_mutex_unlock(&pool.mutex);
+}
+
+
+int reduce_pool_get_threads()
+{
+  int nthreads;
+
+  pthread_mutex_lock(&pool.mutex);
+
+  reduce_pool_config();
+  nthreads = (pool.configured > 0)?pool.configured:REDUCE_POOL_THREADS;
+
+  pthread_mutex_unlock(&pool.mutex);
+
+  return nthreads;
+}
+
+
+void reduce_pool_set_affinity(int ncpus, const int *cpus)
+{
+  pthread_mutex_lock(&pool.mutex);
+
+  reduce_pool_config();
+  reduce_pool_stop();
+
+  free(pool.cpus);
+  pool.cpus = NULL;
+  pool.ncpus = 0;
+
+  if (ncpus > 0 && cpus)
+  {
+    pool.cpus = malloc(ncpus * sizeof(int));
+    memcpy(pool.cpus, cpus, ncpus * sizeof(int));
+    pool.ncpus = ncpus;
+  }
+
+  pthread_mutex_unlock(&pool.mutex);
+}
+
+
+int reduce_pool_enabled()
+{
+  int enabled = __atomic_load_n(&pool.enabled, __ATOMIC_ACQUIRE);
+
+  if (enabled < 0)
+  {
+    pthread_mutex_lock(&pool.mutex);
+    reduce_pool_config();
+    enabled = pool.enabled;
+    pthread_mutex_unlock(&pool.mutex);
+  }
+
+  return enabled;
+}
+
+
+void reduce_pool_finalize()
+{
+  pthread_mutex_lock(&pool.mutex);
+
+  reduce_pool_stop();
+
+  pthread_mutex_unlock(&pool.mutex);
+}
+
+
+/* returns 0 if the pool is not available, i.e., the caller has to do the work serially */
+static int reduce_pool_acquire()
+{
+  if (!__atomic_load_n(&pool.started, __ATOMIC_ACQUIRE))
+  {
+    pthread_mutex_lock(&pool.mutex);
+    reduce_pool_start();
+    pthread_mutex_unlock(&pool.mutex);
+  }
+
+  /* single thread or pool in use by another thread */
+  if (pool.nthreads <= 1 || __atomic_exchange_n(&pool.busy, 1, __ATOMIC_ACQUIRE)) return 0;
+
+  return 1;
+}
+
+
+static void reduce_pool_run()
+{
+  unsigned pending;
+
+  __atomic_store_n(&pool.pending.value, pool.nthreads - 1, __ATOMIC_RELAXED);
+  park_add(&pool.generation, 1);
+
+  reduce_pool_chunk(0);
+
+  while ((pending = park_load(&pool.pending)) != 0) park_wait(&pool.pending, pending, pool.spins);
+}
+
+
+static void reduce_pool_release()
+{
+  __atomic_store_n(&pool.busy, 0, __ATOMIC_RELEASE);
+}
+
+
+void reduce_pool_op_2(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out)
+{
+  int type_size;
+
+  if (!reduce_pool_acquire())
+  {
+    reduce_op_2_serial(count, offset, datatype, op, in, out);
+    return;
+  }
+
+  MPI_Type_size(datatype, &type_size);
+
+  pool.task = REDUCE_POOL_TASK_OP;
+  pool.count = count;
+  pool.offset = offset;
+  pool.datatype = datatype;
+  pool.op = op;
+  pool.in = in;
+  pool.out = out;
+
+  pool.partitioned = (pool.numa && (long) count * type_size >= REDUCE_NUMA_MIN_BYTES);
+
+  if (pool.partitioned)
+  {
+    pool.thread_nodes[0] = reduce_numa_current_node();
+    reduce_numa_partition(count, type_size, (char *) out + (long) offset * type_size, pool.nthreads, pool.thread_nodes, pool.nblocks, pool.bounds, pool.owners);
+  }
+
+  reduce_pool_run();
+  reduce_pool_release();
+}
+
+
+void reduce_pool_first_touch(void *buf, int size)
+{
+  if (!reduce_pool_enabled() || !reduce_pool_acquire())
+  {
+    memset(buf, 0, size);
+    return;
+  }
+
+  pool.task = REDUCE_POOL_TASK_TOUCH;
+  pool.count = size;
+  pool.out = buf;
+
+  reduce_pool_run();
+  reduce_pool_release();
+}
+
+
+#ifdef USE_DBLV
+
+/* the uncompressed vector of count elements is split into equal parts of the threads, the start of each part
+   in the compressed operand(s) is found by scanning their tokens, returns 0 if the caller has to do the work */
+static int reduce_pool_rle_split(const struct _dblv_rle_ops *rle_ops, int count, int nin0, const void *in0, int nin1, const void *in1, int whole)
+{
+  reduce_pool_rle_part *p;
+  int w, b = 0, i0 = 0, i1 = 0, nread, nskipped;
+  double next0 = 0, next1 = 0;
+
+  if (!reduce_pool_acquire()) return 0;
+
+  for (w = 0; w <= pool.nthreads; w++)
+  {
+    p = &pool.parts[w];
+
+    if (w > 0)
+    {
+      /* with whole != 0 (merges), parts of in0 end with the end of a zero run */
+      nskipped = 0;
+      if (w < pool.nthreads && b < (int) (((long) w * count) / pool.nthreads))
+      {
+        rle_ops->seek(nin0 - i0, (char *) in0 + (long) i0 * rle_ops->type_size, (int) (((long) w * count) / pool.nthreads) - b, whole, &nread, &nskipped, &next0);
+        i0 += nread;
+
+      } else if (w == pool.nthreads)
+      {
+        nskipped = count - b;
+        i0 = nin0;
+      }
+
+      if (in1 && nskipped > 0)
+      {
+        rle_ops->seek(nin1 - i1, (char *) in1 + (long) i1 * rle_ops->type_size, nskipped, 0, &nread, NULL, &next1);
+        i1 += nread;
+      }
+
+      b += nskipped;
+    }
+
+    p->b = b;
+    p->i0 = i0;
+    p->i1 = i1;
+    p->next0 = next0;
+    p->next1 = next1;
+    p->nwrite = 0;
+  }
+
+  return 1;
+}
+
+
+void reduce_pool_rle_op_2(const struct _dblv_rle_ops *rle_ops, int count, int nin, const void *in, void *out)
+{
+  if (!reduce_pool_rle_split(rle_ops, count, nin, in, 0, NULL, 0))
+  {
+    rle_ops->uc_cf_add2_uc(count, out, nin, (void *) in, &count, NULL);
+    return;
+  }
+
+  pool.task = REDUCE_POOL_TASK_RLE_OP;
+  pool.rle_ops = rle_ops;
+  pool.nin0 = nin;
+  pool.in = in;
+  pool.out = out;
+
+  reduce_pool_run();
+  reduce_pool_release();
+}
+
+
+void reduce_pool_rle_merge(const struct _dblv_rle_ops *rle_ops, int count, int nin0, const void *in0, int nin1, const void *in1, int *nout, void *out)
+{
+  int w, o;
+
+  if (!reduce_pool_rle_split(rle_ops, count, nin0, in0, nin1, in1, 1))
+  {
+    rle_ops->cf_cf_add2_cf(nin0, (void *) in0, nin1, (void *) in1, nout, out);
+    return;
+  }
+
+  pool.task = REDUCE_POOL_TASK_RLE_MERGE;
+  pool.rle_ops = rle_ops;
+  pool.nin0 = nin0;
+  pool.nin1 = nin1;
+  pool.in = in0;
+  pool.in1 = in1;
+  pool.out = out;
+
+  reduce_pool_run();
+
+  /* the compressed parts are written at their uncompressed offsets and are moved together */
+  for (w = 0, o = 0; w < pool.nthreads; w++)
+  {
+    if (o != pool.parts[w].b) memmove((char *) out + (long) o * rle_ops->type_size, (char *) out + (long) pool.parts[w].b * rle_ops->type_size, (long) pool.parts[w].nwrite * rle_ops->type_size);
+    o += pool.parts[w].nwrite;
+  }
+
+  reduce_pool_release();
+
+  *nout = o;
+}
+
+#endif
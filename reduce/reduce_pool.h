@@ -0,0 +1,61 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REDUCE_POOL_H__
+#define __REDUCE_POOL_H__
+
+
+/* Process-wide pool of persistent reduction threads. The pool is started on first use. The calling thread
+   reduces one chunk itself, so a pool of n threads runs n - 1 workers. If the pool is already used by another
+   thread, the reduction is performed serially by the caller.
+
+   Configuration (before first use or to restart the pool):
+     ZMPI_REDUCE_THREADS   number of threads including the caller (default: REDUCE_POOL_THREADS)
+     ZMPI_REDUCE_AFFINITY  CPU list for the workers, e.g. "2,3" or "8-15" (default: no affinity)
+
+   reduce_op_2 (and reduce_rle_op_2, reduce_rle_merge) use the pool for large vectors only if the number of threads was configured explicitly to a
+   value greater than 1 (environment or reduce_pool_set_threads).
+
+   If the NUMA mode is enabled (see reduce_numa.h), workers without affinity are bound to the nodes blockwise
+   and large vectors are partitioned according to the nodes of their pages. reduce_pool_first_touch zeroes a
+   buffer with the pool threads such that its pages are placed on the nodes of the threads reducing them. */
+
+#define REDUCE_POOL_THREADS    4
+#define REDUCE_POOL_MIN_BYTES  (256 * 1024)
+
+struct _dblv_rle_ops;
+
+void reduce_pool_set_threads(int nthreads);
+int reduce_pool_get_threads();
+void reduce_pool_set_affinity(int ncpus, const int *cpus);
+int reduce_pool_enabled();
+void reduce_pool_finalize();
+
+void reduce_pool_op_2(int count, int offset, MPI_Datatype datatype, MPI_Op op, const void *in, void *out);
+void reduce_pool_first_touch(void *buf, int size);
+
+/* out op= in (compressed) and out = in0 op in1 (all compressed, out needs count elements), the uncompressed
+   vector of count elements is split into parts of the threads by scanning the zero-run tokens */
+void reduce_pool_rle_op_2(const struct _dblv_rle_ops *rle_ops, int count, int nin, const void *in, void *out);
+void reduce_pool_rle_merge(const struct _dblv_rle_ops *rle_ops, int count, int nin0, const void *in0, int nin1, const void *in1, int *nout, void *out);
+
+
+#endif /* __REDUCE_POOL_H__ */
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "reduce_transport.h"
+
+
+#define TRANSPORT_MPI_WAITANY_MAX  16
+
+
+static int transport_mpi_isend(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, transport_request *request)
+{
+  request->active = 0;
+
+  return MPI_Isend(buf, count, datatype, dest, tag, comm, &request->mpi);
+}
+
+
+static int transport_mpi_irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, transport_request *request)
+{
+  request->active = 0;
+
+  return MPI_Irecv(buf, count, datatype, source, tag, comm, &request->mpi);
+}
+
+
+static int transport_mpi_waitany(int count, transport_request *requests, int *index, MPI_Status *status)
+{
+  MPI_Request reqs_local[TRANSPORT_MPI_WAITANY_MAX], *reqs;
+  int i, ret;
+
+  reqs = (count <= TRANSPORT_MPI_WAITANY_MAX)?reqs_local:malloc(count * sizeof(MPI_Request));
+
+  for (i = 0; i < count; i++) reqs[i] = requests[i].mpi;
+
+  ret = MPI_Waitany(count, reqs, index, status);
+
+  if (*index != MPI_UNDEFINED) requests[*index].mpi = reqs[*index];
+
+  if (reqs != reqs_local) free(reqs);
+
+  return ret;
+}
+
+
+const reduce_transport transport_mpi =
+{
+  "mpi",
+  MPI_Comm_rank,
+  MPI_Comm_size,
+  MPI_Barrier,
+  MPI_Send,
+  MPI_Recv,
+  MPI_Sendrecv,
+  transport_mpi_isend,
+  transport_mpi_irecv,
+  transport_mpi_waitany,
+  MPI_Reduce,
+  MPI_Allreduce,
+};
+
+
+__thread const reduce_transport *transport_current = &transport_mpi;
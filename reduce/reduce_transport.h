@@ -0,0 +1,104 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __REDUCE_TRANSPORT_H__
+#define __REDUCE_TRANSPORT_H__
+
+
+/* Transport of the messages of the pipeline (sendrecv, send_recv, isend_irecv, stream, coo), gather (also irecv and
+   packets) and Rabenseifner algorithms. The algorithms call transport_* instead of the MPI functions, these use the
+   transport of the calling thread: MPI (default) or the loopback transport of ZMPI_Transport_loopback_run that runs
+   all processes as threads of one process. The topology-aware order (default_pa.topo), the tuned, multi-lane,
+   bidirectional and hierarchical pipelines still use MPI directly and do not work with the loopback transport.
+
+   The loopback transport ignores the communicators (comm_rank and comm_size are the thread's rank and the number
+   of threads), sends are buffered and complete immediately. A message can be received after the emulated latency
+   and the transfer time (bytes / bandwidth) of the sender's link, that transfers its messages one after another.
+   Receives of requests are matched when they are completed. Buffers of default_pa must not be allocated, the
+   thread pool must be disabled and the MPI library must provide MPI_THREAD_MULTIPLE (datatypes and statuses are
+   handled with MPI). */
+
+#define TRANSPORT_LOOPBACK_TAG  32000
+
+typedef struct _transport_request
+{
+  MPI_Request mpi;
+
+  /* pending receive of the loopback transport */
+  int active;
+  void *buf;
+  int count, source, tag;
+  MPI_Datatype datatype;
+
+} transport_request;
+
+typedef struct _reduce_transport
+{
+  const char *name;
+
+  int (*comm_rank)(MPI_Comm comm, int *rank);
+  int (*comm_size)(MPI_Comm comm, int *size);
+  int (*barrier)(MPI_Comm comm);
+
+  int (*send)(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm);
+  int (*recv)(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status *status);
+  int (*sendrecv)(const void *sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag,
+                  void *recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status *status);
+
+  int (*isend)(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, transport_request *request);
+  int (*irecv)(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, transport_request *request);
+  int (*waitany)(int count, transport_request *requests, int *index, MPI_Status *status);
+
+  /* collectives of the fallbacks */
+  int (*reduce)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+  int (*allreduce)(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+
+} reduce_transport;
+
+
+extern const reduce_transport transport_mpi, transport_loopback;
+
+/* transport of the calling thread */
+extern __thread const reduce_transport *transport_current;
+
+#define transport_comm_rank(...)  transport_current->comm_rank(__VA_ARGS__)
+#define transport_comm_size(...)  transport_current->comm_size(__VA_ARGS__)
+#define transport_barrier(...)    transport_current->barrier(__VA_ARGS__)
+#define transport_send(...)       transport_current->send(__VA_ARGS__)
+#define transport_recv(...)       transport_current->recv(__VA_ARGS__)
+#define transport_sendrecv(...)   transport_current->sendrecv(__VA_ARGS__)
+#define transport_isend(...)      transport_current->isend(__VA_ARGS__)
+#define transport_irecv(...)      transport_current->irecv(__VA_ARGS__)
+#define transport_waitany(...)    transport_current->waitany(__VA_ARGS__)
+#define transport_wait(r, s)      do { int _i; transport_current->waitany(1, r, &_i, s); } while (0)
+#define transport_request_null(r)  do { (r)->mpi = MPI_REQUEST_NULL; (r)->active = 0; } while (0)
+#define transport_reduce(...)     transport_current->reduce(__VA_ARGS__)
+#define transport_allreduce(...)  transport_current->allreduce(__VA_ARGS__)
+
+
+/* runs fn(rank, nranks, arg) in nranks threads using the loopback transport with the given latency (seconds) and
+   bandwidth (bytes per second, <= 0: unlimited), the communicator arguments of the algorithms are ignored,
+   returns MPI_ERR_TRUNCATE if a message was larger than its receive buffer (also returned by the receive) */
+typedef void (*ZMPI_Transport_loopback_fn)(int rank, int nranks, void *arg);
+
+int ZMPI_Transport_loopback_run(int nranks, double latency, double bandwidth, ZMPI_Transport_loopback_fn fn, void *arg);
+
+
+#endif /* __REDUCE_TRANSPORT_H__ */
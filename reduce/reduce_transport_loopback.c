@@ -0,0 +1,419 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <mpi.h>
+
+#include "reduce_op.h"
+#include "reduce_transport.h"
+
+
+/* Loopback transport: every thread (rank) has a mailbox of the messages sent to it in the order they were sent.
+   A message is copied when it is sent and can be received at its ready time. */
+
+typedef struct _loopback_msg
+{
+  int source, tag;
+  long bytes;
+  double ready;
+
+  struct _loopback_msg *next;
+
+  char data[];
+
+} loopback_msg;
+
+typedef struct _loopback_box
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  loopback_msg *first, *last;
+
+  /* time the outgoing link of the rank is free (only used by the rank itself) */
+  double link_free;
+
+} loopback_box;
+
+typedef struct _loopback_world
+{
+  int nranks;
+  double latency, bandwidth;
+
+  loopback_box *boxes;
+  pthread_barrier_t barrier;
+
+  ZMPI_Transport_loopback_fn fn;
+  void *arg;
+
+  /* error of a receive (e.g. MPI_ERR_TRUNCATE), returned by ZMPI_Transport_loopback_run */
+  int error;
+
+} loopback_world;
+
+typedef struct _loopback_thread
+{
+  loopback_world *world;
+  int rank;
+
+} loopback_thread;
+
+static __thread loopback_world *lb_world = NULL;
+static __thread int lb_rank = 0;
+
+
+static int loopback_comm_rank(MPI_Comm comm, int *rank)
+{
+  *rank = lb_rank;
+
+  return MPI_SUCCESS;
+}
+
+
+static int loopback_comm_size(MPI_Comm comm, int *size)
+{
+  *size = lb_world->nranks;
+
+  return MPI_SUCCESS;
+}
+
+
+static int loopback_barrier(MPI_Comm comm)
+{
+  pthread_barrier_wait(&lb_world->barrier);
+
+  return MPI_SUCCESS;
+}
+
+
+static int loopback_send(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+  loopback_box *box = &lb_world->boxes[dest], *own = &lb_world->boxes[lb_rank];
+  loopback_msg *msg;
+  int type_size;
+  double now;
+
+  MPI_Type_size(datatype, &type_size);
+
+  msg = malloc(sizeof(loopback_msg) + (long) count * type_size);
+  msg->source = lb_rank;
+  msg->tag = tag;
+  msg->bytes = (long) count * type_size;
+  msg->next = NULL;
+  memcpy(msg->data, buf, msg->bytes);
+
+  /* the messages of a sender are transferred one after another */
+  now = MPI_Wtime();
+  if (own->link_free < now) own->link_free = now;
+  if (lb_world->bandwidth > 0) own->link_free += msg->bytes / lb_world->bandwidth;
+  msg->ready = own->link_free + lb_world->latency;
+
+  pthread_mutex_lock(&box->lock);
+  if (box->last) box->last->next = msg; else box->first = msg;
+  box->last = msg;
+  pthread_cond_broadcast(&box->cond);
+  pthread_mutex_unlock(&box->lock);
+
+  return MPI_SUCCESS;
+}
+
+
+static loopback_msg *loopback_match(loopback_box *box, int source, int tag, int remove)
+{
+  loopback_msg *msg, *prev = NULL;
+
+  for (msg = box->first; msg; prev = msg, msg = msg->next)
+  {
+    if ((source == MPI_ANY_SOURCE || msg->source == source) && (tag == MPI_ANY_TAG || msg->tag == tag)) break;
+  }
+
+  if (msg && remove)
+  {
+    if (prev) prev->next = msg->next; else box->first = msg->next;
+    if (box->last == msg) box->last = prev;
+  }
+
+  return msg;
+}
+
+
+static int loopback_deliver(loopback_msg *msg, void *buf, int count, MPI_Datatype datatype, MPI_Status *status)
+{
+  struct timespec ts;
+  int type_size, ret = MPI_SUCCESS;
+  long bytes;
+  double wait;
+
+  /* sleep most of the remaining time, then yield until the message is ready */
+  wait = msg->ready - MPI_Wtime();
+  if (wait > 1.0e-4)
+  {
+    wait -= 5.0e-5;
+    ts.tv_sec = (time_t) wait;
+    ts.tv_nsec = (long) ((wait - ts.tv_sec) * 1.0e9);
+    nanosleep(&ts, NULL);
+  }
+  while (MPI_Wtime() < msg->ready) sched_yield();
+
+  MPI_Type_size(datatype, &type_size);
+
+  /* only the part that fits into the receive buffer is copied (and counted in the status) */
+  bytes = msg->bytes;
+  if (bytes > (long) count * type_size)
+  {
+    bytes = (long) count * type_size;
+    ret = MPI_ERR_TRUNCATE;
+    __atomic_store_n(&lb_world->error, ret, __ATOMIC_RELAXED);
+  }
+
+  memcpy(buf, msg->data, bytes);
+
+  if (status != MPI_STATUS_IGNORE)
+  {
+    status->MPI_SOURCE = msg->source;
+    status->MPI_TAG = msg->tag;
+    status->MPI_ERROR = ret;
+    MPI_Status_set_elements(status, MPI_BYTE, (int) bytes);
+  }
+
+  free(msg);
+
+  return ret;
+}
+
+
+static int loopback_recv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status *status)
+{
+  loopback_box *box = &lb_world->boxes[lb_rank];
+  loopback_msg *msg;
+
+  pthread_mutex_lock(&box->lock);
+  while (!(msg = loopback_match(box, source, tag, 1))) pthread_cond_wait(&box->cond, &box->lock);
+  pthread_mutex_unlock(&box->lock);
+
+  return loopback_deliver(msg, buf, count, datatype, status);
+}
+
+
+static int loopback_sendrecv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag,
+                             void *recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status *status)
+{
+  loopback_send(sendbuf, sendcount, sendtype, dest, sendtag, comm);
+
+  return loopback_recv(recvbuf, recvcount, recvtype, source, recvtag, comm, status);
+}
+
+
+static int loopback_isend(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, transport_request *request)
+{
+  request->mpi = MPI_REQUEST_NULL;
+  request->active = 0;
+
+  return loopback_send(buf, count, datatype, dest, tag, comm);
+}
+
+
+static int loopback_irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, transport_request *request)
+{
+  request->mpi = MPI_REQUEST_NULL;
+  request->active = 1;
+  request->buf = buf;
+  request->count = count;
+  request->datatype = datatype;
+  request->source = source;
+  request->tag = tag;
+
+  return MPI_SUCCESS;
+}
+
+
+static int loopback_waitany(int count, transport_request *requests, int *index, MPI_Status *status)
+{
+  loopback_box *box = &lb_world->boxes[lb_rank];
+  loopback_msg *msg = NULL;
+  int i, active = 0;
+
+  /* sends are complete, only pending receives are waited for */
+  for (i = 0; i < count; i++) if (requests[i].active) active = 1;
+
+  *index = MPI_UNDEFINED;
+
+  if (!active) return MPI_SUCCESS;
+
+  /* first pending receive (in the order of the requests) with a matching message */
+  pthread_mutex_lock(&box->lock);
+  while (1)
+  {
+    for (i = 0; i < count; i++)
+    {
+      if (!requests[i].active) continue;
+      if ((msg = loopback_match(box, requests[i].source, requests[i].tag, 1))) break;
+    }
+    if (msg) break;
+
+    pthread_cond_wait(&box->cond, &box->lock);
+  }
+  pthread_mutex_unlock(&box->lock);
+
+  requests[i].active = 0;
+  *index = i;
+
+  return loopback_deliver(msg, requests[i].buf, requests[i].count, requests[i].datatype, status);
+}
+
+
+/* linear reduction to the root (with the reduction operations of reduce_op_2) */
+static int loopback_reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int type_size, i, ret = MPI_SUCCESS, r;
+  char *tbuf;
+
+  if (lb_rank != root) return loopback_send(sendbuf, count, datatype, root, TRANSPORT_LOOPBACK_TAG, comm);
+
+  MPI_Type_size(datatype, &type_size);
+
+  memcpy(recvbuf, sendbuf, (long) count * type_size);
+
+  tbuf = malloc((long) count * type_size);
+
+  for (i = 0; i < lb_world->nranks; i++)
+  {
+    if (i == root) continue;
+
+    r = loopback_recv(tbuf, count, datatype, i, TRANSPORT_LOOPBACK_TAG, comm, MPI_STATUS_IGNORE);
+    if (r != MPI_SUCCESS) ret = r;
+    reduce_op_2(count, 0, datatype, op, tbuf, recvbuf);
+  }
+
+  free(tbuf);
+
+  return ret;
+}
+
+
+static int loopback_allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+  int i, ret;
+
+  ret = loopback_reduce(sendbuf, recvbuf, count, datatype, op, 0, comm);
+
+  if (lb_rank != 0) return loopback_recv(recvbuf, count, datatype, 0, TRANSPORT_LOOPBACK_TAG, comm, MPI_STATUS_IGNORE);
+
+  for (i = 1; i < lb_world->nranks; i++) loopback_send(recvbuf, count, datatype, i, TRANSPORT_LOOPBACK_TAG, comm);
+
+  return ret;
+}
+
+
+const reduce_transport transport_loopback =
+{
+  "loopback",
+  loopback_comm_rank,
+  loopback_comm_size,
+  loopback_barrier,
+  loopback_send,
+  loopback_recv,
+  loopback_sendrecv,
+  loopback_isend,
+  loopback_irecv,
+  loopback_waitany,
+  loopback_reduce,
+  loopback_allreduce,
+};
+
+
+static void *loopback_thread_main(void *arg)
+{
+  loopback_thread *lt = arg;
+
+  lb_world = lt->world;
+  lb_rank = lt->rank;
+  transport_current = &transport_loopback;
+
+  lb_world->fn(lb_rank, lb_world->nranks, lb_world->arg);
+
+  return NULL;
+}
+
+
+int ZMPI_Transport_loopback_run(int nranks, double latency, double bandwidth, ZMPI_Transport_loopback_fn fn, void *arg)
+{
+  loopback_world world;
+  loopback_thread *threads;
+  pthread_t *tids;
+  loopback_msg *msg;
+  int i;
+
+  if (nranks <= 0) return MPI_ERR_ARG;
+
+  world.nranks = nranks;
+  world.latency = latency;
+  world.bandwidth = bandwidth;
+  world.fn = fn;
+  world.arg = arg;
+  world.error = MPI_SUCCESS;
+
+  world.boxes = malloc(nranks * sizeof(loopback_box));
+  pthread_barrier_init(&world.barrier, NULL, nranks);
+
+  for (i = 0; i < nranks; i++)
+  {
+    pthread_mutex_init(&world.boxes[i].lock, NULL);
+    pthread_cond_init(&world.boxes[i].cond, NULL);
+    world.boxes[i].first = world.boxes[i].last = NULL;
+    world.boxes[i].link_free = 0.0;
+  }
+
+  threads = malloc(nranks * sizeof(loopback_thread));
+  tids = malloc(nranks * sizeof(pthread_t));
+
+  for (i = 0; i < nranks; i++)
+  {
+    threads[i].world = &world;
+    threads[i].rank = i;
+    pthread_create(&tids[i], NULL, loopback_thread_main, &threads[i]);
+  }
+
+  for (i = 0; i < nranks; i++) pthread_join(tids[i], NULL);
+
+  for (i = 0; i < nranks; i++)
+  {
+    /* messages that were never received */
+    while ((msg = world.boxes[i].first))
+    {
+      world.boxes[i].first = msg->next;
+      free(msg);
+    }
+
+    pthread_mutex_destroy(&world.boxes[i].lock);
+    pthread_cond_destroy(&world.boxes[i].cond);
+  }
+
+  pthread_barrier_destroy(&world.barrier);
+
+  free(tids);
+  free(threads);
+  free(world.boxes);
+
+  return world.error;
+}
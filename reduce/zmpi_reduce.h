@@ -24,7 +24,15 @@
 
 #include "mpi_reduce_rabenseifner.h"
 #include "mpi_reduce_pipe.h"
+#include "mpi_ireduce_pipe.h"
+#include "mpi_reduce_plan.h"
+#include "mpi_reduce_select.h"
 #include "mpi_reduce_gather.h"
+#include "mpi_reduce_tree.h"
+#include "mpi_reduce_hier.h"
+#include "mpi_allreduce.h"
+#include "reduce_pool.h"
+#include "reduce_transport.h"
 
 
 #endif // __ZMPI_REDUCE_H__
@@ -0,0 +1,382 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "dblv.h"
+#include "tests.h"
+
+
+#define BENCH_REPEATS  20
+
+static const double bench_densities[] = { 0.001, 0.01, 0.1, 0.5, 1.0 };
+#define BENCH_NDENSITIES  (int) (sizeof(bench_densities) / sizeof(bench_densities[0]))
+
+
+static void bench_sparse_vector(int count, double non_zeros, double *v)
+{
+  int nz = 0;
+
+  if (non_zeros < 1.0)
+  {
+    dblv_write_zeros(count, v);
+    dblv_write_random_random_next(count, v, (int) (count * non_zeros), 0.0, &nz);
+
+  } else dblv_write_random(count, v);
+}
+
+
+void bench_rle_compress(int count, int comm_rank)
+{
+  int i, j, level, max_level, nout, nout_ref, nread, nwrite, step;
+  double *vin, *vout, *vout_ref, t, t_ref;
+
+  if (comm_rank != 0) return;
+
+  vin = malloc(count * sizeof(double));
+  vout = malloc(count * sizeof(double));
+  vout_ref = malloc(count * sizeof(double));
+
+  dblv_simd_set_level(-1);
+  max_level = dblv_simd_level();
+
+  printf("bench_rle_compress: count: %d, repeats: %d, max. simd level: %s\n", count, BENCH_REPEATS, dblv_simd_name(max_level));
+  printf("  %-8s  %-8s  %10s  %12s  %8s  %s\n", "density", "kernel", "nout", "MB/s", "speedup", "verify");
+
+  for (i = 0; i < BENCH_NDENSITIES; i++)
+  {
+    srand(1);
+    bench_sparse_vector(count, bench_densities[i], vin);
+
+    t_ref = 0.0;
+
+    for (level = DBLV_SIMD_NONE; level <= max_level; level++)
+    {
+      dblv_simd_set_level(level);
+
+      t = MPI_Wtime();
+      for (j = 0; j < BENCH_REPEATS; j++) dblv_rle_zero_compress2(count, vin, &nout, vout);
+      t = (MPI_Wtime() - t) / BENCH_REPEATS;
+
+      if (level == DBLV_SIMD_NONE)
+      {
+        nout_ref = nout;
+        memcpy(vout_ref, vout, nout * sizeof(double));
+        t_ref = t;
+      }
+
+      /* verify the unbounded result and the bounded variant in small output steps */
+      int ok = (nout == nout_ref && memcmp(vout, vout_ref, nout * sizeof(double)) == 0);
+
+      step = 1000;
+      nout = 0;
+      for (j = 0; j < count && ok; j += nread)
+      {
+        dblv_rle_zero_compress3(count - j, vin + j, step, vout + nout, &nread, &nwrite);
+        nout += nwrite;
+      }
+      ok = ok && (nout == nout_ref && memcmp(vout, vout_ref, nout * sizeof(double)) == 0);
+
+      printf("  %-8.3f  %-8s  %10d  %12.2f  %8.2f  %s\n", bench_densities[i], dblv_simd_name(level), nout_ref, count * sizeof(double) / t * 1e-6, t_ref / t, (ok)?"ok":"FAILED");
+    }
+  }
+
+  dblv_simd_set_level(-1);
+
+  free(vin);
+  free(vout);
+  free(vout_ref);
+}
+
+
+#define BENCH_ADD_KERNELS  7
+#define BENCH_ADD_PACKET   4096
+
+static const char *bench_add_names[BENCH_ADD_KERNELS] = { "cf_uc_add2_cb", "cf_uc_add2_ub", "uc_cf_add2_uc", "cf_uc_add3_cf", "cf_uc_add3_uc", "cf_cf_add2_cf", "cf_cf_add3_cf" };
+
+/* kernels with both operands compressed */
+#define BENCH_ADD_CF_CF(k)  ((k) >= 5)
+
+
+/* run kernel k once, result is stored in res/nres, returns the kernel time */
+static double bench_rle_add_run(int k, int count, double *ca, int nca, double *b, double *cb, int ncb, double *work, double *res, int *nres)
+{
+  int nout, r0, r1, w, i0, i1;
+  double *vout, next, next1, t = 0.0;
+
+  switch (k)
+  {
+    case 0:
+    case 1:
+      memcpy(work, ca, nca * sizeof(double));
+      nout = count;
+      t = MPI_Wtime();
+      if (k == 0) dblv_rle_zero_cf_uc_add2_cb(nca, work, count, b, &nout, &vout);
+      else dblv_rle_zero_cf_uc_add2_ub(nca, work, count, b, &nout, &vout);
+      t = MPI_Wtime() - t;
+      break;
+    case 2:
+      memcpy(work, b, count * sizeof(double));
+      nout = count;
+      t = MPI_Wtime();
+      dblv_rle_zero_uc_cf_add2_uc(count, work, nca, ca, &nout, &vout);
+      t = MPI_Wtime() - t;
+      break;
+    case 3:
+    case 4:
+      /* bounded output packets exercise the run carry */
+      next = 0.0;
+      i0 = i1 = nout = 0;
+      vout = work;
+      t = MPI_Wtime();
+      while (i1 < count)
+      {
+        if (k == 3) dblv_rle_zero_cf_uc_add3_cf(nca - i0, ca + i0, count - i1, b + i1, BENCH_ADD_PACKET, work + nout, &r0, &r1, &w, &next);
+        else dblv_rle_zero_cf_uc_add3_uc(nca - i0, ca + i0, count - i1, b + i1, BENCH_ADD_PACKET, work + nout, &r0, &r1, &w, &next);
+        i0 += r0; i1 += r1; nout += w;
+      }
+      t = MPI_Wtime() - t;
+      break;
+    case 5:
+      vout = work;
+      t = MPI_Wtime();
+      dblv_rle_zero_cf_cf_add2_cf(nca, ca, ncb, cb, &nout, vout);
+      t = MPI_Wtime() - t;
+      break;
+    case 6:
+      /* bounded output packets exercise the run carries of both operands */
+      next = next1 = 0.0;
+      i0 = i1 = nout = 0;
+      vout = work;
+      t = MPI_Wtime();
+      while (i0 < nca || i1 < ncb || next != 0 || next1 != 0)
+      {
+        dblv_rle_zero_cf_cf_add3_cf(nca - i0, ca + i0, ncb - i1, cb + i1, BENCH_ADD_PACKET, work + nout, &r0, &r1, &w, &next, &next1);
+        i0 += r0; i1 += r1; nout += w;
+      }
+      t = MPI_Wtime() - t;
+      break;
+  }
+
+  memcpy(res, vout, nout * sizeof(double));
+  *nres = nout;
+
+  return t;
+}
+
+
+void bench_rle_add(int count, int comm_rank)
+{
+  int i, j, k, level, max_level, nca, ncb, nres, nres_ref;
+  double *a, *b, *ca, *cb, *work, *res, *res_ref, t, t_ref;
+
+  if (comm_rank != 0) return;
+
+  a = malloc(count * sizeof(double));
+  b = malloc(count * sizeof(double));
+  ca = malloc(count * sizeof(double));
+  cb = malloc(count * sizeof(double));
+  work = malloc(count * sizeof(double));
+  res = malloc(count * sizeof(double));
+  res_ref = malloc(count * sizeof(double));
+
+  dblv_simd_set_level(-1);
+  max_level = dblv_simd_level();
+
+  printf("bench_rle_add: count: %d, repeats: %d, max. simd level: %s\n", count, BENCH_REPEATS, dblv_simd_name(max_level));
+  printf("  %-8s  %-14s  %-8s  %10s  %12s  %8s  %s\n", "density", "kernel", "simd", "nout", "MB/s", "speedup", "verify");
+
+  for (i = 0; i < BENCH_NDENSITIES; i++)
+  {
+    srand(1);
+    bench_sparse_vector(count, bench_densities[i], a);
+    bench_sparse_vector(count, bench_densities[i], b);
+
+    dblv_simd_set_level(DBLV_SIMD_NONE);
+    dblv_rle_zero_compress2(count, a, &nca, ca);
+    dblv_rle_zero_compress2(count, b, &ncb, cb);
+
+    for (k = 0; k < BENCH_ADD_KERNELS; k++)
+    {
+      t_ref = 0.0;
+      nres_ref = 0;
+
+      for (level = DBLV_SIMD_NONE; level <= max_level; level++)
+      {
+        dblv_simd_set_level(level);
+
+        t = 0.0;
+        for (j = 0; j < BENCH_REPEATS; j++) t += bench_rle_add_run(k, count, ca, nca, b, cb, ncb, work, res, &nres);
+        t /= BENCH_REPEATS;
+
+        if (level == DBLV_SIMD_NONE)
+        {
+          memcpy(res_ref, res, nres * sizeof(double));
+          nres_ref = nres;
+          t_ref = t;
+        }
+
+        int ok = (nres == nres_ref && memcmp(res, res_ref, nres * sizeof(double)) == 0);
+
+        /* results of both operands compressed are compared uncompressed with a + b */
+        if (BENCH_ADD_CF_CF(k) && ok)
+        {
+          dblv_rle_zero_uncompress2(nres, res, &nres, work);
+          for (j = 0; j < count && ok; j++) ok = (work[j] == a[j] + b[j]);
+          ok = ok && (nres == count);
+          nres = nres_ref;
+        }
+
+        printf("  %-8.3f  %-14s  %-8s  %10d  %12.2f  %8.2f  %s\n", bench_densities[i], bench_add_names[k], dblv_simd_name(level), nres, count * sizeof(double) / t * 1e-6, t_ref / t, (ok)?"ok":"FAILED");
+      }
+    }
+  }
+
+  dblv_simd_set_level(-1);
+
+  free(a);
+  free(b);
+  free(ca);
+  free(cb);
+  free(work);
+  free(res);
+  free(res_ref);
+}
+
+
+#define BENCH_COO_FORMATS  3
+
+static const char *bench_coo_names[BENCH_COO_FORMATS] = { "rle", "coo_idx32", "coo_varint" };
+
+
+/* compress a with format f, add the result to the uncompressed b, returns the compressed size in bytes */
+static int bench_coo_run(int f, int count, double *a, double *b, void *ca, double *res, double *tc, double *ta)
+{
+  const dblv_rle_ops *rle_ops = dblv_rle_zero_ops(DBLV_RLE_DOUBLE, DBLV_RLE_SUM);
+  const dblv_coo_ops *coo_ops = dblv_coo_get_ops(DBLV_RLE_DOUBLE, DBLV_RLE_SUM);
+  int nout, nres = count;
+  double t;
+
+  t = MPI_Wtime();
+  if (f == 0)
+  {
+    rle_ops->compress(count, a, &nout, ca);
+    nout *= sizeof(double);
+
+  } else
+  {
+    nout = DBLV_COO_MAX_SIZE(count, sizeof(double));
+    coo_ops->compress(count, a, (f == 1)?DBLV_COO_IDX32:DBLV_COO_VARINT, &nout, ca);
+  }
+  *tc += MPI_Wtime() - t;
+
+  memcpy(res, b, count * sizeof(double));
+
+  t = MPI_Wtime();
+  if (f == 0) rle_ops->uc_cf_add2_uc(count, res, nout / sizeof(double), ca, &nres, NULL);
+  else coo_ops->co_uc_add2_uc(nout, ca, count, res, NULL, res);
+  *ta += MPI_Wtime() - t;
+
+  return nout;
+}
+
+
+void bench_coo(int count, int comm_rank)
+{
+  const dblv_rle_ops *rle_ops = dblv_rle_zero_ops(DBLV_RLE_DOUBLE, DBLV_RLE_SUM);
+  const dblv_coo_ops *coo_ops = dblv_coo_get_ops(DBLV_RLE_DOUBLE, DBLV_RLE_SUM);
+  const char *merge_names[3] = { "co_uc_add2_co", "co_co_add2_co", "co_cf_add2_co" };
+  int i, j, f, nout, nca, ncb, nrb, ok;
+  double *a, *b, *ref, *res, *rb, t, tc, ta;
+  void *ca, *cb, *cr;
+
+  if (comm_rank != 0) return;
+
+  a = malloc(count * sizeof(double));
+  b = malloc(count * sizeof(double));
+  ref = malloc(count * sizeof(double));
+  res = malloc(count * sizeof(double));
+  rb = malloc(count * sizeof(double));
+  ca = malloc(DBLV_COO_MAX_SIZE(count, sizeof(double)));
+  cb = malloc(DBLV_COO_MAX_SIZE(count, sizeof(double)));
+  cr = malloc(DBLV_COO_MAX_SIZE(count, sizeof(double)));
+
+  printf("bench_coo: count: %d, repeats: %d\n", count, BENCH_REPEATS);
+  printf("  %-8s  %-14s  %12s  %8s  %12s  %12s  %s\n", "density", "format", "bytes", "ratio", "compr. MB/s", "add MB/s", "verify");
+
+  for (i = 0; i < BENCH_NDENSITIES; i++)
+  {
+    srand(1);
+    bench_sparse_vector(count, bench_densities[i], a);
+    bench_sparse_vector(count, bench_densities[i], b);
+
+    for (j = 0; j < count; j++) ref[j] = a[j] + b[j];
+
+    /* size of the compressed vector, speed of compression and of the addition to an uncompressed vector */
+    for (f = 0; f < BENCH_COO_FORMATS; f++)
+    {
+      tc = ta = 0.0;
+      for (j = 0; j < BENCH_REPEATS; j++) nout = bench_coo_run(f, count, a, b, ca, res, &tc, &ta);
+
+      ok = dblv_equal(count, res, ref);
+
+      printf("  %-8.3f  %-14s  %12d  %8.4f  %12.2f  %12.2f  %s\n", bench_densities[i], bench_coo_names[f], nout, (double) nout / (count * sizeof(double)),
+        count * sizeof(double) / tc * BENCH_REPEATS * 1e-6, count * sizeof(double) / ta * BENCH_REPEATS * 1e-6, (ok)?"ok":"FAILED");
+    }
+
+    /* merges with an index-value result: with b uncompressed, index-value and zero-RLE encoded */
+    nca = ncb = DBLV_COO_MAX_SIZE(count, sizeof(double));
+    coo_ops->compress(count, a, DBLV_COO_VARINT, &nca, ca);
+    coo_ops->compress(count, b, DBLV_COO_VARINT, &ncb, cb);
+    rle_ops->compress(count, b, &nrb, rb);
+
+    for (f = 0; f < 3; f++)
+    {
+      t = MPI_Wtime();
+      for (j = 0; j < BENCH_REPEATS; j++)
+      {
+        nout = DBLV_COO_MAX_SIZE(count, sizeof(double));
+        if (f == 0) coo_ops->co_uc_add2_co(nca, ca, count, b, DBLV_COO_VARINT, &nout, cr);
+        else if (f == 1) coo_ops->co_co_add2_co(nca, ca, ncb, cb, DBLV_COO_VARINT, &nout, cr);
+        else coo_ops->co_cf_add2_co(nca, ca, nrb, rb, DBLV_COO_VARINT, &nout, cr);
+      }
+      t = (MPI_Wtime() - t) / BENCH_REPEATS;
+
+      coo_ops->uncompress(nout, cr, NULL, res);
+      ok = dblv_equal(count, res, ref);
+
+      printf("  %-8.3f  %-14s  %12d  %8.4f  %12s  %12.2f  %s\n", bench_densities[i], merge_names[f], nout, (double) nout / (count * sizeof(double)),
+        "-", count * sizeof(double) / t * 1e-6, (ok)?"ok":"FAILED");
+    }
+  }
+
+  free(a);
+  free(b);
+  free(ref);
+  free(res);
+  free(rb);
+  free(ca);
+  free(cb);
+  free(cr);
+}
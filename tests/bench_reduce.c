@@ -0,0 +1,1414 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <mpi.h>
+
+#include "zmpi_reduce.h"
+#include "reduce_op.h"
+#include "tests.h"
+
+
+#define BENCH_REDUCE_REPEATS  5
+
+typedef struct
+{
+  const char *name;
+  MPI_Reduce_t mpi_reduce;
+
+} bench_reduce_algorithm;
+
+static const bench_reduce_algorithm bench_reduce_algorithms[] =
+{
+  { "MPI_Reduce", MPI_Reduce },
+  { "MPI_Reduce_rabenseifner", MPI_Reduce_rabenseifner },
+  { "MPI_Reduce_rabenseifner_rle", MPI_Reduce_rabenseifner_rle },
+  { "MPI_Reduce_pipe_sendrecv", MPI_Reduce_pipe_sendrecv },
+  { "MPI_Reduce_pipe_sendrecv_rle", MPI_Reduce_pipe_sendrecv_rle },
+  { "MPI_Reduce_pipe_stream", MPI_Reduce_pipe_stream },
+  { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle },
+  { "MPI_Reduce_pipe_stream_adaptive", MPI_Reduce_pipe_stream_adaptive },
+  { "MPI_Reduce_pipe_coo", MPI_Reduce_pipe_coo },
+  { "MPI_Reduce_pipe_lanes", MPI_Reduce_pipe_lanes },
+  { "MPI_Reduce_pipe_lanes_rle", MPI_Reduce_pipe_lanes_rle },
+  { "MPI_Reduce_pipe_bidir", MPI_Reduce_pipe_bidir },
+  { "MPI_Reduce_pipe_bidir_rle", MPI_Reduce_pipe_bidir_rle },
+  { "MPI_Reduce_pipe_shm", MPI_Reduce_pipe_shm },
+  { "MPI_Reduce_pipe_shm_rle", MPI_Reduce_pipe_shm_rle },
+  { "MPI_Reduce_hier_pipe_rle", MPI_Reduce_hier_pipe_rle },
+  { "MPI_Reduce_hier_gather_rle", MPI_Reduce_hier_gather_rle },
+  { "MPI_Reduce_hier_rabenseifner_rle", MPI_Reduce_hier_rabenseifner_rle },
+  { "MPI_Reduce_gather", MPI_Reduce_gather },
+  { "MPI_Reduce_gather_rle", MPI_Reduce_gather_rle },
+  { "MPI_Reduce_gather_coo", MPI_Reduce_gather_coo },
+  { "MPI_Reduce_gather_irecv", MPI_Reduce_gather_irecv },
+  { "MPI_Reduce_gather_irecv_rle", MPI_Reduce_gather_irecv_rle },
+  { "MPI_Reduce_gather_packets", MPI_Reduce_gather_packets },
+  { "MPI_Reduce_gather_packets_rle", MPI_Reduce_gather_packets_rle },
+  { "MPI_Reduce_tree", MPI_Reduce_tree },
+  { "MPI_Reduce_tree_rle", MPI_Reduce_tree_rle },
+  { "MPI_Reduce_tree_rle_3ary_packets", test_MPI_Reduce_tree_rle_3ary_packets },
+  { "ZMPI_Ireduce_pipe_sendrecv_rle", test_ZMPI_Ireduce_pipe_sendrecv_rle },
+  { "ZMPI_Ireduce_pipe_stream_rle", test_ZMPI_Ireduce_pipe_stream_rle },
+  { "ZMPI_Reduce_plan_gather_rle", test_ZMPI_Reduce_plan_gather_rle },
+};
+#define BENCH_REDUCE_NALGORITHMS  (int) (sizeof(bench_reduce_algorithms) / sizeof(bench_reduce_algorithms[0]))
+
+
+/* sparse vectors with small integer values, so that all reduction orders give exact results for every type */
+#define BENCH_REDUCE_FILL(type, count, non_zeros, buf)  do { \
+  type *v_ = (type *) (buf); \
+  int i_, r_; \
+  for (i_ = 0; i_ < count; i_++) \
+  { \
+    if (rand() >= non_zeros * RAND_MAX) { v_[i_] = 0; continue; } \
+    r_ = rand() % 2001 - 1000; \
+    v_[i_] = (r_ != 0)?r_:1; \
+  } \
+} while (0)
+
+#define BENCH_REDUCE_EQUAL(type, count, buf0, buf1, equal)  do { \
+  const type *v0_ = (const type *) (buf0), *v1_ = (const type *) (buf1); \
+  int i_; \
+  for (i_ = 0; i_ < count; i_++) if (v0_[i_] != v1_[i_]) break; \
+  equal = (i_ >= count); \
+} while (0)
+
+
+static void bench_reduce_fill(MPI_Datatype datatype, int count, double non_zeros, void *buf)
+{
+  if (datatype == MPI_DOUBLE) BENCH_REDUCE_FILL(double, count, non_zeros, buf);
+  else if (datatype == MPI_FLOAT) BENCH_REDUCE_FILL(float, count, non_zeros, buf);
+  else if (datatype == MPI_INT) BENCH_REDUCE_FILL(int, count, non_zeros, buf);
+  else if (datatype == MPI_LONG) BENCH_REDUCE_FILL(long, count, non_zeros, buf);
+}
+
+
+static int bench_reduce_equal(MPI_Datatype datatype, int count, const void *buf0, const void *buf1)
+{
+  int equal = 0;
+
+  if (datatype == MPI_DOUBLE) BENCH_REDUCE_EQUAL(double, count, buf0, buf1, equal);
+  else if (datatype == MPI_FLOAT) BENCH_REDUCE_EQUAL(float, count, buf0, buf1, equal);
+  else if (datatype == MPI_INT) BENCH_REDUCE_EQUAL(int, count, buf0, buf1, equal);
+  else if (datatype == MPI_LONG) BENCH_REDUCE_EQUAL(long, count, buf0, buf1, equal);
+
+  return equal;
+}
+
+
+void bench_reduce_types(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const struct { const char *name; MPI_Datatype datatype; } types[] =
+    { { "double", MPI_DOUBLE }, { "float", MPI_FLOAT }, { "int", MPI_INT }, { "long", MPI_LONG } };
+  const struct { const char *name; MPI_Op op; } ops[] =
+    { { "sum", MPI_SUM }, { "max", MPI_MAX }, { "min", MPI_MIN } };
+
+  int i, j, k, l, ret, type_size;
+  double t, t_min;
+  void *sendbuf, *recvbuf, *verify_recvbuf;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == root)
+  {
+    printf("bench_reduce_types: count: %d, non-zeros: %.1f%%, processes: %d, repeats: %d\n", count, 100.0 * non_zeros, comm_size, BENCH_REDUCE_REPEATS);
+    printf("  %-6s  %-3s  %-30s  %10s  %12s  %s\n", "type", "op", "algorithm", "time", "MB/s", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(types) / sizeof(types[0])); i++)
+  {
+    MPI_Type_size(types[i].datatype, &type_size);
+
+    srand(comm_rank + 1);
+    bench_reduce_fill(types[i].datatype, count, non_zeros, sendbuf);
+
+    for (j = 0; j < (int) (sizeof(ops) / sizeof(ops[0])); j++)
+    {
+      MPI_Reduce(sendbuf, verify_recvbuf, count, types[i].datatype, ops[j].op, root, comm);
+
+      for (k = 0; k < BENCH_REDUCE_NALGORITHMS; k++)
+      {
+        t_min = 0.0;
+        ret = MPI_SUCCESS;
+
+        for (l = 0; l < BENCH_REDUCE_REPEATS; l++)
+        {
+          memset(recvbuf, 0, count * type_size);
+
+          MPI_Barrier(comm);
+          t = MPI_Wtime();
+          if (bench_reduce_algorithms[k].mpi_reduce(sendbuf, recvbuf, count, types[i].datatype, ops[j].op, root, comm) != MPI_SUCCESS) ret = !MPI_SUCCESS;
+          MPI_Barrier(comm);
+          t = MPI_Wtime() - t;
+
+          if (l == 0 || t < t_min) t_min = t;
+        }
+
+        if (comm_rank == root)
+        {
+          printf("  %-6s  %-3s  %-30s  %10.6f  %12.2f  %s\n", types[i].name, ops[j].name, bench_reduce_algorithms[k].name, t_min, (double) count * type_size / t_min * 1e-6,
+            (ret != MPI_SUCCESS)?"failed":(bench_reduce_equal(types[i].datatype, count, recvbuf, verify_recvbuf)?"ok":"verification failed"));
+        }
+      }
+    }
+  }
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+typedef struct
+{
+  int count, offset;
+  const double *in;
+  double *out;
+
+} bench_pool_task;
+
+
+static void *bench_pool_create_join_task(void *arg)
+{
+  bench_pool_task *task = arg;
+
+  reduce_op_2_serial(task->count, task->offset, MPI_DOUBLE, MPI_SUM, task->in, task->out);
+
+  return NULL;
+}
+
+
+/* the former static_threaded_reduce_op_2: create and join the worker threads on every call */
+static void bench_pool_create_join(int nthreads, int count, const double *in, double *out)
+{
+  int i;
+  pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+  bench_pool_task *tasks = malloc(nthreads * sizeof(bench_pool_task));
+
+  for (i = 0; i < nthreads; i++)
+  {
+    tasks[i].offset = (int) (((long) i * count) / nthreads);
+    tasks[i].count = (int) (((long) (i + 1) * count) / nthreads) - tasks[i].offset;
+    tasks[i].in = in;
+    tasks[i].out = out;
+  }
+
+  for (i = 1; i < nthreads; i++) pthread_create(&tids[i], NULL, bench_pool_create_join_task, &tasks[i]);
+
+  bench_pool_create_join_task(&tasks[0]);
+
+  for (i = 1; i < nthreads; i++) pthread_join(tids[i], NULL);
+
+  free(tids);
+  free(tasks);
+}
+
+
+void bench_reduce_pool(int count, int comm_rank)
+{
+  const int counts[] = { 0, 1024, 16 * 1024, 128 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+
+  int i, j, n, repeats, nthreads;
+  double *in, *out, *out_ref, t_serial, t_create, t_pool;
+
+  if (comm_rank != 0) return;
+
+  nthreads = reduce_pool_get_threads();
+
+  n = counts[sizeof(counts) / sizeof(counts[0]) - 1];
+  if (n < count) n = count;
+
+  in = malloc(n * sizeof(double));
+  out = malloc(n * sizeof(double));
+  out_ref = malloc(n * sizeof(double));
+
+  for (i = 0; i < n; i++) in[i] = i;
+
+  printf("bench_reduce_pool: threads: %d\n", nthreads);
+  printf("  %10s  %8s  %14s  %14s  %14s  %s\n", "count", "repeats", "serial [us]", "create [us]", "pool [us]", "verify");
+
+  /* start the pool outside of the measurement */
+  reduce_pool_op_2(0, 0, MPI_DOUBLE, MPI_SUM, in, out);
+
+  for (i = 0; i < (int) (sizeof(counts) / sizeof(counts[0])); i++)
+  {
+    n = counts[i];
+    repeats = (n > 0)?(int) (64 * 1024 * 1024 / n):10000;
+    if (repeats < 10) repeats = 10;
+    if (repeats > 10000) repeats = 10000;
+
+    memset(out, 0, n * sizeof(double));
+    t_serial = MPI_Wtime();
+    for (j = 0; j < repeats; j++) reduce_op_2_serial(n, 0, MPI_DOUBLE, MPI_SUM, in, out);
+    t_serial = (MPI_Wtime() - t_serial) / repeats;
+    memcpy(out_ref, out, n * sizeof(double));
+
+    memset(out, 0, n * sizeof(double));
+    t_create = MPI_Wtime();
+    for (j = 0; j < repeats; j++) bench_pool_create_join(nthreads, n, in, out);
+    t_create = (MPI_Wtime() - t_create) / repeats;
+
+    memset(out, 0, n * sizeof(double));
+    t_pool = MPI_Wtime();
+    for (j = 0; j < repeats; j++) reduce_pool_op_2(n, 0, MPI_DOUBLE, MPI_SUM, in, out);
+    t_pool = (MPI_Wtime() - t_pool) / repeats;
+
+    printf("  %10d  %8d  %14.3f  %14.3f  %14.3f  %s\n", n, repeats, t_serial * 1e6, t_create * 1e6, t_pool * 1e6, (memcmp(out, out_ref, n * sizeof(double)) == 0)?"ok":"verification failed");
+  }
+
+  reduce_pool_finalize();
+
+  free(in);
+  free(out);
+  free(out_ref);
+}
+
+
+void bench_reduce_threads(int count, int comm_rank)
+{
+  const int repeats = 10;
+
+  int i, j, n, nthreads, max_threads;
+  double *in, *out, *out_ref, t, t_1 = 0.0, tmin, tmax;
+  const char *s;
+
+  threaded_reduce_info tri;
+  threaded_reduce_stats stats;
+
+  if (comm_rank != 0) return;
+
+  s = getenv("ZMPI_REDUCE_THREADS");
+  max_threads = (s)?atoi(s):(int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (max_threads < 1) max_threads = 1;
+
+  n = 16 * count;
+
+  in = malloc(n * sizeof(double));
+  out = malloc(n * sizeof(double));
+  out_ref = malloc(n * sizeof(double));
+
+  for (i = 0; i < n; i++) in[i] = i;
+
+  memset(out_ref, 0, n * sizeof(double));
+  for (j = 0; j < repeats + 1; j++) reduce_op_2_serial(n, 0, MPI_DOUBLE, MPI_SUM, in, out_ref);
+
+  printf("bench_reduce_threads: count: %d, repeats: %d, max. threads: %d\n", n, repeats, max_threads);
+  printf("  %8s  %12s  %10s  %8s  %10s  %s\n", "threads", "time [ms]", "GB/s", "speedup", "imbalance", "verify");
+
+  for (nthreads = 1; ; nthreads = (2 * nthreads < max_threads)?2 * nthreads:max_threads)
+  {
+    memset(out, 0, n * sizeof(double));
+
+    threaded_reduce_init(&tri, nthreads);
+
+    /* warm-up */
+    threaded_reduce_op_2(&tri, n, MPI_DOUBLE, MPI_SUM, in, out);
+
+    memset(&stats, 0, sizeof(stats));
+    threaded_reduce_set_stats(&tri, &stats);
+
+    t = MPI_Wtime();
+    for (j = 0; j < repeats; j++) threaded_reduce_op_2(&tri, n, MPI_DOUBLE, MPI_SUM, in, out);
+    t = (MPI_Wtime() - t) / repeats;
+
+    tmin = tmax = threaded_reduce_get_time(&tri, 0);
+    for (i = 1; i < nthreads; i++)
+    {
+      if (threaded_reduce_get_time(&tri, i) < tmin) tmin = threaded_reduce_get_time(&tri, i);
+      if (threaded_reduce_get_time(&tri, i) > tmax) tmax = threaded_reduce_get_time(&tri, i);
+    }
+
+    threaded_reduce_destroy(&tri);
+
+    if (nthreads == 1) t_1 = t;
+
+    /* two loads and one store per element */
+    printf("  %8d  %12.3f  %10.2f  %8.2f  %10.2f  %s\n", nthreads, t * 1e3, 3.0 * n * sizeof(double) / t * 1e-9, t_1 / t, (tmin > 0)?tmax / tmin:1.0,
+      (memcmp(out, out_ref, n * sizeof(double)) == 0)?"ok":"verification failed");
+
+    for (i = 0; i < REDUCE_NUMA_MAX_NODES; i++)
+    if (stats.node_bytes[i] > 0 && stats.node_time[i] > 0)
+      printf("  %8s  node %d: %.2f MB in %.3f ms, %.2f GB/s\n", "", i, stats.node_bytes[i] * 1e-6, stats.node_time[i] * 1e3, 3.0 * stats.node_bytes[i] / stats.node_time[i] * 1e-9);
+
+    if (nthreads >= max_threads) break;
+  }
+
+  free(in);
+  free(out);
+  free(out_ref);
+}
+
+
+void bench_reduce_plan(int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+  const int counts[] = { 1000, 100000 };
+  const int repeats[] = { 1000, 20 };
+
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; int algorithm; } algorithms[] =
+  {
+    { "pipe_sendrecv_rle", MPI_Reduce_pipe_sendrecv_rle, ZMPI_REDUCE_PLAN_PIPE_SENDRECV_RLE },
+    { "pipe_stream_rle", MPI_Reduce_pipe_stream_rle, ZMPI_REDUCE_PLAN_PIPE_STREAM_RLE },
+    { "gather_rle", MPI_Reduce_gather_rle, ZMPI_REDUCE_PLAN_GATHER_RLE },
+  };
+
+  int i, j, k, equal;
+  double *sendbuf, *recvbuf, *verify_recvbuf, t_call, t_plan;
+
+  ZMPI_Reduce_plan plan;
+
+  if (comm_rank == root)
+  {
+    printf("bench_reduce_plan: processes: %d\n", comm_size);
+    printf("  %-20s  %8s  %8s  %12s  %12s  %s\n", "algorithm", "count", "repeats", "call [us]", "plan [us]", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(counts) / sizeof(counts[0])); i++)
+  {
+    sendbuf = malloc(counts[i] * sizeof(double));
+    recvbuf = malloc(counts[i] * sizeof(double));
+    verify_recvbuf = malloc(counts[i] * sizeof(double));
+
+    srand(comm_rank + 1);
+    bench_reduce_fill(MPI_DOUBLE, counts[i], 0.01, sendbuf);
+
+    MPI_Reduce(sendbuf, verify_recvbuf, counts[i], MPI_DOUBLE, MPI_SUM, root, comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      MPI_Barrier(comm);
+      t_call = MPI_Wtime();
+      for (k = 0; k < repeats[i]; k++) algorithms[j].mpi_reduce(sendbuf, recvbuf, counts[i], MPI_DOUBLE, MPI_SUM, root, comm);
+      t_call = (MPI_Wtime() - t_call) / repeats[i];
+
+      ZMPI_Reduce_init(algorithms[j].algorithm, sendbuf, recvbuf, counts[i], MPI_DOUBLE, MPI_SUM, root, comm, &plan);
+
+      MPI_Barrier(comm);
+      t_plan = MPI_Wtime();
+      for (k = 0; k < repeats[i]; k++)
+      {
+        ZMPI_Reduce_start(plan);
+        ZMPI_Reduce_wait(plan);
+      }
+      t_plan = (MPI_Wtime() - t_plan) / repeats[i];
+
+      ZMPI_Reduce_plan_free(&plan);
+
+      equal = (comm_rank != root || bench_reduce_equal(MPI_DOUBLE, counts[i], recvbuf, verify_recvbuf));
+
+      if (comm_rank == root)
+        printf("  %-20s  %8d  %8d  %12.2f  %12.2f  %s\n", algorithms[j].name, counts[i], repeats[i], t_call * 1e6, t_plan * 1e6, equal?"ok":"verification failed");
+    }
+
+    free(sendbuf);
+    free(recvbuf);
+    free(verify_recvbuf);
+  }
+}
+
+
+static double bench_ireduce_compute_sink;
+
+/* stand-in for independent computation, processed in slices with progress calls in between */
+static void bench_ireduce_compute(int n, double *work, int slices, int progress)
+{
+  int i, j, s;
+  double x = 0.0;
+
+  for (s = 0; s < slices; s++)
+  {
+    for (j = (int) (((long) s * n) / slices); j < (int) (((long) (s + 1) * n) / slices); j++)
+    for (i = 0; i < 64; i++) x += work[(j + i) & 1023] * 1.0000001;
+
+    if (progress) ZMPI_Ireduce_pipe_progress();
+  }
+
+  bench_ireduce_compute_sink += x;
+}
+
+
+void bench_ireduce_overlap(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+  const int slices = 64;
+
+  int i, j, n, provided, equal;
+  double *sendbuf, *recvbuf, *verify_recvbuf, work[1024];
+  double t, t_reduce, t_compute, t_overlap;
+
+  ZMPI_Ireduce_pipe_request request;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  srand(comm_rank + 1);
+  bench_reduce_fill(MPI_DOUBLE, count, non_zeros, sendbuf);
+  for (i = 0; i < 1024; i++) work[i] = i;
+
+  MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+  /* blocking reduction time */
+  MPI_Barrier(comm);
+  t_reduce = MPI_Wtime();
+  for (j = 0; j < BENCH_REDUCE_REPEATS; j++) MPI_Reduce_pipe_stream_rle(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+  t_reduce = (MPI_Wtime() - t_reduce) / BENCH_REDUCE_REPEATS;
+  MPI_Bcast(&t_reduce, 1, MPI_DOUBLE, root, comm);
+
+  /* computation of about the same time */
+  n = 1024;
+  while (1)
+  {
+    t = MPI_Wtime();
+    bench_ireduce_compute(n, work, slices, 0);
+    t = MPI_Wtime() - t;
+    if (t >= t_reduce || n >= (1 << 30)) break;
+    n *= 2;
+  }
+  MPI_Bcast(&n, 1, MPI_INT, root, comm);
+
+  t_compute = MPI_Wtime();
+  bench_ireduce_compute(n, work, slices, 0);
+  t_compute = MPI_Wtime() - t_compute;
+
+  MPI_Query_thread(&provided);
+
+  if (comm_rank == root)
+  {
+    printf("bench_ireduce_overlap: count: %d, non-zeros: %.1f%%, processes: %d, repeats: %d\n", count, 100.0 * non_zeros, comm_size, BENCH_REDUCE_REPEATS);
+    printf("  reduce: %f, compute: %f\n", t_reduce, t_compute);
+    printf("  %-10s  %10s  %8s  %s\n", "progress", "time", "overlap", "verify");
+  }
+
+  for (i = 0; i < 2; i++)
+  {
+    if (i == 1)
+    {
+      if (provided < MPI_THREAD_MULTIPLE) break;
+      ZMPI_Ireduce_pipe_progress_thread(1);
+    }
+
+    MPI_Barrier(comm);
+    t_overlap = MPI_Wtime();
+    for (j = 0; j < BENCH_REDUCE_REPEATS; j++)
+    {
+      memset(recvbuf, 0, count * sizeof(double));
+      ZMPI_Ireduce_pipe_stream_rle(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm, &request);
+      bench_ireduce_compute(n, work, slices, (i == 0));
+      ZMPI_Ireduce_pipe_wait(&request);
+    }
+    t_overlap = (MPI_Wtime() - t_overlap) / BENCH_REDUCE_REPEATS;
+
+    if (i == 1) ZMPI_Ireduce_pipe_progress_thread(0);
+
+    equal = (comm_rank != root || bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf));
+
+    /* fraction of the shorter phase hidden behind the other */
+    if (comm_rank == root)
+      printf("  %-10s  %10f  %7.1f%%  %s\n", (i == 0)?"calls":"thread", t_overlap, 100.0 * (t_reduce + t_compute - t_overlap) / ((t_reduce < t_compute)?t_reduce:t_compute), equal?"ok":"verification failed");
+  }
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* throughput of the gather root (vectors received and reduced per second) over the number of senders */
+void bench_reduce_gather_root(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; } algorithms[] =
+  {
+    { "MPI_Reduce_gather", MPI_Reduce_gather },
+    { "MPI_Reduce_gather_irecv", MPI_Reduce_gather_irecv },
+    { "MPI_Reduce_gather_rle", MPI_Reduce_gather_rle },
+    { "MPI_Reduce_gather_irecv_rle", MPI_Reduce_gather_irecv_rle },
+    { "MPI_Reduce_gather_packets", MPI_Reduce_gather_packets },
+    { "MPI_Reduce_gather_packets_rle", MPI_Reduce_gather_packets_rle },
+  };
+
+  /* the root reduces serially and with the pool threads */
+  const int threads[] = { 1, REDUCE_POOL_THREADS };
+
+  int i, j, k, senders, enabled, nthreads;
+  double t, t_min, *sendbuf, *recvbuf, *verify_recvbuf;
+  MPI_Comm sub_comm;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  enabled = reduce_pool_enabled();
+  nthreads = reduce_pool_get_threads();
+
+  srand(comm_rank + 1);
+  bench_reduce_fill(MPI_DOUBLE, count, non_zeros, sendbuf);
+
+  if (comm_rank == root)
+  {
+    printf("bench_reduce_gather_root: count: %d, non-zeros: %.1f%%, processes: %d, repeats: %d\n", count, 100.0 * non_zeros, comm_size, BENCH_REDUCE_REPEATS);
+    printf("  %8s  %-30s  %8s  %10s  %12s  %s\n", "senders", "algorithm", "threads", "time", "root MB/s", "verify");
+  }
+
+  for (senders = 1; senders < comm_size; senders = (2 * senders < comm_size - 1 || senders == comm_size - 1)?(2 * senders):(comm_size - 1))
+  {
+    MPI_Comm_split(comm, (comm_rank <= senders)?0:MPI_UNDEFINED, comm_rank, &sub_comm);
+
+    if (sub_comm != MPI_COMM_NULL) MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, sub_comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    for (i = 0; i < (int) (sizeof(threads) / sizeof(threads[0])); i++)
+    {
+      reduce_pool_set_threads(threads[i]);
+
+      t_min = 0.0;
+
+      for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+      {
+        MPI_Barrier(comm);
+        t = MPI_Wtime();
+        if (sub_comm != MPI_COMM_NULL) algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, sub_comm);
+        t = MPI_Wtime() - t;
+        MPI_Barrier(comm);
+
+        if (k == 0 || t < t_min) t_min = t;
+      }
+
+      if (comm_rank == root)
+        printf("  %8d  %-30s  %8d  %10.6f  %12.2f  %s\n", senders, algorithms[j].name, threads[i], t_min, senders * count * sizeof(double) / t_min * 1e-6,
+          bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf)?"ok":"verification failed");
+    }
+
+    if (sub_comm != MPI_COMM_NULL) MPI_Comm_free(&sub_comm);
+  }
+
+  reduce_pool_set_threads((enabled)?nthreads:0);
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* latency of the tree algorithms compared with the pipeline for small to medium counts */
+void bench_reduce_tree(double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const int counts[] = { 100, 1000, 10000, 100000, 1000000 };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; int arity, packet_size; } algorithms[] =
+  {
+    { "MPI_Reduce", MPI_Reduce, 0, 0 },
+    { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle, 0, 0 },
+    { "MPI_Reduce_tree", MPI_Reduce_tree, 0, 0 },
+    { "MPI_Reduce_tree_rle", MPI_Reduce_tree_rle, 0, 0 },
+    { "MPI_Reduce_tree_rle (4-ary)", MPI_Reduce_tree_rle, 4, 0 },
+    { "MPI_Reduce_tree_rle (packets)", MPI_Reduce_tree_rle, 0, 64 * 1024 },
+  };
+
+  int i, j, k, count;
+  double t, t_min, *sendbuf, *recvbuf, *verify_recvbuf;
+  tree_attr ta = default_ta;
+
+  count = counts[sizeof(counts) / sizeof(counts[0]) - 1];
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == root)
+  {
+    printf("bench_reduce_tree: non-zeros: %.1f%%, processes: %d, repeats: %d\n", 100.0 * non_zeros, comm_size, BENCH_REDUCE_REPEATS);
+    printf("  %8s  %-30s  %10s  %12s  %s\n", "count", "algorithm", "time", "MB/s", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(counts) / sizeof(counts[0])); i++)
+  {
+    count = counts[i];
+
+    srand(comm_rank + 1);
+    bench_reduce_fill(MPI_DOUBLE, count, non_zeros, sendbuf);
+
+    MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      default_ta.arity = algorithms[j].arity;
+      default_ta.packet_size = algorithms[j].packet_size;
+
+      t_min = 0.0;
+
+      for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+      {
+        MPI_Barrier(comm);
+        t = MPI_Wtime();
+        algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+        MPI_Barrier(comm);
+        t = MPI_Wtime() - t;
+
+        if (k == 0 || t < t_min) t_min = t;
+      }
+
+      if (comm_rank == root)
+        printf("  %8d  %-30s  %10.6f  %12.2f  %s\n", count, algorithms[j].name, t_min, count * sizeof(double) / t_min * 1e-6,
+          bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf)?"ok":"verification failed");
+    }
+  }
+
+  default_ta = ta;
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+void bench_allreduce_types(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int counts[] = { count, 1000, 13 };
+
+  const struct { const char *name; MPI_Datatype datatype; } types[] =
+    { { "double", MPI_DOUBLE }, { "float", MPI_FLOAT }, { "int", MPI_INT }, { "long", MPI_LONG } };
+  const struct { const char *name; MPI_Op op; } ops[] =
+    { { "sum", MPI_SUM }, { "max", MPI_MAX }, { "min", MPI_MIN } };
+  const struct { const char *name; MPI_Allreduce_t mpi_allreduce; } algorithms[] =
+  {
+    { "MPI_Allreduce", MPI_Allreduce },
+    { "ZMPI_Allreduce_ring", ZMPI_Allreduce_ring },
+    { "ZMPI_Allreduce_ring_rle", ZMPI_Allreduce_ring_rle },
+    { "ZMPI_Allreduce_rabenseifner", ZMPI_Allreduce_rabenseifner },
+    { "ZMPI_Allreduce_rabenseifner_rle", ZMPI_Allreduce_rabenseifner_rle },
+    { "ZMPI_Allreduce_reduce_bcast", ZMPI_Allreduce_reduce_bcast },
+    { "ZMPI_Allreduce_reduce_bcast_rle", ZMPI_Allreduce_reduce_bcast_rle },
+  };
+
+  int c, i, j, k, l, ret, equal, type_size;
+  double t, t_min;
+  void *sendbuf, *recvbuf, *verify_recvbuf;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == 0)
+  {
+    printf("bench_allreduce_types: non-zeros: %.1f%%, processes: %d, repeats: %d\n", 100.0 * non_zeros, comm_size, BENCH_REDUCE_REPEATS);
+    printf("  %-8s  %-6s  %-3s  %-32s  %10s  %12s  %s\n", "count", "type", "op", "algorithm", "time", "MB/s", "verify");
+  }
+
+  for (c = 0; c < (int) (sizeof(counts) / sizeof(counts[0])); c++)
+  for (i = 0; i < (int) (sizeof(types) / sizeof(types[0])); i++)
+  {
+    MPI_Type_size(types[i].datatype, &type_size);
+
+    srand(comm_rank + 1);
+    bench_reduce_fill(types[i].datatype, counts[c], non_zeros, sendbuf);
+
+    for (j = 0; j < (int) (sizeof(ops) / sizeof(ops[0])); j++)
+    {
+      MPI_Allreduce(sendbuf, verify_recvbuf, counts[c], types[i].datatype, ops[j].op, comm);
+
+      for (k = 0; k < (int) (sizeof(algorithms) / sizeof(algorithms[0])); k++)
+      {
+        t_min = 0.0;
+        ret = MPI_SUCCESS;
+
+        for (l = 0; l < BENCH_REDUCE_REPEATS; l++)
+        {
+          memset(recvbuf, 0, counts[c] * type_size);
+
+          MPI_Barrier(comm);
+          t = MPI_Wtime();
+          if (algorithms[k].mpi_allreduce(sendbuf, recvbuf, counts[c], types[i].datatype, ops[j].op, comm) != MPI_SUCCESS) ret = !MPI_SUCCESS;
+          MPI_Barrier(comm);
+          t = MPI_Wtime() - t;
+
+          if (l == 0 || t < t_min) t_min = t;
+        }
+
+        /* the result has to be correct on all processes */
+        equal = bench_reduce_equal(types[i].datatype, counts[c], recvbuf, verify_recvbuf);
+        MPI_Allreduce(MPI_IN_PLACE, &equal, 1, MPI_INT, MPI_MIN, comm);
+
+        if (comm_rank == 0)
+        {
+          printf("  %-8d  %-6s  %-3s  %-32s  %10.6f  %12.2f  %s\n", counts[c], types[i].name, ops[j].name, algorithms[k].name, t_min, (double) counts[c] * type_size / t_min * 1e-6,
+            (ret != MPI_SUCCESS)?"failed":(equal?"ok":"verification failed"));
+        }
+      }
+    }
+  }
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* the given share of the segments is dense, the other segments are sparse (0.1% non-zeros) */
+static void bench_mixed_fill(int count, int segment, double dense_share, double *buf)
+{
+  int i, s, dense, r;
+
+  for (i = 0; i < count; i++)
+  {
+    s = i / segment;
+    dense = ((int) ((s + 1) * dense_share) > (int) (s * dense_share));
+
+    buf[i] = 0.0;
+    if (!dense && rand() >= 0.001 * RAND_MAX) continue;
+
+    r = rand() % 2001 - 1000;
+    buf[i] = (r != 0)?r:1;
+  }
+}
+
+
+void bench_reduce_mixed(int count, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+  const int max_packet = default_pa.packet_size / sizeof(double);
+
+  const struct { const char *name; int segment; double dense_share; } patterns[] =
+  {
+    { "sparse", count, 0.0 },
+    { "dense", count, 1.0 },
+    { "mixed-packets", 2 * max_packet, 0.5 },
+    { "mixed-fine", 1000, 0.5 },
+    { "mostly-dense", max_packet, 0.8 },
+  };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; } algorithms[] =
+  {
+    { "MPI_Reduce_pipe_stream", MPI_Reduce_pipe_stream },
+    { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle },
+    { "MPI_Reduce_pipe_stream_adaptive", MPI_Reduce_pipe_stream_adaptive },
+    { "MPI_Reduce_pipe_coo", MPI_Reduce_pipe_coo },
+  };
+
+  int i, j, k;
+  long sendc, sendc_sum;
+  double t, t_min, *sendbuf, *recvbuf, *verify_recvbuf;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == root)
+  {
+    printf("bench_reduce_mixed: count: %d, packet: %d, processes: %d, repeats: %d\n", count, max_packet, comm_size, BENCH_REDUCE_REPEATS);
+    printf("  %-14s  %-32s  %10s  %12s  %10s  %s\n", "pattern", "algorithm", "time", "MB/s", "sent [%]", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(patterns) / sizeof(patterns[0])); i++)
+  {
+    srand(comm_rank + 1);
+    bench_mixed_fill(count, patterns[i].segment, patterns[i].dense_share, sendbuf);
+
+    MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      t_min = 0.0;
+
+      for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+      {
+        MPI_Barrier(comm);
+        t = MPI_Wtime();
+        algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+        MPI_Barrier(comm);
+        t = MPI_Wtime() - t;
+
+        if (k == 0 || t < t_min) t_min = t;
+      }
+
+      /* elements sent by all processes relative to the uncompressed pipeline */
+      sendc = sendc_global;
+      MPI_Reduce(&sendc, &sendc_sum, 1, MPI_LONG, MPI_SUM, root, comm);
+
+      if (comm_rank == root)
+        printf("  %-14s  %-32s  %10.6f  %12.2f  %10.1f  %s\n", patterns[i].name, algorithms[j].name, t_min, count * sizeof(double) / t_min * 1e-6,
+          100.0 * sendc_sum / ((double) count * (comm_size - 1)), bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf)?"ok":"verification failed");
+    }
+  }
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* tuning mode of ZMPI_Reduce: sweeps all candidate algorithms (and packet sizes) over counts and densities and
+   writes the fastest of every point to the decision table file, the choice of the cost model is shown for comparison */
+void bench_reduce_tune(const char *filename, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const int counts[] = { 1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20 };
+  const double densities[] = { 0.001, 0.01, 0.1, 1.0 };
+  const int packet_sizes[] = { 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+
+#define NCOUNTS     (int) (sizeof(counts) / sizeof(counts[0]))
+#define NDENSITIES  (int) (sizeof(densities) / sizeof(densities[0]))
+#define NPACKETS(a)  ((ZMPI_Reduce_algorithms[a].packets)?(int) (sizeof(packet_sizes) / sizeof(packet_sizes[0])):1)
+
+  int i, j, k, l, m, count, ok;
+  int algorithm[NCOUNTS][NDENSITIES], packet_size[NCOUNTS][NDENSITIES], model_algorithm, model_packet_size;
+  double t, t_min, t_best[NCOUNTS][NDENSITIES], *sendbuf, *recvbuf, *verify_recvbuf;
+  int pa_packet_size = default_pa.packet_size;
+
+  count = counts[NCOUNTS - 1];
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  for (i = 0; i < NCOUNTS; i++)
+  for (j = 0; j < NDENSITIES; j++)
+  {
+    count = counts[i];
+
+    srand(comm_rank + 1);
+    bench_reduce_fill(MPI_DOUBLE, count, densities[j], sendbuf);
+
+    MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+    algorithm[i][j] = -1;
+
+    for (k = 0; k < ZMPI_Reduce_nalgorithms; k++)
+    for (l = 0; l < NPACKETS(k); l++)
+    {
+      default_pa.packet_size = (ZMPI_Reduce_algorithms[k].packets)?packet_sizes[l]:pa_packet_size;
+
+      t_min = 0.0;
+
+      for (m = 0; m < BENCH_REDUCE_REPEATS; m++)
+      {
+        MPI_Barrier(comm);
+        t = MPI_Wtime();
+        ZMPI_Reduce_algorithms[k].reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+        MPI_Barrier(comm);
+        t = MPI_Wtime() - t;
+
+        if (m == 0 || t < t_min) t_min = t;
+      }
+
+      /* all processes have to record the same decision */
+      if (comm_rank == root) ok = bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf);
+      MPI_Bcast(&ok, 1, MPI_INT, root, comm);
+      MPI_Bcast(&t_min, 1, MPI_DOUBLE, root, comm);
+
+      if (!ok)
+      {
+        if (comm_rank == root) printf("bench_reduce_tune: %s: verification failed\n", ZMPI_Reduce_algorithms[k].name);
+        continue;
+      }
+
+      if (algorithm[i][j] < 0 || t_min < t_best[i][j])
+      {
+        algorithm[i][j] = k;
+        packet_size[i][j] = (ZMPI_Reduce_algorithms[k].packets)?packet_sizes[l]:0;
+        t_best[i][j] = t_min;
+      }
+    }
+  }
+
+  default_pa.packet_size = pa_packet_size;
+
+  if (comm_rank == root)
+  {
+    printf("bench_reduce_tune: processes: %d, repeats: %d, table: %s\n", comm_size, BENCH_REDUCE_REPEATS, filename);
+    printf("  %8s  %8s  %-32s  %8s  %10s  %-32s  %8s\n", "count", "density", "tuned", "packet", "time", "model", "packet");
+  }
+
+  /* choices of the cost model without a table */
+  ZMPI_Reduce_table_clear();
+
+  for (i = 0; i < NCOUNTS; i++)
+  for (j = 0; j < NDENSITIES; j++)
+  {
+    model_algorithm = ZMPI_Reduce_select(comm_size, (long) counts[i] * sizeof(double), densities[j], &model_packet_size);
+
+    if (comm_rank == root)
+      printf("  %8d  %8.3f  %-32s  %8d  %10.6f  %-32s  %8d\n", counts[i], densities[j], ZMPI_Reduce_algorithms[algorithm[i][j]].name, packet_size[i][j], t_best[i][j],
+        ZMPI_Reduce_algorithms[model_algorithm].name, (ZMPI_Reduce_algorithms[model_algorithm].packets)?model_packet_size:0);
+  }
+
+  for (i = 0; i < NCOUNTS; i++)
+  for (j = 0; j < NDENSITIES; j++)
+    if (algorithm[i][j] >= 0) ZMPI_Reduce_table_add(comm_size, (long) counts[i] * sizeof(double), densities[j], algorithm[i][j], packet_size[i][j], t_best[i][j]);
+
+  if (comm_rank == root && ZMPI_Reduce_table_save(filename) != MPI_SUCCESS) printf("bench_reduce_tune: writing '%s' failed\n", filename);
+
+#undef NCOUNTS
+#undef NDENSITIES
+#undef NPACKETS
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* convergence of the online packet size tuning: packet size and time of consecutive calls on a new communicator,
+   compared with the fixed packet size of default_pa */
+void bench_pipe_tune(double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const int counts[] = { 10000, 100000, 1000000 };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; } algorithms[] =
+  {
+    { "MPI_Reduce_pipe_sendrecv_rle", MPI_Reduce_pipe_sendrecv_rle },
+    { "MPI_Reduce_pipe_stream", MPI_Reduce_pipe_stream },
+    { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle },
+  };
+  const int ncalls = 10;
+
+  int i, j, k, count, packet_size;
+  double t, t_fixed, *sendbuf, *recvbuf, *verify_recvbuf;
+  MPI_Comm tune_comm;
+
+  count = counts[sizeof(counts) / sizeof(counts[0]) - 1];
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == root)
+  {
+    printf("bench_pipe_tune: non-zeros: %.1f%%, processes: %d, fixed packet size: %d\n", 100.0 * non_zeros, comm_size, default_pa.packet_size);
+    printf("  %8s  %-30s  %6s  %10s  %10s  %10s  %s\n", "count", "algorithm", "call", "packet", "time", "fixed", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(counts) / sizeof(counts[0])); i++)
+  {
+    count = counts[i];
+
+    srand(comm_rank + 1);
+    bench_reduce_fill(MPI_DOUBLE, count, non_zeros, sendbuf);
+
+    MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      MPI_Barrier(comm);
+      t_fixed = MPI_Wtime();
+      algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+      MPI_Barrier(comm);
+      t_fixed = MPI_Wtime() - t_fixed;
+
+      /* a new communicator starts without tuning state */
+      MPI_Comm_dup(comm, &tune_comm);
+
+      default_pa.tune = 1;
+
+      for (k = 0; k < ncalls; k++)
+      {
+        packet_size = pipe_tune_packet_size(tune_comm, count * sizeof(double));
+
+        MPI_Barrier(tune_comm);
+        t = MPI_Wtime();
+        algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, tune_comm);
+        MPI_Barrier(tune_comm);
+        t = MPI_Wtime() - t;
+
+        if (comm_rank == root)
+          printf("  %8d  %-30s  %6d  %10d  %10.6f  %10.6f  %s%s\n", count, algorithms[j].name, k, packet_size, t, t_fixed,
+            bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf)?"ok":"verification failed", pipe_tune_converged(tune_comm, count * sizeof(double))?" (converged)":"");
+      }
+
+      default_pa.tune = 0;
+
+      MPI_Comm_free(&tune_comm);
+    }
+  }
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* scaling of the multi-lane pipelines with the number of lanes (dense and sparse vectors) */
+void bench_pipe_lanes(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const int lanes[] = { 1, 2, 4, 8 };
+  const double densities[] = { 1.0, non_zeros };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; } algorithms[] =
+  {
+    { "MPI_Reduce_pipe_lanes", MPI_Reduce_pipe_lanes },
+    { "MPI_Reduce_pipe_lanes_rle", MPI_Reduce_pipe_lanes_rle },
+  };
+
+  int i, j, k, l;
+  double t, t_min, t_single, *sendbuf, *recvbuf, *verify_recvbuf;
+  int pa_lanes = default_pa.lanes;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == root)
+  {
+    printf("bench_pipe_lanes: count: %d, processes: %d, packet size: %d, repeats: %d\n", count, comm_size, default_pa.packet_size, BENCH_REDUCE_REPEATS);
+    printf("  %8s  %-30s  %6s  %10s  %12s  %10s  %s\n", "density", "algorithm", "lanes", "time", "MB/s", "speedup", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(densities) / sizeof(densities[0])); i++)
+  {
+    srand(comm_rank + 1);
+    bench_reduce_fill(MPI_DOUBLE, count, densities[i], sendbuf);
+
+    MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      t_single = 0.0;
+
+      for (l = 0; l < (int) (sizeof(lanes) / sizeof(lanes[0])); l++)
+      {
+        default_pa.lanes = lanes[l];
+
+        t_min = 0.0;
+
+        for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+        {
+          MPI_Barrier(comm);
+          t = MPI_Wtime();
+          algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+          MPI_Barrier(comm);
+          t = MPI_Wtime() - t;
+
+          if (k == 0 || t < t_min) t_min = t;
+        }
+
+        /* speedup relative to a single lane */
+        if (l == 0) t_single = t_min;
+
+        if (comm_rank == root)
+          printf("  %8.3f  %-30s  %6d  %10.6f  %12.2f  %10.2f  %s\n", densities[i], algorithms[j].name, lanes[l], t_min, count * sizeof(double) / t_min * 1e-6, t_single / t_min,
+            bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf)?"ok":"verification failed");
+      }
+    }
+  }
+
+  default_pa.lanes = pa_lanes;
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* latency of the bidirectional pipelines compared to the stream pipelines for increasing numbers of processes (2, 4, 8, ..., comm_size) */
+void bench_pipe_bidir(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const double densities[] = { 1.0, non_zeros };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; MPI_Reduce_t mpi_reduce_bidir; } algorithms[] =
+  {
+    { "MPI_Reduce_pipe_stream", MPI_Reduce_pipe_stream, MPI_Reduce_pipe_bidir },
+    { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle, MPI_Reduce_pipe_bidir_rle },
+  };
+
+  int i, j, k, l, p, sub_size, sub_rank;
+  double t, t_min[2], *sendbuf, *recvbuf, *verify_recvbuf;
+  int ok[2];
+  MPI_Comm sub_comm;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  if (comm_rank == root)
+  {
+    printf("bench_pipe_bidir: count: %d, processes: %d, packet size: %d, repeats: %d\n", count, comm_size, default_pa.packet_size, BENCH_REDUCE_REPEATS);
+    printf("  %6s  %8s  %-30s  %10s  %10s  %10s  %s\n", "procs", "density", "algorithm", "time", "bidir", "speedup", "verify");
+  }
+
+  for (p = 2; ; p = (2 * p < comm_size)?(2 * p):comm_size)
+  {
+    if (p > comm_size) break;
+
+    MPI_Comm_split(comm, (comm_rank < p)?0:MPI_UNDEFINED, comm_rank, &sub_comm);
+
+    if (sub_comm != MPI_COMM_NULL)
+    {
+      MPI_Comm_size(sub_comm, &sub_size);
+      MPI_Comm_rank(sub_comm, &sub_rank);
+
+      for (i = 0; i < (int) (sizeof(densities) / sizeof(densities[0])); i++)
+      {
+        srand(sub_rank + 1);
+        bench_reduce_fill(MPI_DOUBLE, count, densities[i], sendbuf);
+
+        MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, sub_comm);
+
+        for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+        {
+          for (l = 0; l < 2; l++)
+          {
+            t_min[l] = 0.0;
+
+            for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+            {
+              MPI_Barrier(sub_comm);
+              t = MPI_Wtime();
+              if (l == 0) algorithms[j].mpi_reduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, sub_comm);
+              else algorithms[j].mpi_reduce_bidir(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, sub_comm);
+              MPI_Barrier(sub_comm);
+              t = MPI_Wtime() - t;
+
+              if (k == 0 || t < t_min[l]) t_min[l] = t;
+            }
+
+            ok[l] = (sub_rank == root)?bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf):1;
+          }
+
+          if (sub_rank == root)
+            printf("  %6d  %8.3f  %-30s  %10.6f  %10.6f  %10.2f  %s\n", sub_size, densities[i], algorithms[j].name, t_min[0], t_min[1], t_min[0] / t_min[1],
+              (ok[0] && ok[1])?"ok":"verification failed");
+        }
+      }
+
+      MPI_Comm_free(&sub_comm);
+    }
+
+    if (p == comm_size) break;
+  }
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+/* memory bandwidth of the shared-memory pipeline (with copied and registered send buffers) compared to the copy-based stream pipeline,
+   given as the bytes of all input vectors reduced per second */
+void bench_pipe_shm(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  const int root = 0;
+
+  const double densities[] = { 1.0, non_zeros };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; int registered; } algorithms[] =
+  {
+    { "MPI_Reduce_pipe_stream", MPI_Reduce_pipe_stream, 0 },
+    { "MPI_Reduce_pipe_shm", MPI_Reduce_pipe_shm, 0 },
+    { "MPI_Reduce_pipe_shm", MPI_Reduce_pipe_shm, 1 },
+    { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle, 0 },
+    { "MPI_Reduce_pipe_shm_rle", MPI_Reduce_pipe_shm_rle, 0 },
+    { "MPI_Reduce_pipe_shm_rle", MPI_Reduce_pipe_shm_rle, 1 },
+  };
+
+  int i, j, k, ok;
+  double t, t_min, *sendbuf, *shm_sendbuf, *recvbuf, *verify_recvbuf;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  ZMPI_Reduce_shm_alloc((MPI_Aint) count * sizeof(double), comm, &shm_sendbuf);
+
+  if (comm_rank == root)
+  {
+    printf("bench_pipe_shm: count: %d, processes: %d, packet size: %d, repeats: %d\n", count, comm_size, default_pa.packet_size, BENCH_REDUCE_REPEATS);
+    printf("  %8s  %-30s  %10s  %10s  %10s  %s\n", "density", "algorithm", "sendbuf", "time", "GB/s", "verify");
+  }
+
+  for (i = 0; i < (int) (sizeof(densities) / sizeof(densities[0])); i++)
+  {
+    srand(comm_rank + 1);
+    bench_reduce_fill(MPI_DOUBLE, count, densities[i], sendbuf);
+    memcpy(shm_sendbuf, sendbuf, count * sizeof(double));
+
+    MPI_Reduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      t_min = 0.0;
+
+      for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+      {
+        MPI_Barrier(comm);
+        t = MPI_Wtime();
+        algorithms[j].mpi_reduce(algorithms[j].registered?shm_sendbuf:sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, root, comm);
+        MPI_Barrier(comm);
+        t = MPI_Wtime() - t;
+
+        if (k == 0 || t < t_min) t_min = t;
+      }
+
+      ok = (comm_rank == root)?bench_reduce_equal(MPI_DOUBLE, count, recvbuf, verify_recvbuf):1;
+
+      if (comm_rank == root)
+        printf("  %8.3f  %-30s  %10s  %10.6f  %10.2f  %s\n", densities[i], algorithms[j].name, algorithms[j].registered?"registered":"malloc", t_min,
+          (double) comm_size * count * sizeof(double) / t_min * 1.0e-9, ok?"ok":"verification failed");
+    }
+  }
+
+  ZMPI_Reduce_shm_free(shm_sendbuf);
+
+  free(sendbuf);
+  free(recvbuf);
+  free(verify_recvbuf);
+}
+
+
+typedef struct
+{
+  MPI_Reduce_t mpi_reduce;
+  int count;
+  double non_zeros;
+
+  double t_min, *recvbuf;
+  int ret;
+
+} bench_loopback_arg;
+
+
+/* like bench_reduce_fill, but with a generator per thread */
+static void bench_loopback_fill(int rank, int count, double non_zeros, double *buf)
+{
+  unsigned int seed = rank + 1;
+  int i, r;
+
+  for (i = 0; i < count; i++)
+  {
+    if (rand_r(&seed) >= non_zeros * RAND_MAX) { buf[i] = 0; continue; }
+    r = rand_r(&seed) % 2001 - 1000;
+    buf[i] = (r != 0)?r:1;
+  }
+}
+
+
+static void bench_loopback_reduce(int rank, int nranks, void *arg)
+{
+  const int root = 0;
+
+  bench_loopback_arg *a = arg;
+  double t, *sendbuf, *recvbuf;
+  int k, ret;
+
+  sendbuf = malloc(a->count * sizeof(double));
+  recvbuf = (rank == root)?a->recvbuf:malloc(a->count * sizeof(double));
+
+  bench_loopback_fill(rank, a->count, a->non_zeros, sendbuf);
+
+  for (k = 0; k < BENCH_REDUCE_REPEATS; k++)
+  {
+    transport_barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime();
+    ret = a->mpi_reduce(sendbuf, recvbuf, a->count, MPI_DOUBLE, MPI_SUM, root, MPI_COMM_WORLD);
+    transport_barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime() - t;
+
+    if (rank == root && (k == 0 || t < a->t_min)) a->t_min = t;
+    if (rank == root && ret != MPI_SUCCESS) a->ret = ret;
+  }
+
+  free(sendbuf);
+  if (rank != root) free(recvbuf);
+}
+
+
+/* algorithms with 2, 4, 8, ..., 32 processes emulated by threads of process 0 (loopback transport), without and with emulated network costs */
+void bench_transport_loopback(int count, double non_zeros, int comm_rank)
+{
+  const double densities[] = { 1.0, non_zeros };
+  const struct { double latency, bandwidth; } networks[] = { { 0.0, 0.0 }, { 2.0e-6, 10.0e9 } };
+  const struct { const char *name; MPI_Reduce_t mpi_reduce; } algorithms[] =
+  {
+    { "MPI_Reduce_pipe_sendrecv_rle", MPI_Reduce_pipe_sendrecv_rle },
+    { "MPI_Reduce_pipe_send_recv", MPI_Reduce_pipe_send_recv },
+    { "MPI_Reduce_pipe_isend_irecv", MPI_Reduce_pipe_isend_irecv },
+    { "MPI_Reduce_pipe_stream_rle", MPI_Reduce_pipe_stream_rle },
+    { "MPI_Reduce_pipe_coo", MPI_Reduce_pipe_coo },
+    { "MPI_Reduce_gather_rle", MPI_Reduce_gather_rle },
+    { "MPI_Reduce_gather_irecv_rle", MPI_Reduce_gather_irecv_rle },
+    { "MPI_Reduce_gather_packets_rle", MPI_Reduce_gather_packets_rle },
+    { "MPI_Reduce_rabenseifner_rle", MPI_Reduce_rabenseifner_rle },
+  };
+  const int max_threads = 32;
+
+  int i, j, k, l, p, ret, ok;
+  double *tbuf, *verify_recvbuf;
+  bench_loopback_arg a;
+
+  if (comm_rank != 0) return;
+
+  printf("bench_transport_loopback: count: %d, packet size: %d, repeats: %d\n", count, default_pa.packet_size, BENCH_REDUCE_REPEATS);
+  printf("  %7s  %10s  %10s  %8s  %-30s  %10s  %s\n", "threads", "latency", "GB/s", "density", "algorithm", "time", "verify");
+
+  a.count = count;
+  a.recvbuf = malloc(count * sizeof(double));
+
+  tbuf = malloc(count * sizeof(double));
+  verify_recvbuf = malloc(count * sizeof(double));
+
+  for (p = 2; p <= max_threads; p *= 2)
+  for (i = 0; i < (int) (sizeof(densities) / sizeof(densities[0])); i++)
+  {
+    a.non_zeros = densities[i];
+
+    memset(verify_recvbuf, 0, count * sizeof(double));
+    for (k = 0; k < p; k++)
+    {
+      bench_loopback_fill(k, count, densities[i], tbuf);
+      for (l = 0; l < count; l++) verify_recvbuf[l] += tbuf[l];
+    }
+
+    for (l = 0; l < (int) (sizeof(networks) / sizeof(networks[0])); l++)
+    for (j = 0; j < (int) (sizeof(algorithms) / sizeof(algorithms[0])); j++)
+    {
+      a.mpi_reduce = algorithms[j].mpi_reduce;
+      a.t_min = 0.0;
+      a.ret = MPI_SUCCESS;
+
+      /* errors of the transport (e.g. truncated messages) fail the run, even if the result is correct */
+      ret = ZMPI_Transport_loopback_run(p, networks[l].latency, networks[l].bandwidth, bench_loopback_reduce, &a);
+      if (ret == MPI_SUCCESS) ret = a.ret;
+
+      ok = bench_reduce_equal(MPI_DOUBLE, count, a.recvbuf, verify_recvbuf);
+
+      printf("  %7d  %10.2e  %10.2f  %8.3f  %-30s  %10.6f  %s\n", p, networks[l].latency, networks[l].bandwidth * 1.0e-9, densities[i], algorithms[j].name, a.t_min,
+        (ret != MPI_SUCCESS)?"failed":(ok?"ok":"verification failed"));
+    }
+  }
+
+  free(a.recvbuf);
+  free(tbuf);
+  free(verify_recvbuf);
+}
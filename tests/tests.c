@@ -18,19 +18,229 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <mpi.h>
 
 #include "dblv.h"
 #include "zmpi_reduce.h"
+#include "tests.h"
 
 
 #define VERBOSE 0
 #define VERIFY  1
 #define TIMING  1
 
-typedef int (*MPI_Reduce_t)(const void *, void *, int, MPI_Datatype, MPI_Op, int, MPI_Comm);
+
+/* blocking wrappers of the nonblocking pipeline reductions */
+#define TEST_IREDUCE_WAIT(name)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  ZMPI_Ireduce_pipe_request request; \
+  int ret = name(sendbuf, recvbuf, count, datatype, op, root, comm, &request); \
+  if (ret == MPI_SUCCESS) ret = ZMPI_Ireduce_pipe_wait(&request); \
+  return ret; \
+}
+
+TEST_IREDUCE_WAIT(ZMPI_Ireduce_pipe_sendrecv)
+TEST_IREDUCE_WAIT(ZMPI_Ireduce_pipe_sendrecv_rle)
+TEST_IREDUCE_WAIT(ZMPI_Ireduce_pipe_isend_irecv)
+TEST_IREDUCE_WAIT(ZMPI_Ireduce_pipe_stream)
+TEST_IREDUCE_WAIT(ZMPI_Ireduce_pipe_stream_rle)
+
+
+/* blocking wrappers of the persistent reductions, every plan is started twice */
+#define TEST_REDUCE_PLAN(name, algorithm)  \
+int test_ZMPI_Reduce_plan_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  ZMPI_Reduce_plan plan; \
+  int i, ret = ZMPI_Reduce_init(algorithm, sendbuf, recvbuf, count, datatype, op, root, comm, &plan); \
+  for (i = 0; i < 2 && ret == MPI_SUCCESS; i++) \
+  { \
+    ret = ZMPI_Reduce_start(plan); \
+    if (ret == MPI_SUCCESS) ret = ZMPI_Reduce_wait(plan); \
+  } \
+  ZMPI_Reduce_plan_free(&plan); \
+  return ret; \
+}
+
+TEST_REDUCE_PLAN(pipe_sendrecv_rle, ZMPI_REDUCE_PLAN_PIPE_SENDRECV_RLE)
+TEST_REDUCE_PLAN(pipe_stream_rle, ZMPI_REDUCE_PLAN_PIPE_STREAM_RLE)
+TEST_REDUCE_PLAN(gather, ZMPI_REDUCE_PLAN_GATHER)
+TEST_REDUCE_PLAN(gather_rle, ZMPI_REDUCE_PLAN_GATHER_RLE)
+TEST_REDUCE_PLAN(mpi, ZMPI_REDUCE_PLAN_MPI)
+
+/* tree algorithms with a k-ary tree and packets */
+#define TEST_REDUCE_TREE(name, algorithm, tree_arity, tree_packet_size)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  tree_attr ta = default_ta; \
+  int ret; \
+  default_ta.arity = tree_arity; \
+  default_ta.packet_size = tree_packet_size; \
+  ret = algorithm(sendbuf, recvbuf, count, datatype, op, root, comm); \
+  default_ta = ta; \
+  return ret; \
+}
+
+TEST_REDUCE_TREE(MPI_Reduce_tree_3ary_packets, MPI_Reduce_tree, 3, 4096)
+TEST_REDUCE_TREE(MPI_Reduce_tree_rle_3ary_packets, MPI_Reduce_tree_rle, 3, 4096)
+
+/* pipeline algorithms with online packet size tuning, called until the tuning of the size class is converged */
+#define TEST_REDUCE_PIPE_TUNE(name, algorithm)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  int i, ret = MPI_SUCCESS, type_size; \
+  MPI_Type_size(datatype, &type_size); \
+  default_pa.tune = 1; \
+  for (i = 0; i < 10 && ret == MPI_SUCCESS; i++) \
+  { \
+    ret = algorithm(sendbuf, recvbuf, count, datatype, op, root, comm); \
+    if (pipe_tune_converged(comm, (long) count * type_size)) break; \
+  } \
+  default_pa.tune = 0; \
+  return ret; \
+}
+
+TEST_REDUCE_PIPE_TUNE(MPI_Reduce_pipe_sendrecv_rle_tuned, MPI_Reduce_pipe_sendrecv_rle)
+TEST_REDUCE_PIPE_TUNE(MPI_Reduce_pipe_stream_rle_tuned, MPI_Reduce_pipe_stream_rle)
+
+/* multi-lane pipelines with a given number of lanes */
+#define TEST_REDUCE_PIPE_LANES(name, algorithm, nlanes)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  int lanes = default_pa.lanes, ret; \
+  default_pa.lanes = nlanes; \
+  ret = algorithm(sendbuf, recvbuf, count, datatype, op, root, comm); \
+  default_pa.lanes = lanes; \
+  return ret; \
+}
+
+TEST_REDUCE_PIPE_LANES(MPI_Reduce_pipe_lanes_rle_5, MPI_Reduce_pipe_lanes_rle, 5)
+
+/* runs the algorithm (repeats times) on a duplicate of comm with 2 simulated nodes and block-cyclic placement, the
+   topology order and the nodes are cached per communicator */
+static int test_reduce_2nodes(ZMPI_Reduce_function algorithm, int topo, int repeats, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int pa_topo = default_pa.topo, ta_topo = default_ta.topo, ret = MPI_SUCCESS, i;
+  MPI_Comm nodes_comm;
+
+  setenv("ZMPI_REDUCE_TOPO_NODES", "2", 1);
+  MPI_Comm_dup(comm, &nodes_comm);
+
+  if (topo) default_pa.topo = default_ta.topo = 1;
+
+  for (i = 0; i < repeats && ret == MPI_SUCCESS; i++) ret = algorithm(sendbuf, recvbuf, count, datatype, op, root, nodes_comm);
+
+  default_pa.topo = pa_topo;
+  default_ta.topo = ta_topo;
+
+  MPI_Comm_free(&nodes_comm);
+  unsetenv("ZMPI_REDUCE_TOPO_NODES");
+
+  return ret;
+}
+
+/* topology-aware order with 2 simulated nodes */
+#define TEST_REDUCE_TOPO(name, algorithm)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  return test_reduce_2nodes(algorithm, 1, 1, sendbuf, recvbuf, count, datatype, op, root, comm); \
+}
+
+TEST_REDUCE_TOPO(MPI_Reduce_pipe_stream_rle_topo, MPI_Reduce_pipe_stream_rle)
+TEST_REDUCE_TOPO(MPI_Reduce_pipe_bidir_topo, MPI_Reduce_pipe_bidir)
+TEST_REDUCE_TOPO(MPI_Reduce_tree_rle_topo, MPI_Reduce_tree_rle)
+
+/* hierarchical reductions with 2 simulated nodes (twice, the second call reuses the cached nodes and window) */
+#define TEST_REDUCE_HIER(name, algorithm)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  return test_reduce_2nodes(algorithm, 0, 2, sendbuf, recvbuf, count, datatype, op, root, comm); \
+}
+
+TEST_REDUCE_HIER(MPI_Reduce_hier_pipe_rle_2nodes, MPI_Reduce_hier_pipe_rle)
+TEST_REDUCE_HIER(MPI_Reduce_hier_rabenseifner_rle_2nodes, MPI_Reduce_hier_rabenseifner_rle)
+TEST_REDUCE_HIER(MPI_Reduce_pipe_shm_2nodes, MPI_Reduce_pipe_shm)
+TEST_REDUCE_HIER(MPI_Reduce_pipe_shm_rle_2nodes, MPI_Reduce_pipe_shm_rle)
+
+/* shared-memory pipelines with send buffers allocated with ZMPI_Reduce_shm_alloc (read in place) */
+#define TEST_REDUCE_SHM_ALLOC(name, algorithm)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) \
+{ \
+  int type_size, ret; \
+  void *shm_sendbuf; \
+  MPI_Type_size(datatype, &type_size); \
+  ZMPI_Reduce_shm_alloc((MPI_Aint) count * type_size, comm, &shm_sendbuf); \
+  memcpy(shm_sendbuf, sendbuf, (size_t) count * type_size); \
+  ret = algorithm(shm_sendbuf, recvbuf, count, datatype, op, root, comm); \
+  ZMPI_Reduce_shm_free(shm_sendbuf); \
+  return ret; \
+}
+
+TEST_REDUCE_SHM_ALLOC(MPI_Reduce_pipe_shm_registered, MPI_Reduce_pipe_shm)
+TEST_REDUCE_SHM_ALLOC(MPI_Reduce_pipe_shm_rle_registered, MPI_Reduce_pipe_shm_rle)
+
+/* ring allreduce with small packets */
+#define TEST_ALLREDUCE_PACKETS(name, algorithm, pipe_packet_size)  \
+int test_##name(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) \
+{ \
+  int packet_size = default_pa.packet_size, ret; \
+  default_pa.packet_size = pipe_packet_size; \
+  ret = algorithm(sendbuf, recvbuf, count, datatype, op, comm); \
+  default_pa.packet_size = packet_size; \
+  return ret; \
+}
+
+TEST_ALLREDUCE_PACKETS(ZMPI_Allreduce_ring_1000, ZMPI_Allreduce_ring, 1000)
+TEST_ALLREDUCE_PACKETS(ZMPI_Allreduce_ring_rle_1000, ZMPI_Allreduce_ring_rle, 1000)
+
+/* ZMPI_Reduce with a decision table (written to a file and read again) that selects the tree algorithm */
+int test_ZMPI_Reduce_table(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size, type_size, ret;
+  char filename[64];
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+  MPI_Type_size(datatype, &type_size);
+
+  snprintf(filename, sizeof(filename), "zmpi_tests_%d.table", comm_rank);
+
+  ZMPI_Reduce_table_clear();
+  ZMPI_Reduce_table_add(comm_size, (long) count * type_size, 0.01, ZMPI_Reduce_algorithm_index("MPI_Reduce_tree_rle"), 0, 1.0);
+  ZMPI_Reduce_table_save(filename);
+  ZMPI_Reduce_table_clear();
+  ZMPI_Reduce_table_load(filename);
+  remove(filename);
+
+  ret = ZMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+  ZMPI_Reduce_table_clear();
+
+  return ret;
+}
+
+/* ZMPI_Reduce with a decision table only at the non-root processes, the decision of the root is used */
+int test_ZMPI_Reduce_table_root(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+  int comm_rank, comm_size, type_size, ret;
+
+  MPI_Comm_rank(comm, &comm_rank);
+  MPI_Comm_size(comm, &comm_size);
+  MPI_Type_size(datatype, &type_size);
+
+  ZMPI_Reduce_table_clear();
+  if (comm_rank != root) ZMPI_Reduce_table_add(comm_size, (long) count * type_size, 0.01, ZMPI_Reduce_algorithm_index("MPI_Reduce_tree_rle"), 0, 1.0);
+
+  ret = ZMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+  ZMPI_Reduce_table_clear();
+
+  return ret;
+}
 
 void test_mpi_reduce(MPI_Reduce_t mpi_reduce, const char *name, int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
 {
@@ -114,13 +324,98 @@ void test_mpi_reduce(MPI_Reduce_t mpi_reduce, const char *name, int count, doubl
 }
 
 
+/* bytes moved per step by the last Rabenseifner reduction, summed over all processes */
+void print_rabenseifner_stats(const char *name, int comm_rank, MPI_Comm comm)
+{
+  rabenseifner_stats *rs = &rabenseifner_last_stats;
+  long sent[RABENSEIFNER_MAX_STEPS], dense[RABENSEIFNER_MAX_STEPS];
+  int i;
+
+  MPI_Reduce(rs->sent, sent, rs->nsteps, MPI_LONG, MPI_SUM, 0, comm);
+  MPI_Reduce(rs->dense, dense, rs->nsteps, MPI_LONG, MPI_SUM, 0, comm);
+
+  if (comm_rank != 0) return;
+
+  for (i = 0; i < rs->nsteps; i++)
+  {
+    if (dense[i] == 0) continue;
+    printf("%d: %s: step %-4s  bytes: %12ld  uncompressed: %12ld  (%.1f%%)\n", comm_rank, name, rs->names[i], sent[i], dense[i], 100.0 * sent[i] / dense[i]);
+  }
+}
+
+
+void test_mpi_allreduce(MPI_Allreduce_t mpi_allreduce, const char *name, int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm)
+{
+  double *sendbuf, *recvbuf;
+
+  sendbuf = malloc(count * sizeof(double));
+  recvbuf = malloc(count * sizeof(double));
+
+  srand(comm_rank + 1);
+  if (non_zeros < 1.0)
+  {
+    dblv_write_zeros(count, sendbuf);
+    int nz = 0;
+    dblv_write_random_random_next(count, sendbuf, (int) (count * non_zeros), 0.0, &nz);
+
+  } else
+  {
+    dblv_write_random(count, sendbuf);
+  }
+
+#if TIMING
+  MPI_Barrier(comm);
+  double t = MPI_Wtime();
+#endif
+  int ret = mpi_allreduce(sendbuf, recvbuf, count, MPI_DOUBLE, MPI_SUM, comm);
+#if TIMING
+  MPI_Barrier(comm);
+  t = MPI_Wtime() - t;
+#endif
+
+  if(ret != MPI_SUCCESS)
+  {
+    printf("%d: %s: failed\n", comm_rank, name);
+  }
+
+#if VERIFY
+  /* every process has to receive the result */
+  double *verify_recvbuf = malloc(count * sizeof(double));
+  MPI_Allreduce(sendbuf, verify_recvbuf, count, MPI_DOUBLE, MPI_SUM, comm);
+
+  const double verify_absolute_diff = dblv_absdiff(count, recvbuf, verify_recvbuf);
+  const double verfiy_allowed_diff = count * 1e-10;
+  if (verify_absolute_diff > verfiy_allowed_diff)
+  {
+    printf("%d: %s: verification failed: absolute difference %e is greather than allowed difference %e\n", comm_rank, name, verify_absolute_diff, verfiy_allowed_diff);
+  }
+
+  free(verify_recvbuf);
+#endif
+
+#if TIMING
+  if (comm_rank == 0)
+  {
+    printf("%d: %s: time: %f\n", comm_rank, name, t);
+  }
+#endif
+
+  free(sendbuf);
+  free(recvbuf);
+}
+
+
 int main(int argc, char *argv[])
 {
   int size, rank;
 
   MPI_Comm comm = MPI_COMM_WORLD;
 
-  MPI_Init(&argc,&argv);
+  int provided;
+
+  // the overlap benchmark uses a progress thread, the loopback benchmark runs the processes as threads
+  if (argc > 1 && (strcmp(argv[1], "bench_ireduce_overlap") == 0 || strcmp(argv[1], "bench_transport_loopback") == 0)) MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  else MPI_Init(&argc,&argv);
 
   MPI_Comm_size(comm, &size);
   MPI_Comm_rank(comm, &rank);
@@ -132,11 +427,44 @@ int main(int argc, char *argv[])
   const int count = 1000000;
   const double non_zeros = 0.01;
 
+  // benchmarks: zmpi_tests <benchmark>
+  if (argc > 0)
+  {
+    if (strcmp(argv[0], "bench_rle_compress") == 0) bench_rle_compress(count, rank);
+    else if (strcmp(argv[0], "bench_rle_add") == 0) bench_rle_add(count, rank);
+    else if (strcmp(argv[0], "bench_coo") == 0) bench_coo(count, rank);
+    else if (strcmp(argv[0], "bench_reduce_types") == 0) bench_reduce_types(count, non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_reduce_pool") == 0) bench_reduce_pool(count, rank);
+    else if (strcmp(argv[0], "bench_reduce_threads") == 0) bench_reduce_threads(count, rank);
+    else if (strcmp(argv[0], "bench_reduce_plan") == 0) bench_reduce_plan(size, rank, comm);
+    else if (strcmp(argv[0], "bench_ireduce_overlap") == 0) bench_ireduce_overlap(count, non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_reduce_mixed") == 0) bench_reduce_mixed(count, size, rank, comm);
+    else if (strcmp(argv[0], "bench_reduce_tree") == 0) bench_reduce_tree(non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_reduce_gather_root") == 0) bench_reduce_gather_root(count, non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_pipe_tune") == 0) bench_pipe_tune(non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_pipe_lanes") == 0) bench_pipe_lanes(count, non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_pipe_bidir") == 0) bench_pipe_bidir(count, non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_pipe_shm") == 0) bench_pipe_shm(count, non_zeros, size, rank, comm);
+    else if (strcmp(argv[0], "bench_transport_loopback") == 0) bench_transport_loopback(count, non_zeros, rank);
+    else if (strcmp(argv[0], "tune_reduce") == 0) bench_reduce_tune((argc > 1)?argv[1]:"zmpi_reduce.table", size, rank, comm);
+    else if (strcmp(argv[0], "bench_allreduce_types") == 0) bench_allreduce_types(count, non_zeros, size, rank, comm);
+    else if (rank == 0) printf("unknown benchmark '%s'\n", argv[0]);
+
+    MPI_Finalize();
+
+    return 0;
+  }
+
   // original
   test_mpi_reduce(MPI_Reduce, "MPI_Reduce", count, non_zeros, size, rank, comm);
 
   // Rabenseifner algorithm
   test_mpi_reduce(MPI_Reduce_rabenseifner, "MPI_Reduce_rabenseifner", count, non_zeros, size, rank, comm);
+  print_rabenseifner_stats("MPI_Reduce_rabenseifner", rank, comm);
+
+  // Rabenseifner algorithm WITH COMPRESSION
+  test_mpi_reduce(MPI_Reduce_rabenseifner_rle, "MPI_Reduce_rabenseifner_rle", count, non_zeros, size, rank, comm);
+  print_rabenseifner_stats("MPI_Reduce_rabenseifner_rle", rank, comm);
 
   // pipeline algorithm using blocking send/recv operations WITHOUT COMPRESSION
   // test_mpi_reduce(MPI_Reduce_pipe_send_recv, "MPI_Reduce_pipe_send_recv", count, non_zeros, size, rank, comm);
@@ -156,12 +484,106 @@ int main(int argc, char *argv[])
   // pipeline stream algorithm using blocking send/recv operations WITH COMPRESSION
   test_mpi_reduce(MPI_Reduce_pipe_stream_rle, "MPI_Reduce_pipe_stream_rle", count, non_zeros, size, rank, comm);
 
+  // pipeline stream algorithm using blocking send/recv operations WITH COMPRESSION OF SPARSE PACKETS ONLY
+  test_mpi_reduce(MPI_Reduce_pipe_stream_adaptive, "MPI_Reduce_pipe_stream_adaptive", count, non_zeros, size, rank, comm);
+
+  // pipeline algorithm sending every packet zero-RLE or index-value encoded, whichever is smaller
+  test_mpi_reduce(MPI_Reduce_pipe_coo, "MPI_Reduce_pipe_coo", count, non_zeros, size, rank, comm);
+
+  // pipeline algorithms WITH COMPRESSION and online packet size tuning
+  test_mpi_reduce(test_MPI_Reduce_pipe_sendrecv_rle_tuned, "MPI_Reduce_pipe_sendrecv_rle_tuned", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_stream_rle_tuned, "MPI_Reduce_pipe_stream_rle_tuned", count, non_zeros, size, rank, comm);
+
+  // multi-lane pipelines WITHOUT and WITH COMPRESSION (default and 5 lanes)
+  test_mpi_reduce(MPI_Reduce_pipe_lanes, "MPI_Reduce_pipe_lanes", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_pipe_lanes_rle, "MPI_Reduce_pipe_lanes_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_lanes_rle_5, "MPI_Reduce_pipe_lanes_rle_5", count, non_zeros, size, rank, comm);
+
+  // bidirectional pipelines WITHOUT and WITH COMPRESSION
+  test_mpi_reduce(MPI_Reduce_pipe_bidir, "MPI_Reduce_pipe_bidir", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_pipe_bidir_rle, "MPI_Reduce_pipe_bidir_rle", count, non_zeros, size, rank, comm);
+
+  // topology-aware process order of pipelines and trees
+  test_mpi_reduce(test_MPI_Reduce_pipe_stream_rle_topo, "MPI_Reduce_pipe_stream_rle_topo", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_bidir_topo, "MPI_Reduce_pipe_bidir_topo", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_tree_rle_topo, "MPI_Reduce_tree_rle_topo", count, non_zeros, size, rank, comm);
+
+  // hierarchical reductions (shared-memory stage and compressed stage of the node leaders), one node and 2 simulated nodes
+  test_mpi_reduce(MPI_Reduce_hier_pipe_rle, "MPI_Reduce_hier_pipe_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_hier_gather_rle, "MPI_Reduce_hier_gather_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_hier_rabenseifner_rle, "MPI_Reduce_hier_rabenseifner_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_hier_pipe_rle_2nodes, "MPI_Reduce_hier_pipe_rle_2nodes", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_hier_rabenseifner_rle_2nodes, "MPI_Reduce_hier_rabenseifner_rle_2nodes", count, non_zeros, size, rank, comm);
+
+  // shared-memory pipelines WITHOUT and WITH COMPRESSION (copied and registered send buffers, 2 simulated nodes)
+  test_mpi_reduce(MPI_Reduce_pipe_shm, "MPI_Reduce_pipe_shm", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_pipe_shm_rle, "MPI_Reduce_pipe_shm_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_shm_registered, "MPI_Reduce_pipe_shm_registered", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_shm_rle_registered, "MPI_Reduce_pipe_shm_rle_registered", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_shm_2nodes, "MPI_Reduce_pipe_shm_2nodes", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_pipe_shm_rle_2nodes, "MPI_Reduce_pipe_shm_rle_2nodes", count, non_zeros, size, rank, comm);
+
+  // nonblocking pipeline algorithms (started and completed with wait)
+  test_mpi_reduce(test_ZMPI_Ireduce_pipe_sendrecv, "ZMPI_Ireduce_pipe_sendrecv", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Ireduce_pipe_sendrecv_rle, "ZMPI_Ireduce_pipe_sendrecv_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Ireduce_pipe_isend_irecv, "ZMPI_Ireduce_pipe_isend_irecv", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Ireduce_pipe_stream, "ZMPI_Ireduce_pipe_stream", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Ireduce_pipe_stream_rle, "ZMPI_Ireduce_pipe_stream_rle", count, non_zeros, size, rank, comm);
+
+  // persistent reductions (plans started twice)
+  test_mpi_reduce(test_ZMPI_Reduce_plan_pipe_sendrecv_rle, "ZMPI_Reduce_plan_pipe_sendrecv_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Reduce_plan_pipe_stream_rle, "ZMPI_Reduce_plan_pipe_stream_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Reduce_plan_gather, "ZMPI_Reduce_plan_gather", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Reduce_plan_gather_rle, "ZMPI_Reduce_plan_gather_rle", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Reduce_plan_mpi, "ZMPI_Reduce_plan_mpi", count, non_zeros, size, rank, comm);
+
   // gather to root algorithm using blocking send/recv operations WITHOUT COMPRESSION
   test_mpi_reduce(MPI_Reduce_gather, "MPI_Reduce_gather", count, non_zeros, size, rank, comm);
 
   // gather to root algorithm using blocking send/recv operations WITH COMPRESSION
   test_mpi_reduce(MPI_Reduce_gather_rle, "MPI_Reduce_gather_rle", count, non_zeros, size, rank, comm);
 
+  // gather to root algorithm WITH COMPRESSION, zero-RLE or index-value encoded, whichever is smaller
+  test_mpi_reduce(MPI_Reduce_gather_coo, "MPI_Reduce_gather_coo", count, non_zeros, size, rank, comm);
+
+  // gather to root algorithm with a ring of receives in flight WITHOUT and WITH COMPRESSION
+  test_mpi_reduce(MPI_Reduce_gather_irecv, "MPI_Reduce_gather_irecv", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_gather_irecv_rle, "MPI_Reduce_gather_irecv_rle", count, non_zeros, size, rank, comm);
+
+  // gather to root algorithm in slices of the packet size WITHOUT and WITH COMPRESSION
+  test_mpi_reduce(MPI_Reduce_gather_packets, "MPI_Reduce_gather_packets", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_gather_packets_rle, "MPI_Reduce_gather_packets_rle", count, non_zeros, size, rank, comm);
+
+  // binomial tree algorithm WITHOUT and WITH COMPRESSION (merged compressed+compressed at inner nodes)
+  test_mpi_reduce(MPI_Reduce_tree, "MPI_Reduce_tree", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(MPI_Reduce_tree_rle, "MPI_Reduce_tree_rle", count, non_zeros, size, rank, comm);
+
+  // 3-ary tree algorithms with packets
+  test_mpi_reduce(test_MPI_Reduce_tree_3ary_packets, "MPI_Reduce_tree_3ary_packets", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_MPI_Reduce_tree_rle_3ary_packets, "MPI_Reduce_tree_rle_3ary_packets", count, non_zeros, size, rank, comm);
+
+  // automatic selection of the algorithm and the packet size (cost model and decision table)
+  test_mpi_reduce(ZMPI_Reduce, "ZMPI_Reduce", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Reduce_table, "ZMPI_Reduce_table", count, non_zeros, size, rank, comm);
+  test_mpi_reduce(test_ZMPI_Reduce_table_root, "ZMPI_Reduce_table_root", count, non_zeros, size, rank, comm);
+
+  // allreduce algorithms compared with the original
+  test_mpi_allreduce(MPI_Allreduce, "MPI_Allreduce", count, non_zeros, size, rank, comm);
+  test_mpi_allreduce(ZMPI_Allreduce_ring, "ZMPI_Allreduce_ring", count, non_zeros, size, rank, comm);
+  test_mpi_allreduce(ZMPI_Allreduce_ring_rle, "ZMPI_Allreduce_ring_rle", count, non_zeros, size, rank, comm);
+
+  // ring allreduce with fewer elements than processes and with blocks on both sides of a packet boundary (125 doubles)
+  test_mpi_allreduce(test_ZMPI_Allreduce_ring_1000, "ZMPI_Allreduce_ring_1000_count_lt_size", size - 1, 1.0, size, rank, comm);
+  test_mpi_allreduce(test_ZMPI_Allreduce_ring_rle_1000, "ZMPI_Allreduce_ring_rle_1000_count_lt_size", size - 1, 1.0, size, rank, comm);
+  test_mpi_allreduce(test_ZMPI_Allreduce_ring_1000, "ZMPI_Allreduce_ring_1000_below_packet", size * 125 - 1, 1.0, size, rank, comm);
+  test_mpi_allreduce(test_ZMPI_Allreduce_ring_rle_1000, "ZMPI_Allreduce_ring_rle_1000_below_packet", size * 125 - 1, non_zeros, size, rank, comm);
+  test_mpi_allreduce(test_ZMPI_Allreduce_ring_1000, "ZMPI_Allreduce_ring_1000_above_packet", size * 125 + 1, 1.0, size, rank, comm);
+  test_mpi_allreduce(test_ZMPI_Allreduce_ring_rle_1000, "ZMPI_Allreduce_ring_rle_1000_above_packet", size * 125 + 1, non_zeros, size, rank, comm);
+  test_mpi_allreduce(ZMPI_Allreduce_rabenseifner, "ZMPI_Allreduce_rabenseifner", count, non_zeros, size, rank, comm);
+  test_mpi_allreduce(ZMPI_Allreduce_rabenseifner_rle, "ZMPI_Allreduce_rabenseifner_rle", count, non_zeros, size, rank, comm);
+  test_mpi_allreduce(ZMPI_Allreduce_reduce_bcast, "ZMPI_Allreduce_reduce_bcast", count, non_zeros, size, rank, comm);
+  test_mpi_allreduce(ZMPI_Allreduce_reduce_bcast_rle, "ZMPI_Allreduce_reduce_bcast_rle", count, non_zeros, size, rank, comm);
+
   MPI_Finalize();
 
   return 0;
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2019-2022 Michael Hofmann
+ *  Copyright (C) 2008-2018 Michael Hofmann, Chemnitz University of Technology
+ *
+ *  This file is part of the ZMPI Reduce Library.
+ *
+ *  The ZMPI-Reduce is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The ZMPI-Reduce is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __TESTS_H__
+#define __TESTS_H__
+
+
+typedef int (*MPI_Reduce_t)(const void *, void *, int, MPI_Datatype, MPI_Op, int, MPI_Comm);
+typedef int (*MPI_Allreduce_t)(const void *, void *, int, MPI_Datatype, MPI_Op, MPI_Comm);
+
+/* tests.c */
+void print_rabenseifner_stats(const char *name, int comm_rank, MPI_Comm comm);
+int test_ZMPI_Ireduce_pipe_sendrecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Ireduce_pipe_sendrecv_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Ireduce_pipe_isend_irecv(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Ireduce_pipe_stream(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Ireduce_pipe_stream_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_plan_pipe_sendrecv_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_plan_pipe_stream_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_plan_gather(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_plan_gather_rle(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_plan_mpi(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_MPI_Reduce_tree_3ary_packets(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_MPI_Reduce_tree_rle_3ary_packets(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_table(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_ZMPI_Reduce_table_root(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_MPI_Reduce_pipe_lanes_rle_5(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_MPI_Reduce_pipe_sendrecv_rle_tuned(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+int test_MPI_Reduce_pipe_stream_rle_tuned(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+/* bench_dblv.c */
+void bench_rle_compress(int count, int comm_rank);
+void bench_rle_add(int count, int comm_rank);
+void bench_coo(int count, int comm_rank);
+
+/* bench_reduce.c */
+void bench_reduce_types(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_reduce_pool(int count, int comm_rank);
+void bench_reduce_threads(int count, int comm_rank);
+void bench_reduce_plan(int comm_size, int comm_rank, MPI_Comm comm);
+void bench_ireduce_overlap(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_reduce_mixed(int count, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_reduce_tree(double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_reduce_gather_root(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_reduce_tune(const char *filename, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_pipe_tune(double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_pipe_lanes(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_pipe_bidir(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_pipe_shm(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+void bench_transport_loopback(int count, double non_zeros, int comm_rank);
+void bench_allreduce_types(int count, double non_zeros, int comm_size, int comm_rank, MPI_Comm comm);
+
+
+#endif /* __TESTS_H__ */